@@ -0,0 +1,269 @@
+#ifndef ALARM_JOURNAL_H
+#define ALARM_JOURNAL_H
+
+// Append-only journal of fixed-size binary alarm records (POSIX only).
+// Writers append records to an in-memory buffer; a flusher thread writes the buffer and syncs the file
+// once per sync interval (or as soon as the buffer is full), so the cost of a sync is shared by every
+// alarm of the interval (group commit). alarm_journal_wait() blocks until a record is on disk.
+// A reader maps the whole file and walks the records in place; a record cut short by a crash is
+// ignored, and the marker byte tells records from the zeros a crash can leave at the end of the file.
+// Opening a journal for appending cuts such a partial record off, so new records stay aligned.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define ALARM_JOURNAL_SUPPORTED 1
+
+#define ALARM_JOURNAL_MARKER 0xA7
+#define ALARM_JOURNAL_BUFFER_RECORDS 65536
+
+typedef struct {
+    uint64_t timestamp;     // nanoseconds since the Unix epoch
+    uint32_t device;
+    uint32_t frame;         // raw frame as received
+    int32_t value;          // decoded value that crossed the threshold
+    uint8_t type;           // alarm type (bit number of its flag)
+    uint8_t marker;         // ALARM_JOURNAL_MARKER
+    uint8_t reserved[2];
+} alarmRecord;
+
+typedef struct {
+    int file;
+    pthread_t flusher;
+    pthread_mutex_t lock;
+    pthread_cond_t hasWork;         // buffer full or journal closing
+    pthread_cond_t hasSynced;       // a group of records is on disk
+    alarmRecord* buffers[2];        // one is filled while the other is written
+    size_t used;                    // records in the buffer being filled
+    int active;
+    uint64_t appended;              // records appended so far
+    uint64_t durable;               // records written and synced
+    uint64_t syncs;
+    unsigned syncIntervalMs;
+    bool isClosing;
+    bool hasError;
+} alarmJournal;
+
+static inline uint64_t alarm_journal_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+static inline bool alarm_journal_write_all(int file, const alarmRecord* records, size_t count) {
+    const uint8_t* data = (const uint8_t*)records;
+    size_t remaining = count * sizeof(alarmRecord);
+    while (remaining > 0) {
+        ssize_t written = write(file, data, remaining);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        remaining -= (size_t)written;
+    }
+#if defined(__APPLE__)
+    return fsync(file) == 0;
+#else
+    return fdatasync(file) == 0;
+#endif
+}
+
+// Flusher thread: one write and one sync per interval for everything appended in it
+static inline void* alarm_journal_flusher(void* argument) {
+    alarmJournal* journal = argument;
+
+    pthread_mutex_lock(&journal->lock);
+    while (true) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += journal->syncIntervalMs / 1000;
+        deadline.tv_nsec += (long)(journal->syncIntervalMs % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        while (journal->used < ALARM_JOURNAL_BUFFER_RECORDS && !journal->isClosing) {
+            if (pthread_cond_timedwait(&journal->hasWork, &journal->lock, &deadline) == ETIMEDOUT) {
+                break;
+            }
+        }
+        if (journal->used == 0) {
+            if (journal->isClosing) {
+                break;
+            }
+            continue;
+        }
+
+        // Swap the buffers: writers go on filling the other one while this one is written
+        alarmRecord* records = journal->buffers[journal->active];
+        size_t count = journal->used;
+        uint64_t appended = journal->appended;
+        journal->active ^= 1;
+        journal->used = 0;
+        pthread_mutex_unlock(&journal->lock);
+
+        bool isWritten = alarm_journal_write_all(journal->file, records, count);
+
+        pthread_mutex_lock(&journal->lock);
+        if (isWritten) {
+            journal->durable = appended;
+            journal->syncs++;
+        }
+        else {
+            journal->hasError = true;
+        }
+        pthread_cond_broadcast(&journal->hasSynced);
+    }
+    pthread_mutex_unlock(&journal->lock);
+    return NULL;
+}
+
+// Opens the journal for appending (created when missing), syncs at most once per syncIntervalMs.
+// A partial record left by a crash during a write is cut off first.
+static inline bool alarm_journal_open(alarmJournal* journal, const char* path, unsigned syncIntervalMs) {
+    struct stat status;
+    memset(journal, 0, sizeof(*journal));
+    journal->syncIntervalMs = (syncIntervalMs < 1) ? 1 : syncIntervalMs;
+    journal->file = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (journal->file < 0) {
+        return false;
+    }
+    if (fstat(journal->file, &status) != 0
+        || (status.st_size % (off_t)sizeof(alarmRecord) != 0
+            && ftruncate(journal->file, status.st_size - status.st_size % (off_t)sizeof(alarmRecord)) != 0)) {
+        close(journal->file);
+        return false;
+    }
+    journal->buffers[0] = malloc(2 * ALARM_JOURNAL_BUFFER_RECORDS * sizeof(alarmRecord));
+    if (journal->buffers[0] == NULL) {
+        close(journal->file);
+        return false;
+    }
+    journal->buffers[1] = journal->buffers[0] + ALARM_JOURNAL_BUFFER_RECORDS;
+    pthread_mutex_init(&journal->lock, NULL);
+    pthread_cond_init(&journal->hasWork, NULL);
+    pthread_cond_init(&journal->hasSynced, NULL);
+    if (pthread_create(&journal->flusher, NULL, alarm_journal_flusher, journal) != 0) {
+        pthread_mutex_destroy(&journal->lock);
+        pthread_cond_destroy(&journal->hasWork);
+        pthread_cond_destroy(&journal->hasSynced);
+        free(journal->buffers[0]);
+        close(journal->file);
+        return false;
+    }
+    return true;
+}
+
+// Appends a record, returns its sequence number for alarm_journal_wait() or 0 after a write error.
+// Only blocks when the buffer is full and the previous group is still being written.
+static inline uint64_t alarm_journal_append(alarmJournal* journal, const alarmRecord* record) {
+    pthread_mutex_lock(&journal->lock);
+    while (journal->used == ALARM_JOURNAL_BUFFER_RECORDS && !journal->hasError) {
+        pthread_cond_signal(&journal->hasWork);
+        pthread_cond_wait(&journal->hasSynced, &journal->lock);
+    }
+    if (journal->hasError) {
+        pthread_mutex_unlock(&journal->lock);
+        return 0;
+    }
+    alarmRecord* slot = &journal->buffers[journal->active][journal->used++];
+    *slot = *record;
+    slot->marker = ALARM_JOURNAL_MARKER;
+    uint64_t sequence = ++journal->appended;
+    if (journal->used == ALARM_JOURNAL_BUFFER_RECORDS) {
+        pthread_cond_signal(&journal->hasWork);
+    }
+    pthread_mutex_unlock(&journal->lock);
+    return sequence;
+}
+
+// Blocks until the record with the given sequence number is synced, false after a write error
+static inline bool alarm_journal_wait(alarmJournal* journal, uint64_t sequence) {
+    pthread_mutex_lock(&journal->lock);
+    while (journal->durable < sequence && !journal->hasError) {
+        pthread_cond_wait(&journal->hasSynced, &journal->lock);
+    }
+    bool isDurable = journal->durable >= sequence;
+    pthread_mutex_unlock(&journal->lock);
+    return isDurable;
+}
+
+// Writes and syncs what is left, stops the flusher. Returns false when any write or sync failed.
+static inline bool alarm_journal_close(alarmJournal* journal) {
+    pthread_mutex_lock(&journal->lock);
+    journal->isClosing = true;
+    pthread_cond_signal(&journal->hasWork);
+    pthread_mutex_unlock(&journal->lock);
+    pthread_join(journal->flusher, NULL);
+
+    bool isOk = !journal->hasError && close(journal->file) == 0;
+    if (journal->hasError) {
+        close(journal->file);
+    }
+    pthread_mutex_destroy(&journal->lock);
+    pthread_cond_destroy(&journal->hasWork);
+    pthread_cond_destroy(&journal->hasSynced);
+    free(journal->buffers[0]);
+    return isOk;
+}
+
+// ---------------------------------------------------------------------------
+// Reader
+// ---------------------------------------------------------------------------
+
+// Maps a journal read-only into *records (*count of them, a cut last record is left out). A journal without
+// a whole record is not mapped: *records is NULL and *count 0. Returns false when the file cannot be read.
+static inline bool alarm_journal_map(const char* path, const alarmRecord** records, size_t* count, size_t* mapSize) {
+    struct stat status;
+    int file = open(path, O_RDONLY);
+    *records = NULL;
+    *count = 0;
+    *mapSize = 0;
+    if (file < 0) {
+        return false;
+    }
+    if (fstat(file, &status) != 0) {
+        close(file);
+        return false;
+    }
+    if ((size_t)status.st_size < sizeof(alarmRecord)) {
+        close(file);
+        return true;
+    }
+    void* map = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+#if defined(MADV_SEQUENTIAL)
+    madvise(map, (size_t)status.st_size, MADV_SEQUENTIAL);
+#endif
+    *records = map;
+    *mapSize = (size_t)status.st_size;
+    *count = *mapSize / sizeof(alarmRecord);
+    return true;
+}
+
+static inline void alarm_journal_unmap(const alarmRecord* records, size_t mapSize) {
+    if (records != NULL) {
+        munmap((void*)records, mapSize);
+    }
+}
+
+#endif // __unix__ || __APPLE__
+
+#endif // ALARM_JOURNAL_H
@@ -0,0 +1,387 @@
+#ifndef ALARM_RULES_H
+#define ALARM_RULES_H
+
+// Configurable alarm rules on raw frames. A rule set is text, one rule per line:
+//   <field> <op> <value> <alarm bit>      e.g. "pressure > 1135 3"   (op: < <= > >= == !=, # starts a comment)
+// The alarm mask of a frame has the bit of every rule that holds. Fields are bit fields of the frame with an
+// offset (temperature = bits 0-7 - 20) or the number of set bits of a field; every threshold is moved into
+// the raw field's range when the rules are compiled, so a rule is a shift, a mask and one compare.
+// The interpreter walks the rule table. On x86-64 POSIX systems the rule set is also compiled into machine
+// code: a loop over a batch of frames with the rules as straight-line compares whose results are merged into
+// the mask without branches. The code is written into an anonymous mapping that is made executable (and no
+// longer writable) before it runs; when that is not allowed the interpreter is used.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bitToolkit.h"
+#include "numberParsing.h"
+#include "tankFrame.h"
+
+#if defined(__x86_64__) && (defined(__unix__) || defined(__APPLE__))
+#include <sys/mman.h>
+#define ALARM_RULES_JIT 1
+#endif
+
+#define ALARM_RULES_MAX 512
+#define ALARM_RULES_MAX_FIELD_WIDTH 30          // raw values and thresholds stay signed 32-bit
+#define ALARM_RULES_MAX_THRESHOLD 1000000000
+#define ALARM_RULES_LINE_SIZE 128
+#define ALARM_RULES_CODE_PER_RULE 32            // longest instruction sequence of one rule
+#define ALARM_RULES_CODE_LOOP 64                // loop around the rules
+
+typedef struct {
+    const char* name;
+    uint8_t shift;
+    uint8_t width;
+    int32_t offset;                 // value = raw field + offset
+    bool isBitCount;                // value = number of set bits of the raw field
+} alarmRuleField;
+
+typedef enum {
+    ALARM_RULE_LESS,
+    ALARM_RULE_LESS_EQUAL,
+    ALARM_RULE_GREATER,
+    ALARM_RULE_GREATER_EQUAL,
+    ALARM_RULE_EQUAL,
+    ALARM_RULE_NOT_EQUAL
+} alarmRuleCompare;
+
+typedef struct {
+    uint8_t field;
+    uint8_t compare;
+    uint8_t bit;
+    int32_t rawThreshold;           // threshold - offset, clamped to the raw range
+} alarmRule;
+
+typedef void (*alarmRulesBatch)(const uint32_t* frames, uint32_t* masks, size_t count);
+
+typedef struct {
+    const alarmRuleField* fields;
+    size_t fieldCount;
+    alarmRule rules[ALARM_RULES_MAX];
+    size_t count;
+    size_t errorLine;               // line of the first wrong rule, 0 when none
+    const char* error;
+    uint8_t* code;                  // executable rule code, NULL when the interpreter runs
+    size_t codeSize;
+    alarmRulesBatch compiled;
+} alarmRuleSet;
+
+// The tank frame of basicBinOperators.c: fluid 31-19 | humidity 18-15 | pressure 14-8 | temperature 7-0
+static const alarmRuleField tankFrameFields[] = {
+    { "temperature", 0, 8, -20, false },
+    { "pressure", 8, 7, 1010, false },
+    { "humidity", 15, 4, 0, false },
+    { "humbits", 15, 4, 0, true },
+    { "fluid", 19, 13, 0, false }
+};
+#define TANK_FRAME_FIELD_COUNT (sizeof(tankFrameFields) / sizeof(tankFrameFields[0]))
+
+// The thresholds of tankFrame.h (tank_frame_alarms()), bit n is alarm type n (TANK_FRAME_ALARM_* flags)
+#define TANK_DEFAULT_RULES                                                  \
+    "temperature <= " TANK_FRAME_TEXT(TANK_FRAME_TEMPERATURE_LOW) " 0\n"    \
+    "temperature > " TANK_FRAME_TEXT(TANK_FRAME_TEMPERATURE_HIGH) " 1\n"    \
+    "pressure < " TANK_FRAME_TEXT(TANK_FRAME_PRESSURE_LOW) " 2\n"           \
+    "pressure > " TANK_FRAME_TEXT(TANK_FRAME_PRESSURE_HIGH) " 3\n"          \
+    "humbits > " TANK_FRAME_TEXT(TANK_FRAME_HUMIDITY_BITS_HIGH) " 4\n"      \
+    "fluid <= 0 5\n"                                                        \
+    "fluid > " TANK_FRAME_TEXT(TANK_FRAME_FLUID_LEVEL_HIGH) " 6\n"
+
+// ---------------------------------------------------------------------------
+// Parser and interpreter
+// ---------------------------------------------------------------------------
+
+static inline bool alarm_rules_fail(alarmRuleSet* set, size_t line, const char* error) {
+    set->errorLine = line;
+    set->error = error;
+    return false;
+}
+
+static inline const char* alarm_rules_skip_spaces(const char* text, const char* end) {
+    while (text < end && (*text == ' ' || *text == '\t')) {
+        text++;
+    }
+    return text;
+}
+
+static inline size_t alarm_rules_word(const char* text, const char* end) {
+    size_t length = 0;
+    while (text + length < end && text[length] != ' ' && text[length] != '\t') {
+        length++;
+    }
+    return length;
+}
+
+// Parses one rule line (without its newline); an empty or comment line adds nothing
+static inline bool alarm_rules_parse_line(alarmRuleSet* set, const char* text, size_t length, size_t lineNumber) {
+    static const char* const compares[] = { "<", "<=", ">", ">=", "==", "!=" };
+    const char* end = memchr(text, '#', length);
+    end = (end != NULL) ? end : text + length;
+    while (end > text && (end[-1] == ' ' || end[-1] == '\t')) {
+        end--;
+    }
+    text = alarm_rules_skip_spaces(text, end);
+    if (text == end) {
+        return true;
+    }
+    if (set->count == ALARM_RULES_MAX) {
+        return alarm_rules_fail(set, lineNumber, "too many rules");
+    }
+
+    alarmRule* rule = &set->rules[set->count];
+    size_t word = alarm_rules_word(text, end);
+    size_t field = 0;
+    while (field < set->fieldCount && !(strlen(set->fields[field].name) == word && memcmp(text, set->fields[field].name, word) == 0)) {
+        field++;
+    }
+    if (field == set->fieldCount) {
+        return alarm_rules_fail(set, lineNumber, "unknown field");
+    }
+    rule->field = (uint8_t)field;
+
+    text = alarm_rules_skip_spaces(text + word, end);
+    word = alarm_rules_word(text, end);
+    size_t compare = 0;
+    while (compare < 6 && !(strlen(compares[compare]) == word && memcmp(text, compares[compare], word) == 0)) {
+        compare++;
+    }
+    if (compare == 6) {
+        return alarm_rules_fail(set, lineNumber, "expected < <= > >= == or !=");
+    }
+    rule->compare = (uint8_t)compare;
+
+    text = alarm_rules_skip_spaces(text + word, end);
+    word = alarm_rules_word(text, end);
+    bool isNegative = (word > 1 && text[0] == '-');
+    uint64_t threshold;
+    if (parse_decimal_string(text + isNegative, word - isNegative, ALARM_RULES_MAX_THRESHOLD, &threshold) != PARSE_OK) {
+        return alarm_rules_fail(set, lineNumber, "the threshold is not a number up to 1000000000");
+    }
+
+    text = alarm_rules_skip_spaces(text + word, end);
+    word = alarm_rules_word(text, end);
+    uint64_t bit;
+    if (parse_decimal_string(text, word, 31, &bit) != PARSE_OK || text + word != end) {
+        return alarm_rules_fail(set, lineNumber, "expected an alarm bit from 0 to 31 at the end");
+    }
+    rule->bit = (uint8_t)bit;
+
+    // value op threshold  <=>  raw op threshold - offset; the raw range is 0 .. 2^30 - 1, so clamping to
+    // -1 .. 2^31 - 1 keeps every answer (always/never true) and fits an imm32
+    int64_t raw = (isNegative ? -(int64_t)threshold : (int64_t)threshold) - set->fields[field].offset;
+    rule->rawThreshold = (int32_t)((raw < -1) ? -1 : (raw > INT32_MAX) ? INT32_MAX : raw);
+    set->count++;
+    return true;
+}
+
+static inline int32_t alarm_rules_raw_value(const alarmRuleField* field, uint32_t frame) {
+    uint32_t raw = bit_field_extract32(frame, field->shift, field->width);
+    return (int32_t)(field->isBitCount ? (uint32_t)bit_popcount32(raw) : raw);
+}
+
+// Interpreter: alarm mask of one frame
+static inline uint32_t alarm_rules_classify(const alarmRuleSet* set, uint32_t frame) {
+    uint32_t mask = 0;
+    for (size_t i = 0; i < set->count; i++) {
+        const alarmRule* rule = &set->rules[i];
+        int32_t value = alarm_rules_raw_value(&set->fields[rule->field], frame);
+        bool isTrue;
+        switch (rule->compare) {
+        case ALARM_RULE_LESS:
+            isTrue = value < rule->rawThreshold;
+            break;
+        case ALARM_RULE_LESS_EQUAL:
+            isTrue = value <= rule->rawThreshold;
+            break;
+        case ALARM_RULE_GREATER:
+            isTrue = value > rule->rawThreshold;
+            break;
+        case ALARM_RULE_GREATER_EQUAL:
+            isTrue = value >= rule->rawThreshold;
+            break;
+        case ALARM_RULE_EQUAL:
+            isTrue = value == rule->rawThreshold;
+            break;
+        default:
+            isTrue = value != rule->rawThreshold;
+            break;
+        }
+        mask |= (uint32_t)isTrue << rule->bit;
+    }
+    return mask;
+}
+
+static inline void alarm_rules_interpret(const alarmRuleSet* set, const uint32_t* frames, uint32_t* masks, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        masks[i] = alarm_rules_classify(set, frames[i]);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// x86-64 code generation
+// ---------------------------------------------------------------------------
+
+#if defined(ALARM_RULES_JIT)
+static inline uint8_t* alarm_rules_emit(uint8_t* code, const uint8_t* bytes, size_t count) {
+    memcpy(code, bytes, count);
+    return code + count;
+}
+
+static inline uint8_t* alarm_rules_emit32(uint8_t* code, uint32_t value) {
+    memcpy(code, &value, sizeof(value));     // x86 is little-endian like the host
+    return code + sizeof(value);
+}
+
+// Rules of the same field are next to each other, so each field is extracted once per frame
+static inline int alarm_rules_compare_by_field(const void* first, const void* second) {
+    return (int)((const alarmRule*)first)->field - (int)((const alarmRule*)second)->field;
+}
+
+// Generates void rules(const uint32_t* frames /* rdi */, uint32_t* masks /* rsi */, size_t count /* rdx */)
+// with r8d = frame, r9d = mask, eax = current field, ecx = compare result. No callee-saved register is used.
+static inline size_t alarm_rules_generate(const alarmRuleSet* set, uint8_t* code) {
+    // setl, setle, setg, setge, sete, setne (signed compares)
+    static const uint8_t setConditions[] = { 0x9C, 0x9E, 0x9F, 0x9D, 0x94, 0x95 };
+    alarmRule rules[ALARM_RULES_MAX];
+    uint8_t* start = code;
+
+    memcpy(rules, set->rules, set->count * sizeof(alarmRule));
+    qsort(rules, set->count, sizeof(alarmRule), alarm_rules_compare_by_field);
+
+    code = alarm_rules_emit(code, (const uint8_t[]){ 0x48, 0x85, 0xD2 }, 3);               // test rdx, rdx
+    code = alarm_rules_emit(code, (const uint8_t[]){ 0x0F, 0x84 }, 2);                     // jz done
+    uint8_t* skipLoop = code;
+    code += 4;
+    uint8_t* loop = code;
+    code = alarm_rules_emit(code, (const uint8_t[]){ 0x44, 0x8B, 0x07 }, 3);               // mov r8d, [rdi]
+    code = alarm_rules_emit(code, (const uint8_t[]){ 0x45, 0x31, 0xC9 }, 3);               // xor r9d, r9d
+
+    int currentField = -1;
+    for (size_t i = 0; i < set->count; i++) {
+        const alarmRule* rule = &rules[i];
+        const alarmRuleField* field = &set->fields[rule->field];
+        if (rule->field != currentField) {
+            currentField = rule->field;
+            code = alarm_rules_emit(code, (const uint8_t[]){ 0x44, 0x89, 0xC0 }, 3);       // mov eax, r8d
+            if (field->shift > 0) {
+                code = alarm_rules_emit(code, (const uint8_t[]){ 0xC1, 0xE8, field->shift }, 3);  // shr eax, shift
+            }
+            code = alarm_rules_emit(code, (const uint8_t[]){ 0x25 }, 1);                   // and eax, mask
+            code = alarm_rules_emit32(code, bit_mask32(field->width));
+            if (field->isBitCount) {
+                code = alarm_rules_emit(code, (const uint8_t[]){ 0xF3, 0x0F, 0xB8, 0xC0 }, 4);  // popcnt eax, eax
+            }
+        }
+        code = alarm_rules_emit(code, (const uint8_t[]){ 0x31, 0xC9 }, 2);                 // xor ecx, ecx
+        code = alarm_rules_emit(code, (const uint8_t[]){ 0x3D }, 1);                       // cmp eax, threshold
+        code = alarm_rules_emit32(code, (uint32_t)rule->rawThreshold);
+        code = alarm_rules_emit(code, (const uint8_t[]){ 0x0F, setConditions[rule->compare], 0xC1 }, 3);  // setcc cl
+        if (rule->bit > 0) {
+            code = alarm_rules_emit(code, (const uint8_t[]){ 0xC1, 0xE1, rule->bit }, 3);  // shl ecx, bit
+        }
+        code = alarm_rules_emit(code, (const uint8_t[]){ 0x41, 0x09, 0xC9 }, 3);           // or r9d, ecx
+    }
+
+    code = alarm_rules_emit(code, (const uint8_t[]){ 0x44, 0x89, 0x0E }, 3);               // mov [rsi], r9d
+    code = alarm_rules_emit(code, (const uint8_t[]){ 0x48, 0x83, 0xC7, 0x04 }, 4);         // add rdi, 4
+    code = alarm_rules_emit(code, (const uint8_t[]){ 0x48, 0x83, 0xC6, 0x04 }, 4);         // add rsi, 4
+    code = alarm_rules_emit(code, (const uint8_t[]){ 0x48, 0xFF, 0xCA }, 3);               // dec rdx
+    code = alarm_rules_emit(code, (const uint8_t[]){ 0x0F, 0x85 }, 2);                     // jnz loop
+    code = alarm_rules_emit32(code, (uint32_t)(int32_t)(loop - (code + 4)));
+    alarm_rules_emit32(skipLoop, (uint32_t)(int32_t)(code - (skipLoop + 4)));
+    code = alarm_rules_emit(code, (const uint8_t[]){ 0xC3 }, 1);                           // done: ret
+    return (size_t)(code - start);
+}
+
+// Compiles the rule set into executable code, false when the system refuses executable memory
+// or the CPU lacks POPCNT for bit count rules (the interpreter is used then)
+static inline bool alarm_rules_jit(alarmRuleSet* set) {
+    bool hasBitCount = false;
+    for (size_t i = 0; i < set->count; i++) {
+        hasBitCount |= set->fields[set->rules[i].field].isBitCount;
+    }
+    if (hasBitCount && !__builtin_cpu_supports("popcnt")) {
+        return false;
+    }
+
+    size_t size = ALARM_RULES_CODE_LOOP + set->count * ALARM_RULES_CODE_PER_RULE;
+    void* code = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code == MAP_FAILED) {
+        return false;
+    }
+    alarm_rules_generate(set, code);
+    // Writable or executable, never both
+    if (mprotect(code, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(code, size);
+        return false;
+    }
+    set->code = code;
+    set->codeSize = size;
+    set->compiled = (alarmRulesBatch)code;
+    return true;
+}
+#endif
+
+// ---------------------------------------------------------------------------
+// Rule sets
+// ---------------------------------------------------------------------------
+
+// Parses the rules; with useJit the set is also compiled to machine code where possible.
+// On failure set->error and set->errorLine say what is wrong.
+static inline bool alarm_rules_compile(alarmRuleSet* set, const char* text, size_t length,
+                                       const alarmRuleField* fields, size_t fieldCount, bool useJit) {
+    memset(set, 0, sizeof(*set));
+    set->fields = fields;
+    set->fieldCount = fieldCount;
+    for (size_t i = 0; i < fieldCount; i++) {
+        if (fields[i].width == 0 || fields[i].width > ALARM_RULES_MAX_FIELD_WIDTH || fields[i].shift + fields[i].width > 32) {
+            return alarm_rules_fail(set, 0, "a field is wider than 30 bits or outside the frame");
+        }
+    }
+
+    const char* end = text + length;
+    size_t lineNumber = 0;
+    while (text < end) {
+        size_t lineLength = 0;
+        const char* nextLine = split_line(text, end, &lineLength);
+        if (!alarm_rules_parse_line(set, text, lineLength, ++lineNumber)) {
+            return false;
+        }
+        text = nextLine;
+    }
+
+#if defined(ALARM_RULES_JIT)
+    if (useJit) {
+        alarm_rules_jit(set);
+    }
+#else
+    (void)useJit;
+#endif
+    return true;
+}
+
+// Alarm masks of a batch of frames, through the compiled code when there is some
+static inline void alarm_rules_run(const alarmRuleSet* set, const uint32_t* frames, uint32_t* masks, size_t count) {
+    if (set->compiled != NULL) {
+        set->compiled(frames, masks, count);
+    }
+    else {
+        alarm_rules_interpret(set, frames, masks, count);
+    }
+}
+
+static inline void alarm_rules_free(alarmRuleSet* set) {
+#if defined(ALARM_RULES_JIT)
+    if (set->code != NULL) {
+        munmap(set->code, set->codeSize);
+    }
+#endif
+    set->code = NULL;
+    set->compiled = NULL;
+}
+
+#endif // ALARM_RULES_H
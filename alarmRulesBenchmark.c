@@ -0,0 +1,155 @@
+/*
+ * Benchmark of alarmRules.h: alarm masks of the same random frames from the hand-written thresholds
+ * (classifyAlarms() of basicBinOperators.c), the rule interpreter and the rules compiled to x86-64 code,
+ * for the default rule set and for a site with hundreds of rules. The masks of all variants are compared.
+ *
+ * Build:   gcc -O2 alarmRulesBenchmark.c -o alarmRulesBenchmark
+ * Output:  nanoseconds per frame for every variant and the size of the compiled code.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "alarmRules.h"
+
+#define BENCH_FRAMES 4096
+#define BENCH_ROUNDS 2048
+#define BENCH_SITE_RULES 256
+
+static uint32_t frames[BENCH_FRAMES];
+static uint32_t masks[BENCH_FRAMES];
+static uint32_t expected[BENCH_FRAMES];
+static char siteRules[BENCH_SITE_RULES * ALARM_RULES_LINE_SIZE];
+
+// The thresholds of classifyAlarms(), written out by hand
+static uint32_t hand_written_alarms(uint32_t frame) {
+    int temperature = (int)(frame & 0xFF) - 20;
+    int pressure = (int)((frame >> 8) & 0x7F) + 1010;
+    int humidityBits = bit_popcount32((frame >> 15) & 0xF);
+    int fluidLevel = (int)(frame >> 19);
+    uint32_t alarms = 0;
+
+    if (temperature <= 4) {
+        alarms |= 0x01;
+    }
+    else if (temperature > 100) {
+        alarms |= 0x02;
+    }
+    if (pressure < 1013) {
+        alarms |= 0x04;
+    }
+    else if (pressure > 1135) {
+        alarms |= 0x08;
+    }
+    if (humidityBits > 2) {
+        alarms |= 0x10;
+    }
+    if (fluidLevel <= 0) {
+        alarms |= 0x20;
+    }
+    else if (fluidLevel > 8000) {
+        alarms |= 0x40;
+    }
+    return alarms;
+}
+
+static double now_seconds(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double)time.tv_sec + (double)time.tv_nsec * 1e-9;
+}
+
+static void report(const char* rules, const char* variant, double start) {
+    double seconds = now_seconds() - start;
+    uint64_t checksum = 0;
+    for (size_t i = 0; i < BENCH_FRAMES; i++) {
+        checksum = checksum * 31 + masks[i];
+    }
+    printf("%-14s %-13s %8.3f ns/frame   (checksum %016llx)\n", rules, variant,
+        seconds * 1e9 / ((double)BENCH_FRAMES * BENCH_ROUNDS), (unsigned long long)checksum);
+}
+
+static bool same_masks(const char* rules, const char* variant) {
+    if (memcmp(masks, expected, sizeof(masks)) != 0) {
+        printf("%s: %s gives other masks than the interpreter\n", rules, variant);
+        return false;
+    }
+    return true;
+}
+
+// Interpreter and compiled code over the same frames, both checked against the interpreter's masks
+static bool benchmark_rules(const char* name, const char* text) {
+    alarmRuleSet interpreted;
+    alarmRuleSet compiled;
+    if (!alarm_rules_compile(&interpreted, text, strlen(text), tankFrameFields, TANK_FRAME_FIELD_COUNT, false)
+        || !alarm_rules_compile(&compiled, text, strlen(text), tankFrameFields, TANK_FRAME_FIELD_COUNT, true)) {
+        printf("%s: rule %zu: %s\n", name, interpreted.errorLine, interpreted.error);
+        return false;
+    }
+    alarm_rules_interpret(&interpreted, frames, expected, BENCH_FRAMES);
+
+    double start = now_seconds();
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        alarm_rules_run(&interpreted, frames, masks, BENCH_FRAMES);
+    }
+    report(name, "interpreter", start);
+
+    bool isSame = true;
+    if (compiled.compiled == NULL) {
+        printf("%-14s %-13s not available on this system\n", name, "jit");
+    }
+    else {
+        start = now_seconds();
+        for (int round = 0; round < BENCH_ROUNDS; round++) {
+            alarm_rules_run(&compiled, frames, masks, BENCH_FRAMES);
+        }
+        report(name, "jit", start);
+        printf("%-14s %zu rules, %zu bytes of executable code\n", name, compiled.count, compiled.codeSize);
+        isSame = same_masks(name, "jit");
+    }
+    alarm_rules_free(&interpreted);
+    alarm_rules_free(&compiled);
+    return isSame;
+}
+
+int main(void) {
+    static const char* const fieldNames[] = { "temperature", "pressure", "humidity", "humbits", "fluid" };
+    static const char* const compares[] = { "<", "<=", ">", ">=", "==", "!=" };
+    static const int fieldRanges[][2] = { { -20, 235 }, { 1010, 1137 }, { 0, 15 }, { 0, 4 }, { 0, 8191 } };
+    bool isSame = true;
+
+    srand(2137);
+    for (size_t i = 0; i < BENCH_FRAMES; i++) {
+        frames[i] = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+    }
+
+    // Hand-written thresholds against the default rules
+    double start = now_seconds();
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        for (size_t i = 0; i < BENCH_FRAMES; i++) {
+            masks[i] = hand_written_alarms(frames[i]);
+        }
+        __asm__ volatile("" : : "r"(masks) : "memory");
+    }
+    report("default", "hand-written", start);
+    memcpy(expected, masks, sizeof(masks));
+    isSame &= benchmark_rules("default", TANK_DEFAULT_RULES);
+    for (size_t i = 0; i < BENCH_FRAMES; i++) {
+        isSame &= (masks[i] == hand_written_alarms(frames[i]));
+    }
+
+    // A site with many rules on every field
+    size_t used = 0;
+    for (int i = 0; i < BENCH_SITE_RULES; i++) {
+        int field = rand() % 5;
+        int threshold = fieldRanges[field][0] + rand() % (fieldRanges[field][1] - fieldRanges[field][0] + 1);
+        used += (size_t)snprintf(siteRules + used, sizeof(siteRules) - used, "%s %s %d %d\n",
+            fieldNames[field], compares[rand() % 6], threshold, rand() % 32);
+    }
+    isSame &= benchmark_rules("site", siteRules);
+
+    return isSame ? 0 : 1;
+}
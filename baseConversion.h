@@ -0,0 +1,160 @@
+#ifndef BASE_CONVERSION_H
+#define BASE_CONVERSION_H
+
+// Numbers in any base from 2 to 36 (digits 0-9 then a-z, e.g. octal or base-36 IDs).
+// Every base has its own writer with the base as a compile-time constant, so the compiler replaces
+// each division by the base with a multiplication by its reciprocal and a shift; bases that are
+// powers of two only use shifts and masks. The value is cut into chunks of base^k (the largest
+// power below 2^32): one 64-bit division per chunk, then k digits from 32-bit arithmetic.
+// On 32-bit MCUs this leaves at most a few 64-bit library divisions per number.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "bitToolkit.h"
+#include "numberParsing.h"
+
+#define MIN_NUMBER_BASE 2
+#define MAX_NUMBER_BASE 36
+// Longest text of a 64-bit number (base 2)
+#define MAX_BASE_TEXT_64 64
+
+static const char baseDigits[MAX_NUMBER_BASE] = {
+    '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h',
+    'i', 'j', 'k', 'l', 'm', 'n', 'o', 'p', 'q', 'r', 's', 't', 'u', 'v', 'w', 'x', 'y', 'z'
+};
+
+// Digits per 32-bit chunk and base^digits for every base, used by the parser
+typedef struct {
+    uint8_t digits;
+    uint32_t power;
+} baseChunkSize;
+
+static const baseChunkSize baseChunkSizes[MAX_NUMBER_BASE + 1] = {
+    { 0, 0u }, { 0, 0u },
+    { 31, 2147483648u }, { 20, 3486784401u }, { 15, 1073741824u }, { 13, 1220703125u },
+    { 12, 2176782336u }, { 11, 1977326743u }, { 10, 1073741824u }, { 10, 3486784401u },
+    { 9, 1000000000u }, { 9, 2357947691u }, { 8, 429981696u }, { 8, 815730721u },
+    { 8, 1475789056u }, { 8, 2562890625u }, { 7, 268435456u }, { 7, 410338673u },
+    { 7, 612220032u }, { 7, 893871739u }, { 7, 1280000000u }, { 7, 1801088541u },
+    { 7, 2494357888u }, { 7, 3404825447u }, { 6, 191102976u }, { 6, 244140625u },
+    { 6, 308915776u }, { 6, 387420489u }, { 6, 481890304u }, { 6, 594823321u },
+    { 6, 729000000u }, { 6, 887503681u }, { 6, 1073741824u }, { 6, 1291467969u },
+    { 6, 1544804416u }, { 6, 1838265625u }, { 6, 2176782336u }
+};
+
+// Bases that are powers of two: X(base, bits per digit)
+#define BASE_POWER_OF_TWO_LIST(X) \
+    X(2, 1) X(4, 2) X(8, 3) X(16, 4) X(32, 5)
+
+// All other bases: X(base, digits per chunk, base^digits)
+#define BASE_CHUNKED_LIST(X) \
+    X(3, 20, 3486784401u) X(5, 13, 1220703125u) X(6, 12, 2176782336u) X(7, 11, 1977326743u) \
+    X(9, 10, 3486784401u) X(10, 9, 1000000000u) X(11, 9, 2357947691u) X(12, 8, 429981696u) \
+    X(13, 8, 815730721u) X(14, 8, 1475789056u) X(15, 8, 2562890625u) X(17, 7, 410338673u) \
+    X(18, 7, 612220032u) X(19, 7, 893871739u) X(20, 7, 1280000000u) X(21, 7, 1801088541u) \
+    X(22, 7, 2494357888u) X(23, 7, 3404825447u) X(24, 6, 191102976u) X(25, 6, 244140625u) \
+    X(26, 6, 308915776u) X(27, 6, 387420489u) X(28, 6, 481890304u) X(29, 6, 594823321u) \
+    X(30, 6, 729000000u) X(31, 6, 887503681u) X(33, 6, 1291467969u) X(34, 6, 1544804416u) \
+    X(35, 6, 1838265625u) X(36, 6, 2176782336u)
+
+// format_base<N>_u64() for powers of two: the digit count comes from the highest set bit
+#define BASE_POWER_OF_TWO_WRITER(base, bitsPerDigit)                                    \
+    static inline size_t format_base##base##_u64(uint64_t value, char* out) {           \
+        int digits = (64 - bit_clz64(value | 1) + (bitsPerDigit) - 1) / (bitsPerDigit); \
+        for (int i = digits - 1; i >= 0; i--) {                                         \
+            out[i] = baseDigits[value & ((base) - 1)];                                  \
+            value >>= (bitsPerDigit);                                                   \
+        }                                                                               \
+        return (size_t)digits;                                                          \
+    }
+
+// format_base<N>_u64() for other bases: whole chunks from the end, then the leading digits
+#define BASE_CHUNKED_WRITER(base, digitsPerChunk, chunk)                                \
+    static inline size_t format_base##base##_u64(uint64_t value, char* out) {           \
+        char digits[MAX_BASE_TEXT_64];                                                  \
+        char* position = digits + MAX_BASE_TEXT_64;                                     \
+        while (value >= (chunk)) {                                                      \
+            uint64_t quotient = value / (chunk);                                        \
+            uint32_t part = (uint32_t)(value - quotient * (chunk));                     \
+            for (int i = 0; i < (digitsPerChunk); i++) {                                \
+                *--position = baseDigits[part % (base)];                                \
+                part /= (base);                                                         \
+            }                                                                           \
+            value = quotient;                                                           \
+        }                                                                               \
+        uint32_t part = (uint32_t)value;                                                \
+        do {                                                                            \
+            *--position = baseDigits[part % (base)];                                    \
+            part /= (base);                                                             \
+        } while (part != 0);                                                            \
+        size_t length = (size_t)(digits + MAX_BASE_TEXT_64 - position);                 \
+        memcpy(out, position, length);                                                  \
+        return length;                                                                  \
+    }
+
+BASE_POWER_OF_TWO_LIST(BASE_POWER_OF_TWO_WRITER)
+BASE_CHUNKED_LIST(BASE_CHUNKED_WRITER)
+
+// Writes the value in the given base (2..36, lowercase, no prefix), returns the length or 0 for an invalid base
+static inline size_t format_base_u64(uint64_t value, unsigned base, char* out) {
+    switch (base) {
+#define BASE_WRITER_CASE(base, ...) case base: return format_base##base##_u64(value, out);
+    BASE_POWER_OF_TWO_LIST(BASE_WRITER_CASE)
+    BASE_CHUNKED_LIST(BASE_WRITER_CASE)
+#undef BASE_WRITER_CASE
+    default:
+        return 0;
+    }
+}
+
+// Value of a digit in any base up to 36 (either case), MAX_NUMBER_BASE or more for other characters
+static inline unsigned base_digit_value(char character) {
+    unsigned digit = (unsigned)(uint8_t)(character - '0');
+    if (digit <= 9) {
+        return digit;
+    }
+    // Setting bit 5 turns 'A'..'Z' into 'a'..'z'
+    digit = (unsigned)(uint8_t)((character | 0x20) - 'a');
+    return (digit < 26) ? digit + 10 : MAX_NUMBER_BASE;
+}
+
+// Parses an unsigned number in the given base (no prefix, no terminator needed). Digits are collected
+// in 32-bit chunks of baseChunkSizes[base].digits, each chunk costs one 64-bit multiply-add.
+static inline numberParseStatus parse_base_string(const char* text, size_t length, unsigned base, uint64_t* value) {
+    if (length == 0 || base < MIN_NUMBER_BASE || base > MAX_NUMBER_BASE) {
+        return PARSE_INVALID;
+    }
+
+    uint64_t result = 0;
+    size_t chunkDigits = baseChunkSizes[base].digits;
+    for (size_t start = 0; start < length; start += chunkDigits) {
+        size_t count = (length - start < chunkDigits) ? length - start : chunkDigits;
+        uint32_t part = 0;
+        uint64_t scale = 1;
+        for (size_t i = 0; i < count; i++) {
+            unsigned digit = base_digit_value(text[start + i]);
+            if (digit >= base) {
+                return PARSE_INVALID;
+            }
+            part = part * base + digit;
+            scale *= base;
+        }
+        if (result > (UINT64_MAX - part) / scale) {
+            // Keep checking the rest of the text, a stray character makes the line invalid rather than too big
+            for (size_t i = start + count; i < length; i++) {
+                if (base_digit_value(text[i]) >= base) {
+                    return PARSE_INVALID;
+                }
+            }
+            return PARSE_OVERFLOW;
+        }
+        result = result * scale + part;
+    }
+    *value = result;
+    return PARSE_OK;
+}
+
+#endif // BASE_CONVERSION_H
@@ -8,8 +8,61 @@
  *
  * The microcontroller sends this data as a hexadecimal string, which the user inputs.
  * The program parses the string into a number and decodes each sensor value bit by bit.
+ *
+ * Started with "--frames" the program reads frames (one hexadecimal number per line) from stdin instead and
+ * prints every frame in binary with separators between the fields, followed by the decoded values:
+ *   0008a318 = 0000000000001 | 0001 | 0100011 | 00011000 : fluid 1 | humidity 1 | pressure 1045 | temperature 4
+ *
+ * Started with "--fleet [topK] [reportEvery] [threads]" it reads "<device> <frame>" lines from a whole fleet
+ * of tanks and reports which devices alarm most often. Memory stays bounded however many devices there are:
+ * a Space-Saving summary finds the top devices and a Count-Min sketch estimates alarms per device and type.
+ * Given a snapshot file ("--fleet 10 1000000 4 fleet.snap") the sketches are checkpointed into it every million
+ * frames, and a restarted tracker resumes from the last checkpoint instead of starting from zero.
+ *
+ * Started with "--trend [pointsPerWindow] [windowFrames]" it reads the same "<device> <frame>" lines and prints
+ * a downsampled fluid level and pressure series per device for plotting ("<device> <field> <frame number> <value>").
+ * Largest-Triangle-Three-Buckets keeps pointsPerWindow frames of every windowFrames (100 of 100000 by default),
+ * choosing the ones that keep peaks and edges of the curve.
+ *
+ * Started with "--journal <file> [syncMs]" it appends every alarm of the "<device> <frame>" lines to a binary
+ * journal of fixed-size records, synced to disk once per syncMs (group commit). "--scan-journal <file> [device]"
+ * reads such a journal back: alarms per type, or all records of one device.
+ *
+ * "--archive <file>" in front of any mode ("--archive raw.log --frames") appends the raw input to an archive file
+ * while the mode decodes it. On Linux the bytes are duplicated with tee() and moved with splice(), so they never
+ * pass through user space for the archive. An archive named *.lz4 is compressed.
+ *
+ * The modes that read frame lines (--frames, --fleet, --trend, --journal, --query, --rules, --plugin) also read
+ * gzip-compressed input ("< frames.log.gz"): built with -DGZIP_INPUT_USE_ZLIB -lz a thread inflates it while the
+ * mode decodes (gzipInput.h).
+ *
+ * "--compress" in front of any mode compresses its output into an LZ4 frame (1 MB blocks compressed on worker
+ * threads), "--decompress" turns such a file (or any .lz4 file with independent blocks) back into text.
+ *
+ * Started with "--query <query>" it answers ad-hoc questions about "<device> <frame>" lines, e.g.
+ *   --query "mean(pressure), count where temperature > 80 and humbits >= 2 by seq / 360000"
+ * The frames are decoded into columns (device, frame, seq, temperature, pressure, humidity, humbits, fluid,
+ * alarms) a batch at a time, and the compiled query filters and aggregates whole batches (batchQuery.h).
+ * seq numbers the frames from 0, so at 100 Hz "by seq / 360000" groups by hour.
+ *
+ * Started with "--rules <file> [interpret]" it classifies "<device> <frame>" lines with the site's own alarm rules
+ * ("pressure > 1135 3", one per line, alarmRules.h) instead of the fixed thresholds, and prints
+ * "<device> <frame> <alarm mask>" for every frame with an alarm. On x86-64 the rules are compiled to machine code,
+ * "interpret" keeps the table interpreter. "--rules default" uses the thresholds of tankFrame.h.
+ *
+ * Started with "--plugin <library.so> [argument]" it hands batches of decoded "<device> <frame>" lines to a site's
+ * plugin (framePlugin.h, loaded with dlopen), which may add its own alarms and a derived value per frame, and prints
+ * "<device> <frame> <alarm mask> [value]" for the frames with alarms (every frame when the plugin gives values).
+ *
+ * Alarms are warnings or critical (overpressure, empty tank). --frames, --rules and --plugin batch their output
+ * for throughput, but a critical frame is reported the moment its line is read, with one unbuffered write of
+ * "critical [<device>] <frame> <alarm names>" to stderr, or to a file or pipe given as "--critical <file>" in
+ * front of the mode.
  */
 
+#if defined(__linux__)
+#define _GNU_SOURCE								// tee() and splice() for --archive
+#endif
 
 #include<stdio.h>
 #include<stdint.h>
@@ -19,16 +72,161 @@
 #include<string.h>
 #include<stdlib.h>
 
+#include "bitToolkit.h"
+#include "numberParsing.h"
+#include "numberFormatting.h"
+#include "heavyHitters.h"
+#include "downsampler.h"
+#include "stateSnapshot.h"
+#include "alarmJournal.h"
+#include "rawArchive.h"
+#include "gzipInput.h"
+#include "lz4Block.h"
+#include "batchQuery.h"
+#include "alarmRules.h"
+#include "framePlugin.h"
+#include "outputCache.h"
+#include "tankFrame.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#define FLEET_HAS_THREADS			1
+#define OUTPUT_HAS_COMPRESSION		1
+#endif
+
 #define TEMPERATURE_BITS_MASK		0xff
 #define PRESSURE_BITS_SHIFT			8
 #define PRESSURE_BITS_MASK			0x7f
 #define HUMIDITY_BITS_SHIFT			15
 #define HUMIDITY_BITS_MASK			0xf
 #define FLUID_LEVEL_BITS_SHIFT		19
+#define FLUID_LEVEL_BITS_MASK		0x1fff
 #define BITS_TO_BYTES				0x8
 #define MAX_HEX_DIGITS				8
 #define HEX_INPUT_BUFFER_SIZE		9			// 8 bits + 1 for \0, SIZE_OF_DATA + 1
-#define HUMIDITY_BITS				4
+#define FRAME_FIELD_COUNT			3			// separators between the 4 fields
+#define FRAME_INPUT_LINE_SIZE		64
+#define FRAME_OUTPUT_LINE_SIZE		160			// longest annotated frame line
+#define FRAME_OUTPUT_BUFFER_SIZE	65536
+#define FRAME_CACHE_SLOTS			1024		// formatted --frames lines kept by raw frame
+#define REPORT_BLOCK_SIZE			512			// decoded values and alarm messages of one frame
+#define REPORT_CACHE_SLOTS			1024
+
+#define ALARM_TEMPERATURE_LOW		TANK_FRAME_ALARM_TEMPERATURE_LOW	// thresholds and flags of tankFrame.h
+#define ALARM_TEMPERATURE_HIGH		TANK_FRAME_ALARM_TEMPERATURE_HIGH
+#define ALARM_PRESSURE_LOW			TANK_FRAME_ALARM_PRESSURE_LOW
+#define ALARM_PRESSURE_HIGH			TANK_FRAME_ALARM_PRESSURE_HIGH
+#define ALARM_HUMIDITY				TANK_FRAME_ALARM_HUMIDITY
+#define ALARM_TANK_EMPTY			TANK_FRAME_ALARM_TANK_EMPTY
+#define ALARM_FLUID_LEVEL_HIGH		TANK_FRAME_ALARM_FLUID_LEVEL_HIGH
+#define ALARM_TYPES					TANK_FRAME_ALARM_TYPES
+#define ALARM_KEY_BITS				3			// Count-Min key: device << 3 | alarm type, type 7 counts all alarms
+#define ALARM_KEY_ALL				ALARM_TYPES
+#define ALARM_CRITICAL				TANK_FRAME_ALARM_CRITICAL	// all other alarm types are warnings
+#define ALARM_PREFIX(flag)			(((flag) & ALARM_CRITICAL) ? "Critical alarm!" : "Alarm!")
+#define CRITICAL_OUTPUT_LINE_SIZE	96
+
+#define FLEET_DEFAULT_TOP			10
+#define FLEET_DEFAULT_REPORT_EVERY	1000000
+#define FLEET_DEFAULT_THREADS		4
+#define FLEET_MAX_THREADS			64
+#define FLEET_SUMMARY_CAPACITY		1024		// devices tracked by Space-Saving
+#define FLEET_SKETCH_WIDTH			16384
+#define FLEET_SKETCH_DEPTH			4
+#define FLEET_BATCH_FRAMES			65536
+#define FLEET_SNAPSHOT_EVERY		1000000
+
+#define JOURNAL_DEFAULT_SYNC_MS		10
+
+#define COMPRESSION_THREADS			4
+#define COMPRESSION_READ_SIZE		65536
+
+#define TREND_DEFAULT_POINTS		100
+#define TREND_DEFAULT_WINDOW		100000		// 1000 s of 100 Hz frames
+#define TREND_MIN_DEVICE_SLOTS		64
+#define TREND_OUTPUT_LINE_SIZE		64
+
+#define RULES_BATCH_FRAMES			4096
+#define RULES_MAX_FILE_SIZE			(1024 * 1024)
+#define RULES_OUTPUT_LINE_SIZE		32
+
+#define PLUGIN_BATCH_FRAMES			4096
+#define PLUGIN_OUTPUT_LINE_SIZE		64
+
+#define QUERY_FRAME_COLUMNS			9
+#define QUERY_COLUMN_DEVICE			0
+#define QUERY_COLUMN_FRAME			1
+#define QUERY_COLUMN_SEQ			2
+#define QUERY_COLUMN_TEMPERATURE	3
+#define QUERY_COLUMN_PRESSURE		4
+#define QUERY_COLUMN_HUMIDITY		5
+#define QUERY_COLUMN_HUMIDITY_BITS	6
+#define QUERY_COLUMN_FLUID_LEVEL	7
+#define QUERY_COLUMN_ALARMS			8
+
+static const char* alarmTypeNames[ALARM_TYPES] = { "temp-low", "temp-high", "press-low", "press-high", "humidity", "empty", "overfill" };
+// Reports of the interactive mode by raw frame
+static outputCache frameReportCache;
+// Unbuffered stream of the critical alarm lines (stderr unless "--critical <file>" is given)
+static FILE* criticalAlarmOutput = NULL;
+// Set once stdin has been checked for gzip input, the mode then runs on the (decompressed) stdin
+static bool isInputChecked = false;
+static const char* const queryColumnNames[QUERY_FRAME_COLUMNS] = { "device", "frame", "seq", "temperature", "pressure",
+	"humidity", "humbits", "fluid", "alarms" };
+
+typedef enum {
+	ALARM_SEVERITY_NONE,
+	ALARM_SEVERITY_WARNING,
+	ALARM_SEVERITY_CRITICAL
+} alarmSeverity;
+
+typedef struct {
+	uint32_t device;
+	uint32_t data;
+} fleetFrame;
+
+// Sketches of one worker thread, merged into the fleet totals after every batch
+typedef struct {
+	spaceSaving devices;
+	countMinSketch alarms;
+	const fleetFrame* frames;
+	size_t count;
+} fleetWorker;
+
+// Start of a fleet checkpoint, followed by the Space-Saving counters and table and the Count-Min counters
+typedef struct {
+	uint64_t frames;
+	uint64_t devicesTotal;
+	uint64_t devicesUsed;
+	uint64_t alarmsTotal;
+} fleetSnapshotHeader;
+
+// Output of a mode on its way from the pipe into an LZ4 frame
+typedef struct {
+	int input;					// read end of the mode's stdout pipe, -1 once closed
+	FILE* output;
+	lz4FrameWriter writer;
+	bool isRunning;
+} outputCompressor;
+
+// Downsampled series of one device, x is the number of the device's frame
+typedef struct {
+	uint32_t device;
+	uint64_t frames;
+	lttbSeries fluidLevel;
+	lttbSeries pressure;
+} trendDevice;
+
+// Devices in arrival order, found through an open addressing table that doubles when half full
+typedef struct {
+	trendDevice* devices;
+	size_t count;
+	size_t capacity;
+	uint32_t* slots;
+	size_t slotMask;
+	uint32_t bucketSize;
+} trendTable;
 
 
  /**
@@ -96,21 +294,257 @@
 	getFluidLevel
 	@brief Extracts the fluid level value from the 32-bit data.
 	@param data The full 32-bit input data.
+	@param fluidLevelBits Mask of the 13 fluid level bits after the shift.
 	@param shift Number of bits to shift to reach fluid level field.
 	@return Fluid level in liters as an unsigned 16-bit integer.
 
-	alarm
-	@brief Prints an alarm message if specific thresholds are exceeded (e.g., humidity bits).
+	formatAlarms
+	@brief Writes an alarm message for every exceeded threshold (e.g., humidity bits) into a buffer.
 	@param temperature Temperature value.
 	@param pressure Pressure value.
 	@param humidity Humidity raw bit value.
 	@param fluidLevel Fluid level in liters.
+	@param output Buffer for the messages.
+	@param size Size of the buffer.
+	@return Number of characters written.
+
+	formatFrameReport
+	@brief Writes what the interactive mode shows for a frame (the converted number, every decoded value and
+	the alarm messages) into a buffer. The text depends only on the frame, so it is cached by raw frame value.
+	@param data The full 32-bit input data.
+	@param output Buffer with room for REPORT_BLOCK_SIZE characters.
+	@param alarms Receives the ALARM_* flags of the frame.
+	@return Number of characters written.
+
+	classifyAlarms
+	@brief Checks the thresholds used by formatAlarms() without formatting anything (tank_frame_classify(), the
+	thresholds are defined in tankFrame.h only).
+	@param temperature Temperature value.
+	@param pressure Pressure value.
+	@param humidity Humidity raw bit value.
+	@param fluidLevel Fluid level in liters.
+	@return ALARM_* flags of all exceeded thresholds, 0 when everything is fine.
+
+	getAlarmSeverity
+	@brief Severity of a set of alarms: critical when any of them is in ALARM_CRITICAL (overpressure, empty tank).
+	@param alarms ALARM_* flags.
+	@return The highest severity of the alarms, ALARM_SEVERITY_NONE without alarms.
+
+	reportCriticalAlarm
+	@brief Fast lane of the batching modes: called with the alarms of a frame as soon as its line is read and,
+	when one of them is critical, writes "critical [<device>] <frame> <alarm names>" at once with one unbuffered
+	write, while the routine output of the mode stays batched.
+	@param hasDevice true when the line had a device number.
+	@param device Device number.
+	@param frame The raw frame.
+	@param alarms Alarm mask of the frame as the mode classified it (thresholds, rule set or plugin decoding).
+	@return true when the frame had a critical alarm.
+
+	dumpFrames
+	@brief Reads hexadecimal frames (one per line) and prints each one in binary with separators at the
+	field boundaries (fluid 31-19 | humidity 18-15 | pressure 14-8 | temperature 7-0) and its decoded values.
+	Lines are collected in a large buffer and written at once, so millions of frames can be dumped. The line of
+	every raw frame value is kept in a direct-mapped cache, so a repeated frame costs one memcpy.
+	@param input Stream with the frames.
+	@return 0 on success, 1 when the field layout or the cache cannot be prepared or the output cannot be written.
+
+	formatFrame
+	@brief Writes one annotated frame line (with the newline) into a buffer.
+	@param data The full 32-bit input data.
+	@param layout Binary layout with the field separators.
+	@param output Buffer with room for FRAME_OUTPUT_LINE_SIZE characters.
+	@return Number of characters written.
+
+	parseDeviceFrameLine
+	@brief Parses a "<device> <frame>" line: a decimal device number and a hexadecimal frame, both 32 bits.
+	@param line The line.
+	@param length Length of the line without the line end.
+	@param device Receives the device number.
+	@param frame Receives the frame.
+	@return true when the line is a valid "<device> <frame>" line.
+
+	trackFleetAlarms
+	@brief Reads "<device> <frame>" lines and tracks the devices that alarm most often. Frames are
+	classified in batches by worker threads with their own sketches, which are merged afterwards.
+	@param input Stream with the frames.
+	@param top Number of devices in every report.
+	@param reportEvery Number of frames between reports (a final report is always printed).
+	@param threads Number of worker threads.
+	@param snapshotPath File for checkpoints of the sketches (resumed from when valid), NULL for none.
+	@return 0 on success, 1 when the sketches or the snapshot file cannot be prepared or a report cannot be written.
+
+	processFleetBatch
+	@brief Worker thread body: classifies the frames of a worker and counts their alarms.
+	@param worker Pointer to the fleetWorker.
+	@return NULL.
+
+	printFleetReport
+	@brief Prints the devices with the most alarms and their alarms per type.
+	@param devices Merged Space-Saving summary.
+	@param alarms Merged Count-Min sketch.
+	@param frames Number of frames seen so far.
+	@param top Number of devices to print.
+
+	fleetSnapshotSize
+	@brief Size of a fleet checkpoint: header, Space-Saving counters and table, Count-Min counters.
+	@param devices Space-Saving summary.
+	@param alarms Count-Min sketch.
+	@return Size in bytes.
+
+	saveFleetSnapshot
+	@brief Copies the merged sketches into a checkpoint payload.
+	@param payload Payload of fleetSnapshotSize() bytes.
+	@param devices Merged Space-Saving summary.
+	@param alarms Merged Count-Min sketch.
+	@param frames Number of frames seen so far.
+
+	loadFleetSnapshot
+	@brief Restores the merged sketches from a checkpoint payload written with the same sketch sizes.
+	@param payload Payload of fleetSnapshotSize() bytes.
+	@param devices Space-Saving summary to restore.
+	@param alarms Count-Min sketch to restore.
+	@return Number of frames seen before the checkpoint.
+
+	downsampleTrends
+	@brief Reads "<device> <frame>" lines and prints a downsampled fluid level and pressure series for every
+	device. Each series is cut into buckets of windowFrames / pointsPerWindow frames and LTTB keeps one frame
+	per bucket, plus the first and the last frame of the device.
+	@param input Stream with the frames.
+	@param pointsPerWindow Number of points kept per window.
+	@param windowFrames Number of frames per window.
+	@return 0 on success, 1 when the series cannot be allocated or the output cannot be written.
+
+	findTrendDevice
+	@brief Finds the series of a device, creating them on its first frame.
+	@param table Pointer to the trendTable.
+	@param device Device number.
+	@return Pointer to the device, NULL when there is not enough memory.
+
+	formatTrendPoint
+	@brief Writes one "<device> <field> <frame number> <value>" line (with the newline) into a buffer.
+	@param device Device number.
+	@param field Field name.
+	@param point Kept point.
+	@param output Buffer with room for TREND_OUTPUT_LINE_SIZE characters.
+	@return Number of characters written.
+
+	journalAlarms
+	@brief Reads "<device> <frame>" lines and appends one record per alarm (receive time, device, type,
+	value and raw frame) to a journal. The journal syncs once per interval for all alarms in it.
+	@param input Stream with the frames.
+	@param path Journal file, records are appended to it.
+	@param syncIntervalMs Milliseconds between syncs.
+	@return 0 on success, 1 when the journal cannot be opened or written.
+
+	scanJournal
+	@brief Maps a journal and counts its alarms per type, or prints all records of one device.
+	@param path Journal file.
+	@param hasDevice true to print the records of device, false to count all records.
+	@param device Device number.
+	@return 0 on success, 1 when the journal cannot be read.
+
+	archiveInput
+	@brief Starts archiving the raw input into a file, runs the mode given after the file on the decoder's
+	copy of the input (by calling main() again) and waits until the whole input is archived.
+	@param path Archive file, the input is appended to it.
+	@param argc Number of arguments from the program name slot on (argv[0] is skipped like in main()).
+	@param argv Arguments of the mode.
+	@return Result of the mode, 1 when the archive cannot be written.
+
+	stopArchiveAtExit
+	@brief atexit() handler of archiveInput() for modes that end the program themselves (END in the interactive
+	mode): ends the archive after the input read so far, so a compressed archive is a complete LZ4 frame.
+	Exits with 1 when the archive could not be written.
 
-	countHumidityBits
-	@brief Counts the number of bits set to 1 in a humidity field.
-	@param humidityValue 4-bit humidity value.
-	@param maxBits Number of bits to check (should be 4).
-	@return The number of bits that are set to 1.
+	readsFrameLines
+	@brief Tells whether a mode reads frame lines from stdin, so its input may be gzip-compressed.
+	@param mode First argument of the program.
+	@return true for --frames, --fleet, --trend, --journal, --query, --rules and --plugin.
+
+	decompressInput
+	@brief Checks whether stdin is gzip-compressed and, if it is, moves it to a thread that decompresses it
+	into the mode's new stdin. Runs the mode (by calling main() again) and stops the thread afterwards.
+	@param argc Number of arguments from the program name slot on.
+	@param argv Arguments of the mode.
+	@return Result of the mode, 1 when the input cannot be decompressed.
+
+	compressOutput
+	@brief Runs the mode given after "--compress" (by calling main() again) with its stdout going through a pipe
+	to a thread that compresses it into an LZ4 frame on the original stdout.
+	@param argc Number of arguments from the program name slot on.
+	@param argv Arguments of the mode.
+	@return Result of the mode, 1 when the output cannot be compressed.
+
+	compressPipe
+	@brief Thread body of compressOutput(): reads the mode's output from the pipe into the LZ4 frame writer.
+	Stops at the first write error and closes the pipe, so the mode stops too instead of filling a full disk.
+	@param argument Pointer to the outputCompressor.
+	@return NULL.
+
+	closeCompressedOutput
+	@brief Ends the mode's stdout, waits until the thread has compressed the rest and closes the LZ4 frame.
+	Runs after the mode returns, or from exit() when the mode ends the program itself (END in the interactive
+	mode). Does nothing when the output is not compressed or already closed.
+	@return true when the frame is complete, false (after a message) when it could not be written.
+
+	closeCompressedOutputAtExit
+	@brief atexit() handler around closeCompressedOutput(), exits with 1 when the frame could not be written.
+
+	queryFrames
+	@brief Compiles a query, reads "<device> <frame>" lines in batches of QUERY_BATCH_SIZE frames, decodes the
+	columns the query uses and runs the query on every batch. Prints one line per group at the end.
+	@param input Stream with the frames.
+	@param text The query.
+	@return 0 on success, 1 when the query is wrong or there is not enough memory for its groups.
+
+	decodeQueryBatch
+	@brief Decodes the fields of a batch of frames into the columns the query uses (one array per field).
+	@param usedColumns Bit per column to fill (batchQuery.usedColumns).
+	@param devices Device of every frame.
+	@param frames The raw frames.
+	@param count Number of frames.
+	@param firstSeq Number of the first frame in the input.
+	@param columns QUERY_FRAME_COLUMNS arrays of QUERY_BATCH_SIZE values.
+
+	printQueryResult
+	@brief Prints a header with the group expression and the aggregates, then the groups ordered by key.
+	@param query Query after its last batch.
+
+	applyAlarmRules
+	@brief Loads an alarm rule set, compiles it (to machine code unless interpreted) and classifies every
+	"<device> <frame>" line as it is read, printing the frames with alarms in batches of RULES_BATCH_FRAMES.
+	@param input Stream with the frames.
+	@param path Rule file, "default" for the thresholds of classifyAlarms().
+	@param useJit false to run the interpreter.
+	@return 0 on success, 1 when the rules cannot be read or are wrong or the output cannot be written.
+
+	printRuleBatch
+	@brief Writes "<device> <frame> <mask>" for the frames of a batch with alarms.
+	@param devices Device of every frame.
+	@param frames The raw frames.
+	@param masks Alarm mask of every frame from the rule set.
+	@param count Number of frames.
+	@return Number of frames with alarms.
+
+	runFramePlugin
+	@brief Loads a plugin and hands it every batch of PLUGIN_BATCH_FRAMES decoded "<device> <frame>" lines,
+	then prints the frames with alarms (and the plugin's derived values).
+	@param input Stream with the frames.
+	@param path Shared object of the plugin.
+	@param argument Argument for the plugin's open(), NULL for none.
+	@return 0 on success, 1 when the plugin cannot be loaded or the output cannot be written.
+
+	decodePluginFrame
+	@brief Decodes the fields of one frame of a batch into its arrays and sets the built-in alarm flags.
+	@param batch Batch with room for PLUGIN_BATCH_FRAMES values in every array.
+	@param index Position of the frame in the batch.
+	@return The built-in alarm flags of the frame.
+
+	printPluginBatch
+	@brief Writes "<device> <frame> <alarm mask> [value]" for the frames of a batch that have alarms, or for
+	all frames when the plugin gave values.
+	@param batch Batch after the plugin processed it.
+	@return Number of frames with alarms.
 
  */
 
@@ -126,35 +560,133 @@ uint32_t convertToNumber(char*);
 int16_t getTemperature(uint32_t, uint8_t);
 uint16_t getPressure(uint32_t, uint8_t, uint8_t);
 uint8_t getHumidity(uint32_t, uint8_t, uint8_t);
-uint16_t getFluidLevel(uint32_t, uint8_t);
-void alarm(int16_t, uint16_t, uint8_t, uint16_t);
-int countHumidityBits(uint8_t, uint8_t);
+uint16_t getFluidLevel(uint32_t, uint16_t, uint8_t);
+size_t formatAlarms(int16_t, uint16_t, uint8_t, uint16_t, char*, size_t);
+size_t formatFrameReport(uint32_t, char*, uint8_t*);
+uint8_t classifyAlarms(int16_t, uint16_t, uint8_t, uint16_t);
+alarmSeverity getAlarmSeverity(uint8_t);
+bool reportCriticalAlarm(bool, uint32_t, uint32_t, uint32_t);
+int dumpFrames(FILE*);
+size_t formatFrame(uint32_t, const binaryFieldLayout*, char*);
+bool parseDeviceFrameLine(const char*, size_t, uint32_t*, uint32_t*);
+int trackFleetAlarms(FILE*, size_t, uint64_t, size_t, const char*);
+void* processFleetBatch(void*);
+void printFleetReport(const spaceSaving*, const countMinSketch*, uint64_t, size_t);
+size_t fleetSnapshotSize(const spaceSaving*, const countMinSketch*);
+void saveFleetSnapshot(uint8_t*, const spaceSaving*, const countMinSketch*, uint64_t);
+uint64_t loadFleetSnapshot(const uint8_t*, spaceSaving*, countMinSketch*);
+int downsampleTrends(FILE*, uint32_t, uint32_t);
+trendDevice* findTrendDevice(trendTable*, uint32_t);
+size_t formatTrendPoint(uint32_t, const char*, const lttbPoint*, char*);
+int journalAlarms(FILE*, const char*, unsigned);
+int scanJournal(const char*, bool, uint32_t);
+int archiveInput(const char*, int, char*[]);
+void stopArchiveAtExit(void);
+bool readsFrameLines(const char*);
+int decompressInput(int, char*[]);
+int compressOutput(int, char*[]);
+void* compressPipe(void*);
+bool closeCompressedOutput(void);
+void closeCompressedOutputAtExit(void);
+int queryFrames(FILE*, const char*);
+void decodeQueryBatch(uint32_t, const uint32_t*, const uint32_t*, size_t, uint64_t, int64_t (*)[QUERY_BATCH_SIZE]);
+void printQueryResult(const batchQuery*);
+int applyAlarmRules(FILE*, const char*, bool);
+size_t printRuleBatch(const uint32_t*, const uint32_t*, const uint32_t*, size_t);
+int runFramePlugin(FILE*, const char*, const char*);
+uint32_t decodePluginFrame(framePluginBatch*, size_t);
+size_t printPluginBatch(const framePluginBatch*);
 
-int main(void) {
+int main(int argc, char* argv[]) {
+
+	if (argc > 2 && strcmp(argv[1], "--critical") == 0) {
+		criticalAlarmOutput = fopen(argv[2], "a");
+		if (criticalAlarmOutput == NULL || setvbuf(criticalAlarmOutput, NULL, _IONBF, 0) != 0) {
+			fprintf(stderr, "Cannot open %s for critical alarms\n", argv[2]);
+			return 1;
+		}
+		return main(argc - 2, argv + 2);
+	}
+	if (argc > 2 && strcmp(argv[1], "--archive") == 0) {
+		return archiveInput(argv[2], argc - 2, argv + 2);
+	}
+	if (argc > 1 && strcmp(argv[1], "--compress") == 0) {
+		return compressOutput(argc - 1, argv + 1);
+	}
+	if (argc > 1 && strcmp(argv[1], "--decompress") == 0) {
+		if (!lz4_frame_decompress(stdin, stdout)) {
+			fprintf(stderr, "The input is not a complete LZ4 frame with independent blocks\n");
+			return 1;
+		}
+		return 0;
+	}
+	if (argc > 1 && !isInputChecked && readsFrameLines(argv[1])) {
+		return decompressInput(argc, argv);
+	}
+	if (argc > 1 && strcmp(argv[1], "--frames") == 0) {
+		return dumpFrames(stdin);
+	}
+	if (argc > 1 && strcmp(argv[1], "--fleet") == 0) {
+		size_t top = (argc > 2) ? (size_t)strtoul(argv[2], NULL, 10) : FLEET_DEFAULT_TOP;
+		uint64_t reportEvery = (argc > 3) ? strtoull(argv[3], NULL, 10) : FLEET_DEFAULT_REPORT_EVERY;
+		size_t threads = (argc > 4) ? (size_t)strtoul(argv[4], NULL, 10) : FLEET_DEFAULT_THREADS;
+		const char* snapshotPath = (argc > 5) ? argv[5] : NULL;
+		return trackFleetAlarms(stdin, top, reportEvery, threads, snapshotPath);
+	}
+	if (argc > 1 && strcmp(argv[1], "--trend") == 0) {
+		uint32_t points = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 10) : TREND_DEFAULT_POINTS;
+		uint32_t window = (argc > 3) ? (uint32_t)strtoul(argv[3], NULL, 10) : TREND_DEFAULT_WINDOW;
+		return downsampleTrends(stdin, points, window);
+	}
+	if (argc > 2 && strcmp(argv[1], "--journal") == 0) {
+		unsigned syncMs = (argc > 3) ? (unsigned)strtoul(argv[3], NULL, 10) : JOURNAL_DEFAULT_SYNC_MS;
+		return journalAlarms(stdin, argv[2], syncMs);
+	}
+	if (argc > 2 && strcmp(argv[1], "--scan-journal") == 0) {
+		uint32_t device = (argc > 3) ? (uint32_t)strtoul(argv[3], NULL, 10) : 0;
+		return scanJournal(argv[2], argc > 3, device);
+	}
+	if (argc > 2 && strcmp(argv[1], "--query") == 0) {
+		return queryFrames(stdin, argv[2]);
+	}
+	if (argc > 2 && strcmp(argv[1], "--rules") == 0) {
+		bool useJit = !(argc > 3 && strcmp(argv[3], "interpret") == 0);
+		return applyAlarmRules(stdin, argv[2], useJit);
+	}
+	if (argc > 2 && strcmp(argv[1], "--plugin") == 0) {
+		return runFramePlugin(stdin, argv[2], (argc > 3) ? argv[3] : NULL);
+	}
 
 	char dataString[HEX_INPUT_BUFFER_SIZE] = { '\0' };
+	char uncachedReport[REPORT_BLOCK_SIZE];
 	uint32_t receivedData = 0;
-
-	int16_t temperature;
-	uint16_t pressure;
-	uint8_t humidity;
-	uint16_t fluidLevel;
+	bool hasCache = output_cache_init(&frameReportCache, REPORT_CACHE_SLOTS, REPORT_BLOCK_SIZE);
 
 	while (1) {
 
 		enterData(dataString, MAX_HEX_DIGITS, HEX_INPUT_BUFFER_SIZE);
 		printf("Received data = %s\n", dataString);
 		receivedData = convertToNumber(dataString);
-		printf("Data after convertion = %" PRIx32 " = %" PRIu32 "\n", receivedData, receivedData);
-		temperature = getTemperature(receivedData, TEMPERATURE_BITS_MASK);
-		printf("Temperature = %" PRIx16 " = %" PRIi16 "\n", temperature, temperature);
-		pressure = getPressure(receivedData, PRESSURE_BITS_MASK, PRESSURE_BITS_SHIFT);
-		printf("Pressure = %" PRIx16 " = %" PRIu16 "\n", pressure, pressure);
-		humidity = getHumidity(receivedData, HUMIDITY_BITS_MASK, HUMIDITY_BITS_SHIFT);
-		printf("Humidity = %" PRIx8 " = %" PRIu8 "\n", humidity, humidity);
-		fluidLevel = getFluidLevel(receivedData, FLUID_LEVEL_BITS_SHIFT);
-		printf("Fluid level = %" PRIx16 " = %" PRIu16 "\n", fluidLevel, fluidLevel);
-		alarm(temperature, pressure, humidity, fluidLevel);
+
+		// The rest of the report depends only on the frame, a repeated frame is copied from the cache
+		size_t length = 0;
+		uint8_t alarms = 0;
+		const char* report = hasCache ? output_cache_lookup(&frameReportCache, receivedData, &length, &alarms) : NULL;
+		if (report == NULL) {
+			char* block = hasCache ? output_cache_block(&frameReportCache, receivedData) : uncachedReport;
+			length = formatFrameReport(receivedData, block, &alarms);
+			if (hasCache) {
+				output_cache_store(&frameReportCache, receivedData, length, alarms);
+			}
+			report = block;
+		}
+		fwrite(report, 1, length, stdout);
+		if (alarms & ALARM_CRITICAL) {
+			fflush(stdout);
+		}
+		if (ferror(stdout)) {
+			return 1;
+		}
 	}
 	return 0;
 }
@@ -294,55 +826,1332 @@ uint8_t getHumidity(uint32_t tempData, uint8_t maskForHumidity, uint8_t shiftFor
 	return ((uint8_t)tempData);
 }
 
-uint16_t getFluidLevel(uint32_t tempData, uint8_t shiftForFluidLevel) {
+uint16_t getFluidLevel(uint32_t tempData, uint16_t maskForFluidLevel, uint8_t shiftForFluidLevel) {
 	tempData = tempData >> shiftForFluidLevel;
+	tempData = tempData & maskForFluidLevel;
 	return ((uint16_t)tempData);
 }
 
-void alarm(int16_t temperatureData, uint16_t pressureData, uint8_t humidityData, uint16_t fluidLevelData) {
-	if (temperatureData <= 4)
+size_t formatAlarms(int16_t temperatureData, uint16_t pressureData, uint8_t humidityData, uint16_t fluidLevelData, char* output, size_t size) {
+	uint8_t alarms = classifyAlarms(temperatureData, pressureData, humidityData, fluidLevelData);
+	int used = 0;
+
+	if (alarms & ALARM_TEMPERATURE_LOW)
 	{
-		printf("Alarm! Temperature of fluid  = %" PRIi16 " is lower or equal 4 Celsius!\n", temperatureData);
+		used += snprintf(output + used, size - (size_t)used, "%s Temperature of fluid  = %" PRIi16 " is lower or equal " TANK_FRAME_TEXT(TANK_FRAME_TEMPERATURE_LOW) " Celsius!\n", ALARM_PREFIX(ALARM_TEMPERATURE_LOW), temperatureData);
 	}
-	else if (temperatureData > 100)
+	else if (alarms & ALARM_TEMPERATURE_HIGH)
 	{
-		printf("Alarm! Temperature of fluid = %" PRIi16 " is greater than 100 Celsius!\n", temperatureData);
+		used += snprintf(output + used, size - (size_t)used, "%s Temperature of fluid = %" PRIi16 " is greater than " TANK_FRAME_TEXT(TANK_FRAME_TEMPERATURE_HIGH) " Celsius!\n", ALARM_PREFIX(ALARM_TEMPERATURE_HIGH), temperatureData);
 	}
 
-	if (pressureData < 1013)
+	if (alarms & ALARM_PRESSURE_LOW)
 	{
-		printf("Alarm! Pressure in tank = %" PRIu16 " is lower then a normal pressure (1013 hPa)\n", pressureData);
+		used += snprintf(output + used, size - (size_t)used, "%s Pressure in tank = %" PRIu16 " is lower then a normal pressure (" TANK_FRAME_TEXT(TANK_FRAME_PRESSURE_LOW) " hPa)\n", ALARM_PREFIX(ALARM_PRESSURE_LOW), pressureData);
 	}
-	else if (pressureData > 1135)
+	else if (alarms & ALARM_PRESSURE_HIGH)
 	{
-		printf("Alarm! Pressure in tank = %" PRIu16 " is greater than maximal (1135 hpa)\n", pressureData);
+		used += snprintf(output + used, size - (size_t)used, "%s Pressure in tank = %" PRIu16 " is greater than maximal (" TANK_FRAME_TEXT(TANK_FRAME_PRESSURE_HIGH) " hpa)\n", ALARM_PREFIX(ALARM_PRESSURE_HIGH), pressureData);
 	}
 
-	if (countHumidityBits(humidityData, HUMIDITY_BITS)) {
-		printf("Alarm! The measured humidity level exceeds the acceptable range\n");
+	if (alarms & ALARM_HUMIDITY) {
+		used += snprintf(output + used, size - (size_t)used, "%s The measured humidity level exceeds the acceptable range\n", ALARM_PREFIX(ALARM_HUMIDITY));
 	}
 
-	if (fluidLevelData <= 0)
+	if (alarms & ALARM_TANK_EMPTY)
 	{
-		printf("Alarm! Tank is empty!\n");
+		used += snprintf(output + used, size - (size_t)used, "%s Tank is empty!\n", ALARM_PREFIX(ALARM_TANK_EMPTY));
 	}
-	else if (fluidLevelData > 8000)
+	else if (alarms & ALARM_FLUID_LEVEL_HIGH)
 	{
-		printf("Alarm! Fluid level = %" PRIu16 " l. Maximal fluid level is 8100 l!\n", fluidLevelData);
+		used += snprintf(output + used, size - (size_t)used, "%s Fluid level = %" PRIu16 " l. Maximal fluid level is " TANK_FRAME_TEXT(TANK_FRAME_FLUID_LEVEL_HIGH) " l!\n", ALARM_PREFIX(ALARM_FLUID_LEVEL_HIGH), fluidLevelData);
 	}
+
+	return (size_t)used;
 }
 
-int countHumidityBits(uint8_t bitsToBeCounted, uint8_t checkedBits) {
-	uint8_t counter = 0;
-	uint8_t temp = 0;
+size_t formatFrameReport(uint32_t data, char* output, uint8_t* alarms) {
+	int16_t temperature = getTemperature(data, TEMPERATURE_BITS_MASK);
+	uint16_t pressure = getPressure(data, PRESSURE_BITS_MASK, PRESSURE_BITS_SHIFT);
+	uint8_t humidity = getHumidity(data, HUMIDITY_BITS_MASK, HUMIDITY_BITS_SHIFT);
+	uint16_t fluidLevel = getFluidLevel(data, FLUID_LEVEL_BITS_MASK, FLUID_LEVEL_BITS_SHIFT);
 
-	for (int i = 0; i < checkedBits; i++)
-	{
-		temp = (bitsToBeCounted >> i) & 0x1;
-		if (temp)
-		{
-			counter++;
+	// REPORT_BLOCK_SIZE holds the longest report, four alarm messages included
+	int used = snprintf(output, REPORT_BLOCK_SIZE, "Data after convertion = %" PRIx32 " = %" PRIu32 "\n"
+		"Temperature = %" PRIx16 " = %" PRIi16 "\n"
+		"Pressure = %" PRIx16 " = %" PRIu16 "\n"
+		"Humidity = %" PRIx8 " = %" PRIu8 "\n"
+		"Fluid level = %" PRIx16 " = %" PRIu16 "\n",
+		data, data, temperature, temperature, pressure, pressure, humidity, humidity, fluidLevel, fluidLevel);
+	*alarms = classifyAlarms(temperature, pressure, humidity, fluidLevel);
+	return (size_t)used + formatAlarms(temperature, pressure, humidity, fluidLevel, output + used, REPORT_BLOCK_SIZE - (size_t)used);
+}
+
+uint8_t classifyAlarms(int16_t temperatureData, uint16_t pressureData, uint8_t humidityData, uint16_t fluidLevelData) {
+	return tank_frame_classify(temperatureData, pressureData, (uint8_t)bit_popcount32(humidityData), fluidLevelData);
+}
+
+alarmSeverity getAlarmSeverity(uint8_t alarms) {
+	if (alarms & ALARM_CRITICAL) {
+		return ALARM_SEVERITY_CRITICAL;
+	}
+	return (alarms != 0) ? ALARM_SEVERITY_WARNING : ALARM_SEVERITY_NONE;
+}
+
+bool reportCriticalAlarm(bool hasDevice, uint32_t device, uint32_t frame, uint32_t alarms) {
+	if (getAlarmSeverity((uint8_t)(alarms & ALARM_CRITICAL)) != ALARM_SEVERITY_CRITICAL) {
+		return false;
+	}
+
+	// One line, one write: stderr and the --critical file are unbuffered
+	char line[CRITICAL_OUTPUT_LINE_SIZE] = "critical ";
+	size_t used = strlen(line);
+	if (hasDevice) {
+		used += format_decimal_u64(device, line + used);
+		line[used++] = ' ';
+	}
+	used += format_hex_fixed(frame, 32, line + used);
+	for (int type = 0; type < ALARM_TYPES; type++) {
+		if (alarms & ALARM_CRITICAL & (1u << type)) {
+			size_t nameLength = strlen(alarmTypeNames[type]);
+			line[used++] = ' ';
+			memcpy(line + used, alarmTypeNames[type], nameLength);
+			used += nameLength;
+		}
+	}
+	line[used++] = '\n';
+	fwrite(line, 1, used, (criticalAlarmOutput != NULL) ? criticalAlarmOutput : stderr);
+	return true;
+}
+
+int dumpFrames(FILE* input) {
+	static char outputBuffer[FRAME_OUTPUT_BUFFER_SIZE];
+	const int fieldStarts[FRAME_FIELD_COUNT] = { FLUID_LEVEL_BITS_SHIFT, HUMIDITY_BITS_SHIFT, PRESSURE_BITS_SHIFT };
+	binaryFieldLayout layout;
+	outputCache cache;
+	char line[FRAME_INPUT_LINE_SIZE];
+	size_t used = 0;
+	size_t invalidLines = 0;
+	uint64_t frame;
+
+	if (!binary_field_layout_init(&layout, 32, fieldStarts, FRAME_FIELD_COUNT, " | ")
+		|| !output_cache_init(&cache, FRAME_CACHE_SLOTS, FRAME_OUTPUT_LINE_SIZE)) {
+		return 1;
+	}
+
+	while (fgets(line, sizeof(line), input) != NULL) {
+		size_t length = strcspn(line, "\r\n");
+		bool isWholeLine = (line[length] != '\0') || feof(input);
+
+		if (!isWholeLine) {
+			// Too long to be a frame, skip the rest of the line
+			int character;
+			while ((character = fgetc(input)) != '\n' && character != EOF);
+			invalidLines++;
+			continue;
+		}
+		if (length == 0) {
+			continue;
+		}
+		if (length > MAX_HEX_DIGITS || !parse_hex_string(line, length, &frame)) {
+			invalidLines++;
+			continue;
+		}
+
+		if (used > FRAME_OUTPUT_BUFFER_SIZE - FRAME_OUTPUT_LINE_SIZE) {
+			fwrite(outputBuffer, 1, used, stdout);
+			used = 0;
+			if (ferror(stdout)) {
+				break;
+			}
+		}
+		size_t textLength;
+		uint8_t flags;
+		const char* text = output_cache_lookup(&cache, (uint32_t)frame, &textLength, &flags);
+		if (text == NULL) {
+			// The alarms are kept with the text, so a repeated frame reaches the fast lane without decoding
+			char* block = output_cache_block(&cache, (uint32_t)frame);
+			textLength = formatFrame((uint32_t)frame, &layout, block);
+			flags = classifyAlarms(getTemperature((uint32_t)frame, TEMPERATURE_BITS_MASK),
+				getPressure((uint32_t)frame, PRESSURE_BITS_MASK, PRESSURE_BITS_SHIFT),
+				getHumidity((uint32_t)frame, HUMIDITY_BITS_MASK, HUMIDITY_BITS_SHIFT),
+				getFluidLevel((uint32_t)frame, FLUID_LEVEL_BITS_MASK, FLUID_LEVEL_BITS_SHIFT));
+			output_cache_store(&cache, (uint32_t)frame, textLength, flags);
+			text = block;
+		}
+		reportCriticalAlarm(false, 0, (uint32_t)frame, flags);
+		memcpy(outputBuffer + used, text, textLength);
+		used += textLength;
+	}
+	fwrite(outputBuffer, 1, used, stdout);
+
+	if (cache.hits + cache.misses > 0) {
+		fprintf(stderr, "Output cache: %" PRIu64 " hits of %" PRIu64 " frames (%.1f%%)\n", cache.hits,
+			cache.hits + cache.misses, 100.0 * output_cache_hit_rate(&cache));
+	}
+	output_cache_free(&cache);
+	if (invalidLines > 0) {
+		fprintf(stderr, "Skipped %zu lines that are not hexadecimal frames\n", invalidLines);
+	}
+	return ferror(stdout) ? 1 : 0;
+}
+
+size_t formatFrame(uint32_t data, const binaryFieldLayout* layout, char* output) {
+	char* position = output;
+	int16_t temperature = getTemperature(data, TEMPERATURE_BITS_MASK);
+
+	position += format_hex_fixed(data, 32, position);
+	memcpy(position, " = ", 3);
+	position += 3;
+	position += format_binary_fields(data, layout, position);
+
+	memcpy(position, " : fluid ", 9);
+	position += 9;
+	position += format_decimal_u64(getFluidLevel(data, FLUID_LEVEL_BITS_MASK, FLUID_LEVEL_BITS_SHIFT), position);
+	memcpy(position, " | humidity ", 12);
+	position += 12;
+	position += format_decimal_u64(getHumidity(data, HUMIDITY_BITS_MASK, HUMIDITY_BITS_SHIFT), position);
+	memcpy(position, " | pressure ", 12);
+	position += 12;
+	position += format_decimal_u64(getPressure(data, PRESSURE_BITS_MASK, PRESSURE_BITS_SHIFT), position);
+	memcpy(position, " | temperature ", 15);
+	position += 15;
+	if (temperature < 0) {
+		*position++ = '-';
+	}
+	position += format_decimal_u64((uint64_t)(temperature < 0 ? -temperature : temperature), position);
+	*position++ = '\n';
+
+	return (size_t)(position - output);
+}
+
+bool parseDeviceFrameLine(const char* line, size_t length, uint32_t* device, uint32_t* frame) {
+	const char* separator = memchr(line, ' ', length);
+	uint64_t deviceValue;
+	uint64_t frameValue;
+
+	if (separator == NULL
+		|| parse_decimal_string(line, (size_t)(separator - line), UINT32_MAX, &deviceValue) != PARSE_OK
+		|| !parse_hex_string(separator + 1, length - (size_t)(separator - line) - 1, &frameValue)
+		|| frameValue > UINT32_MAX) {
+		return false;
+	}
+	*device = (uint32_t)deviceValue;
+	*frame = (uint32_t)frameValue;
+	return true;
+}
+
+int trackFleetAlarms(FILE* input, size_t top, uint64_t reportEvery, size_t threads, const char* snapshotPath) {
+	fleetWorker workers[FLEET_MAX_THREADS];
+	spaceSaving devices;
+	countMinSketch alarms;
+	fleetFrame* frames = malloc(FLEET_BATCH_FRAMES * sizeof(fleetFrame));
+	char line[FRAME_INPUT_LINE_SIZE];
+	uint64_t framesSeen = 0;
+	uint64_t nextReport = reportEvery;
+	uint64_t nextSnapshot = FLEET_SNAPSHOT_EVERY;
+	uint64_t checkpointFrames = 0;
+	size_t invalidLines = 0;
+	size_t workerCount = 0;
+	int result = 0;
+
+	threads = (threads < 1) ? 1 : (threads > FLEET_MAX_THREADS) ? FLEET_MAX_THREADS : threads;
+	top = (top > FLEET_SUMMARY_CAPACITY) ? FLEET_SUMMARY_CAPACITY : top;
+	bool isReady = frames != NULL && space_saving_init(&devices, FLEET_SUMMARY_CAPACITY);
+	if (isReady && !count_min_init(&alarms, FLEET_SKETCH_WIDTH, FLEET_SKETCH_DEPTH)) {
+		space_saving_free(&devices);
+		isReady = false;
+	}
+	for (; isReady && workerCount < threads; workerCount++) {
+		if (!space_saving_init(&workers[workerCount].devices, FLEET_SUMMARY_CAPACITY)) {
+			break;
+		}
+		if (!count_min_init(&workers[workerCount].alarms, FLEET_SKETCH_WIDTH, FLEET_SKETCH_DEPTH)) {
+			space_saving_free(&workers[workerCount].devices);
+			break;
+		}
+	}
+	if (!isReady || workerCount < threads) {
+		fprintf(stderr, "Not enough memory for the fleet sketches\n");
+		result = 1;
+	}
+#if defined(STATE_SNAPSHOT_SUPPORTED)
+	stateSnapshot snapshot = { 0 };
+	bool hasSnapshot = false;
+	if (result == 0 && snapshotPath != NULL) {
+		hasSnapshot = snapshot_open(&snapshot, snapshotPath, fleetSnapshotSize(&devices, &alarms));
+		if (!hasSnapshot) {
+			fprintf(stderr, "Cannot map the snapshot file %s\n", snapshotPath);
+			result = 1;
+		}
+		else if (snapshot_latest(&snapshot) != NULL) {
+			framesSeen = loadFleetSnapshot(snapshot_latest(&snapshot), &devices, &alarms);
+			nextReport = framesSeen + reportEvery;
+			nextSnapshot = framesSeen + FLEET_SNAPSHOT_EVERY;
+			checkpointFrames = framesSeen;
+			fprintf(stderr, "Resumed from the checkpoint after %" PRIu64 " frames\n", framesSeen);
+		}
+	}
+#else
+	if (snapshotPath != NULL) {
+		fprintf(stderr, "Snapshots are not supported on this platform\n");
+	}
+#endif
+
+	bool isEnd = (result != 0);
+	while (!isEnd) {
+		// Read a batch of "<device> <frame>" lines
+		size_t count = 0;
+		while (count < FLEET_BATCH_FRAMES) {
+			if (fgets(line, sizeof(line), input) == NULL) {
+				isEnd = true;
+				break;
+			}
+			size_t length = strcspn(line, "\r\n");
+			uint32_t device;
+			uint32_t frame;
+			if (length == 0) {
+				continue;
+			}
+			if (!parseDeviceFrameLine(line, length, &device, &frame)) {
+				invalidLines++;
+				continue;
+			}
+			frames[count].device = device;
+			frames[count].data = frame;
+			count++;
+		}
+
+		// Every worker classifies its slice into its own sketches, the sketches are merged afterwards
+		size_t slice = (count + threads - 1) / threads;
+		for (size_t i = 0; i < threads; i++) {
+			size_t start = (i * slice < count) ? i * slice : count;
+			workers[i].frames = frames + start;
+			workers[i].count = (start + slice < count) ? slice : count - start;
+		}
+#if defined(FLEET_HAS_THREADS)
+		pthread_t threadIds[FLEET_MAX_THREADS];
+		size_t started = 0;
+		for (; started < threads; started++) {
+			if (pthread_create(&threadIds[started], NULL, processFleetBatch, &workers[started]) != 0) {
+				break;
+			}
+		}
+		for (size_t i = started; i < threads; i++) {
+			processFleetBatch(&workers[i]);
+		}
+		for (size_t i = 0; i < started; i++) {
+			pthread_join(threadIds[i], NULL);
+		}
+#else
+		for (size_t i = 0; i < threads; i++) {
+			processFleetBatch(&workers[i]);
+		}
+#endif
+		for (size_t i = 0; i < threads; i++) {
+			space_saving_merge(&devices, &workers[i].devices);
+			count_min_merge(&alarms, &workers[i].alarms);
+			space_saving_reset(&workers[i].devices);
+			count_min_reset(&workers[i].alarms);
+		}
+
+		framesSeen += count;
+		if (reportEvery > 0 && framesSeen >= nextReport && !isEnd) {
+			printFleetReport(&devices, &alarms, framesSeen, top);
+			nextReport = framesSeen + reportEvery;
+			if (fflush(stdout) != 0) {
+				result = 1;
+				isEnd = true;
+			}
+		}
+#if defined(STATE_SNAPSHOT_SUPPORTED)
+		// Checkpoint between batches, when the workers are idle and the merged sketches are complete
+		if (hasSnapshot && (framesSeen >= nextSnapshot || (isEnd && framesSeen != checkpointFrames))) {
+			saveFleetSnapshot(snapshot_begin(&snapshot), &devices, &alarms, framesSeen);
+			if (!snapshot_commit(&snapshot)) {
+				fprintf(stderr, "Cannot write the checkpoint to %s\n", snapshotPath);
+			}
+			nextSnapshot = framesSeen + FLEET_SNAPSHOT_EVERY;
+			checkpointFrames = framesSeen;
+		}
+#endif
+	}
+
+	if (result == 0) {
+		printFleetReport(&devices, &alarms, framesSeen, top);
+		if (invalidLines > 0) {
+			fprintf(stderr, "Skipped %zu lines that are not \"<device> <frame>\"\n", invalidLines);
+		}
+	}
+	for (size_t i = 0; i < workerCount; i++) {
+		space_saving_free(&workers[i].devices);
+		count_min_free(&workers[i].alarms);
+	}
+	if (isReady) {
+		space_saving_free(&devices);
+		count_min_free(&alarms);
+	}
+#if defined(STATE_SNAPSHOT_SUPPORTED)
+	if (hasSnapshot) {
+		snapshot_close(&snapshot);
+	}
+#endif
+	free(frames);
+	return result;
+}
+
+void* processFleetBatch(void* argument) {
+	fleetWorker* worker = argument;
+
+	for (size_t i = 0; i < worker->count; i++) {
+		uint32_t data = worker->frames[i].data;
+		uint64_t deviceKey = (uint64_t)worker->frames[i].device << ALARM_KEY_BITS;
+		uint8_t alarms = classifyAlarms(getTemperature(data, TEMPERATURE_BITS_MASK),
+			getPressure(data, PRESSURE_BITS_MASK, PRESSURE_BITS_SHIFT),
+			getHumidity(data, HUMIDITY_BITS_MASK, HUMIDITY_BITS_SHIFT),
+			getFluidLevel(data, FLUID_LEVEL_BITS_MASK, FLUID_LEVEL_BITS_SHIFT));
+
+		if (alarms == 0) {
+			continue;
+		}
+		space_saving_add(&worker->devices, worker->frames[i].device, (uint64_t)bit_popcount32(alarms), 0);
+		count_min_add(&worker->alarms, deviceKey | ALARM_KEY_ALL, (uint64_t)bit_popcount32(alarms));
+		// One Count-Min key per alarm type, lowest set flag first
+		for (uint32_t remaining = alarms; remaining != 0; remaining &= remaining - 1) {
+			count_min_add(&worker->alarms, deviceKey | (uint64_t)bit_ctz32(remaining), 1);
+		}
+	}
+	return NULL;
+}
+
+void printFleetReport(const spaceSaving* devices, const countMinSketch* alarms, uint64_t frames, size_t top) {
+	spaceSavingCounter leaders[FLEET_SUMMARY_CAPACITY];
+	size_t count = space_saving_top(devices, leaders, top);
+
+	printf("Alarm report after %" PRIu64 " frames, %" PRIu64 " alarms (top %zu devices, counts may be high by at most %" PRIu64 "):\n",
+		frames, devices->total, count, (devices->used == devices->capacity) ? devices->counters[0].count : 0);
+	printf("%12s %10s", "device", "alarms");
+	for (int type = 0; type < ALARM_TYPES; type++) {
+		printf(" %10s", alarmTypeNames[type]);
+	}
+	putchar('\n');
+
+	for (size_t i = 0; i < count; i++) {
+		uint64_t deviceKey = leaders[i].key << ALARM_KEY_BITS;
+		// Both structures only overestimate, so the smaller of the two counts is closer
+		uint64_t total = count_min_estimate(alarms, deviceKey | ALARM_KEY_ALL);
+		total = (leaders[i].count < total) ? leaders[i].count : total;
+		printf("%12" PRIu64 " %10" PRIu64, leaders[i].key, total);
+		for (int type = 0; type < ALARM_TYPES; type++) {
+			printf(" %10" PRIu64, count_min_estimate(alarms, deviceKey | (uint64_t)type));
+		}
+		putchar('\n');
+	}
+}
+
+size_t fleetSnapshotSize(const spaceSaving* devices, const countMinSketch* alarms) {
+	return sizeof(fleetSnapshotHeader) + devices->capacity * sizeof(spaceSavingCounter)
+		+ (devices->tableMask + 1) * sizeof(uint32_t) + alarms->width * alarms->depth * sizeof(uint64_t);
+}
+
+void saveFleetSnapshot(uint8_t* payload, const spaceSaving* devices, const countMinSketch* alarms, uint64_t frames) {
+	fleetSnapshotHeader header = { frames, devices->total, devices->used, alarms->total };
+	size_t countersSize = devices->capacity * sizeof(spaceSavingCounter);
+	size_t tableSize = (devices->tableMask + 1) * sizeof(uint32_t);
+
+	memcpy(payload, &header, sizeof(header));
+	payload += sizeof(header);
+	memcpy(payload, devices->counters, countersSize);
+	memcpy(payload + countersSize, devices->table, tableSize);
+	memcpy(payload + countersSize + tableSize, alarms->counters, alarms->width * alarms->depth * sizeof(uint64_t));
+}
+
+uint64_t loadFleetSnapshot(const uint8_t* payload, spaceSaving* devices, countMinSketch* alarms) {
+	fleetSnapshotHeader header;
+	size_t countersSize = devices->capacity * sizeof(spaceSavingCounter);
+	size_t tableSize = (devices->tableMask + 1) * sizeof(uint32_t);
+
+	memcpy(&header, payload, sizeof(header));
+	payload += sizeof(header);
+	memcpy(devices->counters, payload, countersSize);
+	memcpy(devices->table, payload + countersSize, tableSize);
+	memcpy(alarms->counters, payload + countersSize + tableSize, alarms->width * alarms->depth * sizeof(uint64_t));
+	devices->total = header.devicesTotal;
+	devices->used = (size_t)header.devicesUsed;
+	alarms->total = header.alarmsTotal;
+	return header.frames;
+}
+
+int downsampleTrends(FILE* input, uint32_t pointsPerWindow, uint32_t windowFrames) {
+	static char outputBuffer[FRAME_OUTPUT_BUFFER_SIZE];
+	trendTable table = { NULL, 0, 0, NULL, 0, 0 };
+	char line[FRAME_INPUT_LINE_SIZE];
+	lttbPoint kept[LTTB_MAX_POINTS_PER_FLUSH];
+	size_t used = 0;
+	size_t invalidLines = 0;
+	int result = 0;
+
+	pointsPerWindow = (pointsPerWindow < 1) ? 1 : pointsPerWindow;
+	table.bucketSize = (windowFrames > pointsPerWindow) ? windowFrames / pointsPerWindow : 1;
+
+	while (fgets(line, sizeof(line), input) != NULL) {
+		size_t length = strcspn(line, "\r\n");
+		uint32_t device;
+		uint32_t frame;
+		if (length == 0) {
+			continue;
+		}
+		if (!parseDeviceFrameLine(line, length, &device, &frame)) {
+			invalidLines++;
+			continue;
+		}
+
+		trendDevice* tank = findTrendDevice(&table, device);
+		if (tank == NULL) {
+			fprintf(stderr, "Not enough memory for the trend series\n");
+			result = 1;
+			break;
+		}
+		int64_t frameNumber = (int64_t)tank->frames++;
+		if (used > FRAME_OUTPUT_BUFFER_SIZE - 2 * TREND_OUTPUT_LINE_SIZE) {
+			fwrite(outputBuffer, 1, used, stdout);
+			used = 0;
+			if (ferror(stdout)) {
+				result = 1;
+				break;
+			}
+		}
+		if (lttb_add(&tank->fluidLevel, frameNumber, getFluidLevel(frame, FLUID_LEVEL_BITS_MASK, FLUID_LEVEL_BITS_SHIFT), kept)) {
+			used += formatTrendPoint(tank->device, "fluid", kept, outputBuffer + used);
+		}
+		if (lttb_add(&tank->pressure, frameNumber, getPressure(frame, PRESSURE_BITS_MASK, PRESSURE_BITS_SHIFT), kept)) {
+			used += formatTrendPoint(tank->device, "pressure", kept, outputBuffer + used);
+		}
+	}
+
+	// The last frames of every device end their series
+	for (size_t i = 0; i < table.count; i++) {
+		trendDevice* tank = &table.devices[i];
+		if (result == 0) {
+			if (used > FRAME_OUTPUT_BUFFER_SIZE - 2 * LTTB_MAX_POINTS_PER_FLUSH * TREND_OUTPUT_LINE_SIZE) {
+				fwrite(outputBuffer, 1, used, stdout);
+				used = 0;
+			}
+			size_t count = lttb_flush(&tank->fluidLevel, kept);
+			for (size_t j = 0; j < count; j++) {
+				used += formatTrendPoint(tank->device, "fluid", &kept[j], outputBuffer + used);
+			}
+			count = lttb_flush(&tank->pressure, kept);
+			for (size_t j = 0; j < count; j++) {
+				used += formatTrendPoint(tank->device, "pressure", &kept[j], outputBuffer + used);
+			}
+		}
+		lttb_free(&tank->fluidLevel);
+		lttb_free(&tank->pressure);
+	}
+	fwrite(outputBuffer, 1, used, stdout);
+
+	if (invalidLines > 0) {
+		fprintf(stderr, "Skipped %zu lines that are not \"<device> <frame>\"\n", invalidLines);
+	}
+	free(table.devices);
+	free(table.slots);
+	return result;
+}
+
+trendDevice* findTrendDevice(trendTable* table, uint32_t device) {
+	// Keep the table at most half full, rebuilding it from the device list when it grows
+	if (2 * (table->count + 1) > table->slotMask + 1 || table->slots == NULL) {
+		size_t slotCount = (table->slots == NULL) ? TREND_MIN_DEVICE_SLOTS : 2 * (table->slotMask + 1);
+		uint32_t* slots = malloc(slotCount * sizeof(uint32_t));
+		trendDevice* devices = realloc(table->devices, (slotCount / 2) * sizeof(trendDevice));
+		if (slots == NULL || devices == NULL) {
+			free(slots);
+			if (devices != NULL) {
+				table->devices = devices;
+			}
+			return NULL;
+		}
+		memset(slots, 0xFF, slotCount * sizeof(uint32_t));
+		for (size_t i = 0; i < table->count; i++) {
+			size_t slot = (size_t)sketch_hash(devices[i].device) & (slotCount - 1);
+			while (slots[slot] != UINT32_MAX) {
+				slot = (slot + 1) & (slotCount - 1);
+			}
+			slots[slot] = (uint32_t)i;
+		}
+		free(table->slots);
+		table->slots = slots;
+		table->slotMask = slotCount - 1;
+		table->devices = devices;
+		table->capacity = slotCount / 2;
+	}
+
+	size_t slot = (size_t)sketch_hash(device) & table->slotMask;
+	while (table->slots[slot] != UINT32_MAX) {
+		trendDevice* tank = &table->devices[table->slots[slot]];
+		if (tank->device == device) {
+			return tank;
+		}
+		slot = (slot + 1) & table->slotMask;
+	}
+
+	trendDevice* tank = &table->devices[table->count];
+	tank->device = device;
+	tank->frames = 0;
+	if (!lttb_init(&tank->fluidLevel, table->bucketSize)) {
+		return NULL;
+	}
+	if (!lttb_init(&tank->pressure, table->bucketSize)) {
+		lttb_free(&tank->fluidLevel);
+		return NULL;
+	}
+	table->slots[slot] = (uint32_t)table->count++;
+	return tank;
+}
+
+size_t formatTrendPoint(uint32_t device, const char* field, const lttbPoint* point, char* output) {
+	char* position = output;
+	size_t fieldLength = strlen(field);
+
+	position += format_decimal_u64(device, position);
+	*position++ = ' ';
+	memcpy(position, field, fieldLength);
+	position += fieldLength;
+	*position++ = ' ';
+	position += format_decimal_u64((uint64_t)point->x, position);
+	*position++ = ' ';
+	position += format_decimal_u64((uint64_t)point->y, position);
+	*position++ = '\n';
+
+	return (size_t)(position - output);
+}
+
+#if defined(ALARM_JOURNAL_SUPPORTED)
+int journalAlarms(FILE* input, const char* path, unsigned syncIntervalMs) {
+	alarmJournal journal;
+	char line[FRAME_INPUT_LINE_SIZE];
+	uint64_t frames = 0;
+	size_t invalidLines = 0;
+	int result = 0;
+
+	if (!alarm_journal_open(&journal, path, syncIntervalMs)) {
+		fprintf(stderr, "Cannot open the journal %s\n", path);
+		return 1;
+	}
+
+	while (fgets(line, sizeof(line), input) != NULL) {
+		size_t length = strcspn(line, "\r\n");
+		uint32_t device;
+		uint32_t frame;
+		if (length == 0) {
+			continue;
+		}
+		if (!parseDeviceFrameLine(line, length, &device, &frame)) {
+			invalidLines++;
+			continue;
+		}
+		frames++;
+
+		uint32_t data = frame;
+		int16_t temperature = getTemperature(data, TEMPERATURE_BITS_MASK);
+		uint16_t pressure = getPressure(data, PRESSURE_BITS_MASK, PRESSURE_BITS_SHIFT);
+		uint8_t humidity = getHumidity(data, HUMIDITY_BITS_MASK, HUMIDITY_BITS_SHIFT);
+		uint16_t fluidLevel = getFluidLevel(data, FLUID_LEVEL_BITS_MASK, FLUID_LEVEL_BITS_SHIFT);
+		uint8_t alarms = classifyAlarms(temperature, pressure, humidity, fluidLevel);
+		if (alarms == 0) {
+			continue;
+		}
+
+		alarmRecord record = { alarm_journal_now(), device, data, 0, 0, 0, { 0, 0 } };
+		for (uint32_t remaining = alarms; remaining != 0; remaining &= remaining - 1) {
+			uint32_t flag = remaining & (0u - remaining);
+			record.type = (uint8_t)bit_ctz32(remaining);
+			record.value = (flag & (ALARM_TEMPERATURE_LOW | ALARM_TEMPERATURE_HIGH)) ? temperature
+				: (flag & (ALARM_PRESSURE_LOW | ALARM_PRESSURE_HIGH)) ? pressure
+				: (flag & ALARM_HUMIDITY) ? humidity : fluidLevel;
+			if (alarm_journal_append(&journal, &record) == 0) {
+				result = 1;
+				break;
+			}
+		}
+		if (result != 0) {
+			break;
+		}
+	}
+
+	uint64_t records = journal.appended;
+	if (!alarm_journal_close(&journal)) {
+		result = 1;
+	}
+	if (result != 0) {
+		fprintf(stderr, "Cannot write the journal %s\n", path);
+	}
+	fprintf(stderr, "Journaled %" PRIu64 " alarms of %" PRIu64 " frames with %" PRIu64 " syncs\n", records, frames, journal.syncs);
+	if (invalidLines > 0) {
+		fprintf(stderr, "Skipped %zu lines that are not \"<device> <frame>\"\n", invalidLines);
+	}
+	return result;
+}
+
+int scanJournal(const char* path, bool hasDevice, uint32_t device) {
+	uint64_t typeCounts[ALARM_TYPES + 1] = { 0 };
+	uint64_t first = UINT64_MAX;
+	uint64_t last = 0;
+	size_t damaged = 0;
+	size_t mapSize;
+	size_t count;
+	const alarmRecord* records;
+
+	if (!alarm_journal_map(path, &records, &count, &mapSize)) {
+		fprintf(stderr, "Cannot read the journal %s\n", path);
+		return 1;
+	}
+
+	if (hasDevice) {
+		for (size_t i = 0; i < count; i++) {
+			const alarmRecord* record = &records[i];
+			if (record->device != device || record->marker != ALARM_JOURNAL_MARKER || record->type >= ALARM_TYPES) {
+				continue;
+			}
+			printf("%" PRIu64 ".%09" PRIu64 " %" PRIu32 " %s %" PRId32 " %08" PRIx32 "\n", record->timestamp / 1000000000u,
+				record->timestamp % 1000000000u, record->device, alarmTypeNames[record->type], record->value, record->frame);
+		}
+	}
+	else {
+		// Branch-free count per type, anything that is not a whole record lands in the last counter
+		for (size_t i = 0; i < count; i++) {
+			const alarmRecord* record = &records[i];
+			bool isValid = record->marker == ALARM_JOURNAL_MARKER && record->type < ALARM_TYPES;
+			typeCounts[isValid ? record->type : ALARM_TYPES]++;
+			first = (isValid && record->timestamp < first) ? record->timestamp : first;
+			last = (isValid && record->timestamp > last) ? record->timestamp : last;
+		}
+		damaged = (size_t)typeCounts[ALARM_TYPES];
+
+		printf("%zu alarms", count - damaged);
+		if (first <= last) {
+			printf(" in %.3f s", (double)(last - first) / 1e9);
+		}
+		putchar('\n');
+		for (int type = 0; type < ALARM_TYPES; type++) {
+			printf("%10s %12" PRIu64 "\n", alarmTypeNames[type], typeCounts[type]);
+		}
+		if (damaged > 0) {
+			fprintf(stderr, "Skipped %zu damaged records\n", damaged);
+		}
+	}
+	alarm_journal_unmap(records, mapSize);
+	return 0;
+}
+#else
+int journalAlarms(FILE* input, const char* path, unsigned syncIntervalMs) {
+	(void)input;
+	(void)syncIntervalMs;
+	fprintf(stderr, "The alarm journal %s needs a POSIX system\n", path);
+	return 1;
+}
+
+int scanJournal(const char* path, bool hasDevice, uint32_t device) {
+	(void)hasDevice;
+	(void)device;
+	fprintf(stderr, "The alarm journal %s needs a POSIX system\n", path);
+	return 1;
+}
+#endif
+
+#if defined(RAW_ARCHIVE_SUPPORTED)
+// The archive of the running mode, NULL path when there is none or it is finished
+static rawArchive inputArchive;
+static const char* inputArchivePath;
+
+int archiveInput(const char* path, int argc, char* argv[]) {
+	rawArchive* archive = &inputArchive;
+	size_t length = strlen(path);
+	bool isCompressed = length > 4 && strcmp(path + length - 4, ".lz4") == 0;
+
+	if (!raw_archive_start(archive, path, isCompressed ? COMPRESSION_THREADS : 0)) {
+		fprintf(stderr, "Cannot archive the input to %s\n", path);
+		return 1;
+	}
+	inputArchivePath = path;
+	atexit(stopArchiveAtExit);
+
+	int result = main(argc, argv);
+	inputArchivePath = NULL;
+	fflush(stdout);
+	if (!raw_archive_finish(archive)) {
+		fprintf(stderr, "Cannot write the archive %s\n", path);
+		return 1;
+	}
+	if (archive->copied > 0 && !isCompressed) {
+		fprintf(stderr, "Archived %" PRIu64 " bytes, %" PRIu64 " of them copied through user space\n", archive->archived, archive->copied);
+	}
+	return result;
+}
+
+void stopArchiveAtExit(void) {
+	const char* path = inputArchivePath;
+	if (path == NULL) {
+		return;
+	}
+	inputArchivePath = NULL;
+	if (!raw_archive_stop(&inputArchive)) {
+		fprintf(stderr, "Cannot write the archive %s\n", path);
+		_exit(1);
+	}
+}
+#else
+int archiveInput(const char* path, int argc, char* argv[]) {
+	(void)argc;
+	(void)argv;
+	fprintf(stderr, "Archiving the input to %s needs a POSIX system\n", path);
+	return 1;
+}
+
+void stopArchiveAtExit(void) {
+}
+#endif
+
+bool readsFrameLines(const char* mode) {
+	static const char* const frameModes[] = { "--frames", "--fleet", "--trend", "--journal", "--query", "--rules", "--plugin" };
+	for (size_t i = 0; i < sizeof(frameModes) / sizeof(frameModes[0]); i++) {
+		if (strcmp(mode, frameModes[i]) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+#if defined(GZIP_INPUT_SUPPORTED)
+// The decompressing thread of a gzip-compressed stdin
+static gzipInput compressedInput;
+
+int decompressInput(int argc, char* argv[]) {
+	gzipInput* input = &compressedInput;
+	isInputChecked = true;
+
+	gzipInputState state = gzip_input_start(input);
+	if (state == GZIP_INPUT_UNSUPPORTED) {
+		fprintf(stderr, "The input is gzip-compressed, build with -DGZIP_INPUT_USE_ZLIB -lz to read it\n");
+		return 1;
+	}
+	if (state == GZIP_INPUT_FAILED) {
+		fprintf(stderr, "Cannot decompress the input\n");
+		return 1;
+	}
+	int result = main(argc, argv);
+	if (state == GZIP_INPUT_STARTED && !gzip_input_finish(input)) {
+		fprintf(stderr, "Cannot decompress the input: %s\n", input->error);
+		return 1;
+	}
+	return result;
+}
+#else
+int decompressInput(int argc, char* argv[]) {
+	// Without POSIX the input is read as it is
+	isInputChecked = true;
+	return main(argc, argv);
+}
+#endif
+
+#if defined(OUTPUT_HAS_COMPRESSION)
+// The compressed stdout of the running mode, closed by closeCompressedOutput()
+static outputCompressor compressedOutput = { -1, NULL, { 0 }, false };
+static pthread_t compressedOutputThread;
+
+int compressOutput(int argc, char* argv[]) {
+	outputCompressor* compressor = &compressedOutput;
+	int outputPipe[2];
+	int original;
+
+	fflush(stdout);
+	original = dup(STDOUT_FILENO);
+	compressor->output = (original < 0) ? NULL : fdopen(original, "wb");
+	if (compressor->output == NULL || !lz4_writer_open(&compressor->writer, compressor->output, COMPRESSION_THREADS)) {
+		fprintf(stderr, "Cannot compress the output\n");
+		return 1;
+	}
+	if (pipe(outputPipe) != 0 || dup2(outputPipe[1], STDOUT_FILENO) < 0) {
+		fprintf(stderr, "Cannot compress the output\n");
+		return 1;
+	}
+	close(outputPipe[1]);
+	compressor->input = outputPipe[0];
+	if (pthread_create(&compressedOutputThread, NULL, compressPipe, compressor) != 0) {
+		fprintf(stderr, "Cannot compress the output\n");
+		return 1;
+	}
+	compressor->isRunning = true;
+	atexit(closeCompressedOutputAtExit);
+	// A reader that stops early fails the writes with EPIPE instead of killing the program before the close
+	signal(SIGPIPE, SIG_IGN);
+
+	int result = main(argc, argv);
+	return closeCompressedOutput() ? result : 1;
+}
+
+void* compressPipe(void* argument) {
+	outputCompressor* compressor = argument;
+	static char buffer[COMPRESSION_READ_SIZE];
+
+	while (!compressor->writer.hasError) {
+		ssize_t count = read(compressor->input, buffer, sizeof(buffer));
+		if (count < 0 && errno == EINTR) {
+			continue;
+		}
+		if (count <= 0) {
+			return NULL;
+		}
+		lz4_writer_write(&compressor->writer, buffer, (size_t)count);
+	}
+	// Nothing reads the mode's output any more, its next write fails with EPIPE (SIGPIPE is ignored) and it stops
+	fprintf(stderr, "Cannot write the compressed output\n");
+	close(compressor->input);
+	compressor->input = -1;
+	return NULL;
+}
+
+bool closeCompressedOutput(void) {
+	outputCompressor* compressor = &compressedOutput;
+	if (!compressor->isRunning) {
+		return true;
+	}
+	compressor->isRunning = false;
+
+	// Closing stdout ends the pipe, the thread compresses what is left
+	fclose(stdout);
+	pthread_join(compressedOutputThread, NULL);
+	bool hasFailed = compressor->writer.hasError;
+	if (compressor->input >= 0) {
+		close(compressor->input);
+	}
+	bool isWritten = lz4_writer_close(&compressor->writer);
+	if (fclose(compressor->output) != 0 || !isWritten) {
+		if (!hasFailed) {
+			fprintf(stderr, "Cannot write the compressed output\n");
+		}
+		return false;
+	}
+	return true;
+}
+
+void closeCompressedOutputAtExit(void) {
+	if (!closeCompressedOutput()) {
+		_exit(1);
+	}
+}
+#else
+int compressOutput(int argc, char* argv[]) {
+	(void)argc;
+	(void)argv;
+	fprintf(stderr, "Compressing the output needs a POSIX system\n");
+	return 1;
+}
+
+void* compressPipe(void* argument) {
+	return argument;
+}
+
+bool closeCompressedOutput(void) {
+	return true;
+}
+
+void closeCompressedOutputAtExit(void) {
+}
+#endif
+
+int queryFrames(FILE* input, const char* text) {
+	static batchQuery query;
+	static int64_t columns[QUERY_FRAME_COLUMNS][QUERY_BATCH_SIZE];
+	static uint32_t devices[QUERY_BATCH_SIZE];
+	static uint32_t frames[QUERY_BATCH_SIZE];
+	queryBatch batch;
+	char line[FRAME_INPUT_LINE_SIZE];
+	uint64_t seq = 0;
+	size_t count = 0;
+	size_t invalidLines = 0;
+	int result = 0;
+
+	if (!query_compile(&query, text, queryColumnNames, QUERY_FRAME_COLUMNS)) {
+		fprintf(stderr, "Wrong query, %s at \"%s\"\n", query.error, query.position);
+		return 1;
+	}
+	for (int column = 0; column < QUERY_FRAME_COLUMNS; column++) {
+		batch.columns[column] = columns[column];
+	}
+
+	while (true) {
+		bool hasLine = fgets(line, sizeof(line), input) != NULL;
+		if (hasLine) {
+			size_t length = strcspn(line, "\r\n");
+			uint32_t device;
+			uint32_t frame;
+			if (length == 0) {
+				continue;
+			}
+			if (!parseDeviceFrameLine(line, length, &device, &frame)) {
+				invalidLines++;
+				continue;
+			}
+			devices[count] = device;
+			frames[count] = frame;
+			if (++count < QUERY_BATCH_SIZE) {
+				continue;
+			}
+		}
+
+		if (count > 0) {
+			decodeQueryBatch(query.usedColumns, devices, frames, count, seq, columns);
+			batch.count = count;
+			if (!query_run_batch(&query, &batch)) {
+				fprintf(stderr, "Not enough memory for the groups of the query\n");
+				result = 1;
+				break;
+			}
+			seq += count;
+			count = 0;
+		}
+		if (!hasLine) {
+			break;
+		}
+	}
+
+	if (result == 0) {
+		query_sort_groups(&query);
+		printQueryResult(&query);
+		fprintf(stderr, "Selected %" PRIu64 " of %" PRIu64 " frames\n", query.selectedRows, query.rows);
+	}
+	if (invalidLines > 0) {
+		fprintf(stderr, "Skipped %zu lines that are not \"<device> <frame>\"\n", invalidLines);
+	}
+	query_free(&query);
+	return result;
+}
+
+void decodeQueryBatch(uint32_t usedColumns, const uint32_t* devices, const uint32_t* frames, size_t count, uint64_t firstSeq,
+	int64_t (*columns)[QUERY_BATCH_SIZE]) {
+	// One loop per field, only for the fields the query reads
+	if (usedColumns & (1u << QUERY_COLUMN_DEVICE)) {
+		for (size_t i = 0; i < count; i++) {
+			columns[QUERY_COLUMN_DEVICE][i] = devices[i];
+		}
+	}
+	if (usedColumns & (1u << QUERY_COLUMN_FRAME)) {
+		for (size_t i = 0; i < count; i++) {
+			columns[QUERY_COLUMN_FRAME][i] = frames[i];
+		}
+	}
+	if (usedColumns & (1u << QUERY_COLUMN_SEQ)) {
+		for (size_t i = 0; i < count; i++) {
+			columns[QUERY_COLUMN_SEQ][i] = (int64_t)(firstSeq + i);
+		}
+	}
+	if (usedColumns & (1u << QUERY_COLUMN_TEMPERATURE)) {
+		for (size_t i = 0; i < count; i++) {
+			columns[QUERY_COLUMN_TEMPERATURE][i] = getTemperature(frames[i], TEMPERATURE_BITS_MASK);
+		}
+	}
+	if (usedColumns & (1u << QUERY_COLUMN_PRESSURE)) {
+		for (size_t i = 0; i < count; i++) {
+			columns[QUERY_COLUMN_PRESSURE][i] = getPressure(frames[i], PRESSURE_BITS_MASK, PRESSURE_BITS_SHIFT);
+		}
+	}
+	if (usedColumns & (1u << QUERY_COLUMN_HUMIDITY)) {
+		for (size_t i = 0; i < count; i++) {
+			columns[QUERY_COLUMN_HUMIDITY][i] = getHumidity(frames[i], HUMIDITY_BITS_MASK, HUMIDITY_BITS_SHIFT);
+		}
+	}
+	if (usedColumns & (1u << QUERY_COLUMN_HUMIDITY_BITS)) {
+		for (size_t i = 0; i < count; i++) {
+			columns[QUERY_COLUMN_HUMIDITY_BITS][i] = bit_popcount32(getHumidity(frames[i], HUMIDITY_BITS_MASK, HUMIDITY_BITS_SHIFT));
+		}
+	}
+	if (usedColumns & (1u << QUERY_COLUMN_FLUID_LEVEL)) {
+		for (size_t i = 0; i < count; i++) {
+			columns[QUERY_COLUMN_FLUID_LEVEL][i] = getFluidLevel(frames[i], FLUID_LEVEL_BITS_MASK, FLUID_LEVEL_BITS_SHIFT);
+		}
+	}
+	if (usedColumns & (1u << QUERY_COLUMN_ALARMS)) {
+		for (size_t i = 0; i < count; i++) {
+			uint32_t data = frames[i];
+			columns[QUERY_COLUMN_ALARMS][i] = classifyAlarms(getTemperature(data, TEMPERATURE_BITS_MASK),
+				getPressure(data, PRESSURE_BITS_MASK, PRESSURE_BITS_SHIFT), getHumidity(data, HUMIDITY_BITS_MASK, HUMIDITY_BITS_SHIFT),
+				getFluidLevel(data, FLUID_LEVEL_BITS_MASK, FLUID_LEVEL_BITS_SHIFT));
+		}
+	}
+}
+
+void printQueryResult(const batchQuery* query) {
+	bool isGrouped = query->groupBy != QUERY_NO_NODE;
+
+	printf("#");
+	if (isGrouped) {
+		printf(" %.*s |", (int)query->groupByTextLength, query->groupByText);
+	}
+	for (int a = 0; a < query->aggregateCount; a++) {
+		printf(" %.*s%s", (int)query->aggregates[a].textLength, query->aggregates[a].text, (a + 1 < query->aggregateCount) ? " |" : "");
+	}
+	putchar('\n');
+
+	// Without groups there is always one line, also when no frame was selected
+	if (!isGrouped && query->groupCount == 0) {
+		for (int a = 0; a < query->aggregateCount; a++) {
+			printf((a == 0) ? "%s" : " %s", (query->aggregates[a].type == QUERY_COUNT) ? "0" : "-");
+		}
+		putchar('\n');
+		return;
+	}
+	for (size_t g = 0; g < query->groupCount; g++) {
+		const queryGroup* group = &query->groups[g];
+		if (isGrouped) {
+			printf("%" PRId64 " ", group->key);
+		}
+		for (int a = 0; a < query->aggregateCount; a++) {
+			if (a > 0) {
+				putchar(' ');
+			}
+			switch (query->aggregates[a].type) {
+			case QUERY_COUNT:
+				printf("%" PRIu64, group->rows);
+				break;
+			case QUERY_SUM:
+				printf("%" PRId64, group->sum[a]);
+				break;
+			case QUERY_MEAN:
+				printf("%.3f", (double)group->sum[a] / (double)group->rows);
+				break;
+			case QUERY_MIN:
+				printf("%" PRId64, group->min[a]);
+				break;
+			default:
+				printf("%" PRId64, group->max[a]);
+				break;
+			}
+		}
+		putchar('\n');
+	}
+}
+
+int applyAlarmRules(FILE* input, const char* path, bool useJit) {
+	static alarmRuleSet rules;
+	static char text[RULES_MAX_FILE_SIZE];
+	static uint32_t devices[RULES_BATCH_FRAMES];
+	static uint32_t frames[RULES_BATCH_FRAMES];
+	static uint32_t masks[RULES_BATCH_FRAMES];
+	char line[FRAME_INPUT_LINE_SIZE];
+	uint64_t total = 0;
+	uint64_t alarmed = 0;
+	size_t length;
+	size_t count = 0;
+	size_t invalidLines = 0;
+
+	if (strcmp(path, "default") == 0) {
+		length = strlen(TANK_DEFAULT_RULES);
+		memcpy(text, TANK_DEFAULT_RULES, length);
+	}
+	else {
+		FILE* file = fopen(path, "rb");
+		if (file == NULL) {
+			fprintf(stderr, "Cannot read the rules %s\n", path);
+			return 1;
+		}
+		length = fread(text, 1, sizeof(text), file);
+		bool isTooLong = (length == sizeof(text));
+		fclose(file);
+		if (isTooLong) {
+			fprintf(stderr, "The rules %s are longer than %d bytes\n", path, RULES_MAX_FILE_SIZE);
+			return 1;
+		}
+	}
+	if (!alarm_rules_compile(&rules, text, length, tankFrameFields, TANK_FRAME_FIELD_COUNT, useJit)) {
+		fprintf(stderr, "%s, line %zu: %s\n", path, rules.errorLine, rules.error);
+		return 1;
+	}
+
+	while (true) {
+		bool hasLine = fgets(line, sizeof(line), input) != NULL;
+		if (hasLine) {
+			size_t lineLength = strcspn(line, "\r\n");
+			uint32_t device;
+			uint32_t frame;
+			if (lineLength == 0) {
+				continue;
+			}
+			if (!parseDeviceFrameLine(line, lineLength, &device, &frame)) {
+				invalidLines++;
+				continue;
+			}
+			devices[count] = device;
+			frames[count] = frame;
+			// The rule set decides what is critical, so every frame is classified as soon as it is read
+			alarm_rules_run(&rules, &frames[count], &masks[count], 1);
+			reportCriticalAlarm(true, device, frame, masks[count]);
+			if (++count < RULES_BATCH_FRAMES) {
+				continue;
+			}
+		}
+		alarmed += printRuleBatch(devices, frames, masks, count);
+		total += count;
+		count = 0;
+		if (!hasLine || ferror(stdout)) {
+			break;
+		}
+	}
+
+	fprintf(stderr, "%" PRIu64 " of %" PRIu64 " frames with alarms, %zu rules %s\n", alarmed, total, rules.count,
+		(rules.compiled != NULL) ? "compiled to machine code" : "interpreted");
+	if (invalidLines > 0) {
+		fprintf(stderr, "Skipped %zu lines that are not \"<device> <frame>\"\n", invalidLines);
+	}
+	alarm_rules_free(&rules);
+	return ferror(stdout) ? 1 : 0;
+}
+
+size_t printRuleBatch(const uint32_t* devices, const uint32_t* frames, const uint32_t* masks, size_t count) {
+	static char outputBuffer[FRAME_OUTPUT_BUFFER_SIZE];
+	size_t used = 0;
+	size_t alarmed = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		if (masks[i] == 0) {
+			continue;
+		}
+		if (used > FRAME_OUTPUT_BUFFER_SIZE - RULES_OUTPUT_LINE_SIZE) {
+			fwrite(outputBuffer, 1, used, stdout);
+			used = 0;
+		}
+		used += format_decimal_u64(devices[i], outputBuffer + used);
+		outputBuffer[used++] = ' ';
+		used += format_hex_fixed(frames[i], 32, outputBuffer + used);
+		outputBuffer[used++] = ' ';
+		used += format_hex_fixed(masks[i], 32, outputBuffer + used);
+		outputBuffer[used++] = '\n';
+		alarmed++;
+	}
+	fwrite(outputBuffer, 1, used, stdout);
+	return alarmed;
+}
+
+#if defined(FRAME_PLUGIN_SUPPORTED)
+int runFramePlugin(FILE* input, const char* path, const char* argument) {
+	static uint32_t devices[PLUGIN_BATCH_FRAMES];
+	static uint32_t frames[PLUGIN_BATCH_FRAMES];
+	static int16_t temperature[PLUGIN_BATCH_FRAMES];
+	static uint16_t pressure[PLUGIN_BATCH_FRAMES];
+	static uint8_t humidity[PLUGIN_BATCH_FRAMES];
+	static uint8_t humidityBits[PLUGIN_BATCH_FRAMES];
+	static uint16_t fluidLevel[PLUGIN_BATCH_FRAMES];
+	static uint32_t alarms[PLUGIN_BATCH_FRAMES];
+	static int64_t values[PLUGIN_BATCH_FRAMES];
+	framePluginBatch batch = { 0, devices, frames, temperature, pressure, humidity, humidityBits, fluidLevel, alarms, values, false };
+	framePluginHandle plugin;
+	const char* error;
+	char line[FRAME_INPUT_LINE_SIZE];
+	uint64_t total = 0;
+	uint64_t alarmed = 0;
+	size_t invalidLines = 0;
+
+	if (!frame_plugin_load(&plugin, path, argument, &error)) {
+		fprintf(stderr, "Cannot load the plugin %s: %s\n", path, error);
+		return 1;
+	}
+
+	while (true) {
+		bool hasLine = fgets(line, sizeof(line), input) != NULL;
+		if (hasLine) {
+			size_t length = strcspn(line, "\r\n");
+			uint32_t device;
+			uint32_t frame;
+			if (length == 0) {
+				continue;
+			}
+			if (!parseDeviceFrameLine(line, length, &device, &frame)) {
+				invalidLines++;
+				continue;
+			}
+			devices[batch.count] = device;
+			frames[batch.count] = frame;
+			reportCriticalAlarm(true, device, frame, decodePluginFrame(&batch, batch.count));
+			if (++batch.count < PLUGIN_BATCH_FRAMES) {
+				continue;
+			}
+		}
+		if (batch.count > 0) {
+			frame_plugin_process(&plugin, &batch);
+			alarmed += printPluginBatch(&batch);
+			total += batch.count;
+			batch.count = 0;
+		}
+		if (!hasLine || ferror(stdout)) {
+			break;
+		}
+	}
+
+	fflush(stdout);
+	frame_plugin_unload(&plugin);
+	fprintf(stderr, "%" PRIu64 " of %" PRIu64 " frames with alarms\n", alarmed, total);
+	if (invalidLines > 0) {
+		fprintf(stderr, "Skipped %zu lines that are not \"<device> <frame>\"\n", invalidLines);
+	}
+	return ferror(stdout) ? 1 : 0;
+}
+#else
+int runFramePlugin(FILE* input, const char* path, const char* argument) {
+	(void)input;
+	(void)argument;
+	fprintf(stderr, "Loading the plugin %s needs a POSIX system\n", path);
+	return 1;
+}
+#endif
+
+uint32_t decodePluginFrame(framePluginBatch* batch, size_t index) {
+	// The arrays of the batch are the host's own, the plugin only gets them as const
+	int16_t* temperature = (int16_t*)batch->temperature;
+	uint16_t* pressure = (uint16_t*)batch->pressure;
+	uint8_t* humidity = (uint8_t*)batch->humidity;
+	uint8_t* humidityBits = (uint8_t*)batch->humidityBits;
+	uint16_t* fluidLevel = (uint16_t*)batch->fluidLevel;
+	uint32_t data = batch->frames[index];
+
+	temperature[index] = getTemperature(data, TEMPERATURE_BITS_MASK);
+	pressure[index] = getPressure(data, PRESSURE_BITS_MASK, PRESSURE_BITS_SHIFT);
+	humidity[index] = getHumidity(data, HUMIDITY_BITS_MASK, HUMIDITY_BITS_SHIFT);
+	humidityBits[index] = (uint8_t)bit_popcount32(humidity[index]);
+	fluidLevel[index] = getFluidLevel(data, FLUID_LEVEL_BITS_MASK, FLUID_LEVEL_BITS_SHIFT);
+	batch->alarms[index] = classifyAlarms(temperature[index], pressure[index], humidity[index], fluidLevel[index]);
+	return batch->alarms[index];
+}
+
+size_t printPluginBatch(const framePluginBatch* batch) {
+	static char outputBuffer[FRAME_OUTPUT_BUFFER_SIZE];
+	size_t used = 0;
+	size_t alarmed = 0;
+
+	for (size_t i = 0; i < batch->count; i++) {
+		alarmed += (batch->alarms[i] != 0);
+		if (batch->alarms[i] == 0 && !batch->hasValues) {
+			continue;
+		}
+		if (used > FRAME_OUTPUT_BUFFER_SIZE - PLUGIN_OUTPUT_LINE_SIZE) {
+			fwrite(outputBuffer, 1, used, stdout);
+			used = 0;
+		}
+		used += format_decimal_u64(batch->devices[i], outputBuffer + used);
+		outputBuffer[used++] = ' ';
+		used += format_hex_fixed(batch->frames[i], 32, outputBuffer + used);
+		outputBuffer[used++] = ' ';
+		used += format_hex_fixed(batch->alarms[i], 32, outputBuffer + used);
+		if (batch->hasValues) {
+			int64_t value = batch->values[i];
+			outputBuffer[used++] = ' ';
+			if (value < 0) {
+				outputBuffer[used++] = '-';
+			}
+			used += format_decimal_u64((value < 0) ? 0 - (uint64_t)value : (uint64_t)value, outputBuffer + used);
 		}
+		outputBuffer[used++] = '\n';
 	}
-	return (counter > 2);
+	fwrite(outputBuffer, 1, used, stdout);
+	return alarmed;
 }
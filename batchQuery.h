@@ -0,0 +1,810 @@
+#ifndef BATCH_QUERY_H
+#define BATCH_QUERY_H
+
+// Ad-hoc filter/aggregate queries over columns of 64-bit integers, for example
+//   mean(pressure), count where temperature > 80 and humbits >= 2 by seq / 360000
+// The text is compiled once into a tree of operators. Rows arrive in struct-of-arrays batches (one array of
+// QUERY_BATCH_SIZE values per column) and every operator handles a whole batch in one tight loop.
+// Filters never copy rows: each condition narrows a selection vector (the numbers of the rows that passed
+// so far), and the next condition and the aggregates only look at the selected rows. Without a selection
+// (all rows pass) the loops run over the plain arrays, which the compiler vectorizes.
+//
+//   query      := aggregate {"," aggregate} ["where" expression] ["by" expression]
+//   aggregate  := "count" | ("sum" | "mean" | "min" | "max") "(" expression ")"
+//   expression := "or" of "and" of ["not"] comparisons (< <= > >= == = !=) of + - * / % & arithmetic
+//                 on columns, decimal or 0x numbers and parentheses ("alarms & 0x10" tests a flag)
+// A comparison is 1 or 0 as a value; as a condition any value other than 0 is true.
+// Arithmetic wraps around like unsigned 64-bit integers, division and remainder by 0 give 0.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "numberParsing.h"
+
+#define QUERY_BATCH_SIZE 1024                   // rows per batch, selection vectors hold 16-bit row numbers
+#define QUERY_MAX_COLUMNS 16
+#define QUERY_MAX_NODES 64
+#define QUERY_MAX_AGGREGATES 8
+#define QUERY_NO_NODE -1
+#define QUERY_EMPTY_SLOT UINT32_MAX
+#define QUERY_MIN_GROUP_SLOTS 64
+
+typedef enum {
+    QUERY_COLUMN,
+    QUERY_CONSTANT,
+    QUERY_ADD,
+    QUERY_SUBTRACT,
+    QUERY_MULTIPLY,
+    QUERY_DIVIDE,
+    QUERY_MODULO,
+    QUERY_BIT_AND,
+    QUERY_NEGATE,
+    QUERY_LESS,
+    QUERY_LESS_EQUAL,
+    QUERY_GREATER,
+    QUERY_GREATER_EQUAL,
+    QUERY_EQUAL,
+    QUERY_NOT_EQUAL,
+    QUERY_AND,
+    QUERY_OR,
+    QUERY_NOT
+} queryNodeType;
+
+typedef enum {
+    QUERY_COUNT,
+    QUERY_SUM,
+    QUERY_MEAN,
+    QUERY_MIN,
+    QUERY_MAX
+} queryAggregateType;
+
+typedef struct {
+    queryNodeType type;
+    int left;
+    int right;                  // QUERY_NO_NODE for NEGATE and NOT
+    int column;
+    int64_t constant;
+    int64_t* values;            // results of the last batch, indexed by row
+    uint16_t* selections[2];    // rows kept by each child of AND, OR and NOT
+} queryNode;
+
+typedef struct {
+    queryAggregateType type;
+    int argument;               // QUERY_NO_NODE for count
+    const char* text;           // the aggregate as written in the query
+    size_t textLength;
+} queryAggregate;
+
+typedef struct {
+    int64_t key;
+    uint64_t rows;
+    int64_t sum[QUERY_MAX_AGGREGATES];
+    int64_t min[QUERY_MAX_AGGREGATES];
+    int64_t max[QUERY_MAX_AGGREGATES];
+} queryGroup;
+
+// One batch of rows: count values in every column the query uses
+typedef struct {
+    const int64_t* columns[QUERY_MAX_COLUMNS];
+    size_t count;
+} queryBatch;
+
+typedef struct {
+    queryNode nodes[QUERY_MAX_NODES];
+    int nodeCount;
+    queryAggregate aggregates[QUERY_MAX_AGGREGATES];
+    int aggregateCount;
+    int filter;                 // QUERY_NO_NODE when every row counts
+    int groupBy;                // QUERY_NO_NODE for a single group
+    const char* groupByText;
+    size_t groupByTextLength;
+    uint32_t usedColumns;       // bit per column the batches must fill
+
+    const char* const* columnNames;
+    int columnCount;
+    const char* position;       // parser position, where the error is after a failed compile
+    const char* error;
+
+    int64_t* values;            // QUERY_BATCH_SIZE results per node
+    uint16_t* selectionBuffers; // 2 * QUERY_BATCH_SIZE rows per node
+    uint16_t selection[QUERY_BATCH_SIZE];
+    uint32_t rowGroups[QUERY_BATCH_SIZE];
+
+    queryGroup* groups;         // in order of the first row, sorted by key by query_sort_groups()
+    size_t groupCount;
+    size_t groupCapacity;
+    uint32_t* slots;            // group per slot, linear probing
+    size_t slotMask;
+    size_t lastGroup;           // runs of rows usually share their key
+    uint64_t rows;
+    uint64_t selectedRows;
+} batchQuery;
+
+// ---------------------------------------------------------------------------
+// Parser
+// ---------------------------------------------------------------------------
+
+static inline bool query_is_word_character(char character) {
+    return (character >= 'a' && character <= 'z') || (character >= 'A' && character <= 'Z')
+        || (character >= '0' && character <= '9') || character == '_';
+}
+
+static inline void query_skip_spaces(batchQuery* query) {
+    while (*query->position == ' ' || *query->position == '\t') {
+        query->position++;
+    }
+}
+
+// Consumes a symbol or a keyword (which must not continue as a longer word)
+static inline bool query_accept(batchQuery* query, const char* token) {
+    size_t length = strlen(token);
+    query_skip_spaces(query);
+    if (strncmp(query->position, token, length) != 0) {
+        return false;
+    }
+    if (query_is_word_character(token[0]) && query_is_word_character(query->position[length])) {
+        return false;
+    }
+    query->position += length;
+    return true;
+}
+
+static inline int query_fail(batchQuery* query, const char* error) {
+    if (query->error == NULL) {
+        query->error = error;
+    }
+    return QUERY_NO_NODE;
+}
+
+static inline int query_add_node(batchQuery* query, queryNodeType type, int left, int right) {
+    if (query->nodeCount == QUERY_MAX_NODES) {
+        return query_fail(query, "the query is too long");
+    }
+    queryNode* node = &query->nodes[query->nodeCount];
+    memset(node, 0, sizeof(*node));
+    node->type = type;
+    node->left = left;
+    node->right = right;
+    return query->nodeCount++;
+}
+
+static int query_parse_or(batchQuery* query);
+
+static inline int query_parse_primary(batchQuery* query) {
+    query_skip_spaces(query);
+    const char* start = query->position;
+    size_t length = 0;
+    while (query_is_word_character(start[length])) {
+        length++;
+    }
+
+    if (query_accept(query, "(")) {
+        int inner = query_parse_or(query);
+        if (inner != QUERY_NO_NODE && !query_accept(query, ")")) {
+            return query_fail(query, "missing )");
+        }
+        return inner;
+    }
+    if (length == 0) {
+        return query_fail(query, "expected a column, a number or (");
+    }
+    if (start[0] >= '0' && start[0] <= '9') {
+        uint64_t value;
+        bool isNumber = (length > 2 && start[1] == 'x') ? parse_hex_string(start, length, &value)
+            : parse_decimal_string(start, length, INT64_MAX, &value) == PARSE_OK;
+        if (!isNumber) {
+            return query_fail(query, "not a number");
+        }
+        int index = query_add_node(query, QUERY_CONSTANT, QUERY_NO_NODE, QUERY_NO_NODE);
+        if (index != QUERY_NO_NODE) {
+            query->nodes[index].constant = (int64_t)value;
+            query->position += length;
+        }
+        return index;
+    }
+    for (int column = 0; column < query->columnCount; column++) {
+        if (strlen(query->columnNames[column]) == length && strncmp(start, query->columnNames[column], length) == 0) {
+            int index = query_add_node(query, QUERY_COLUMN, QUERY_NO_NODE, QUERY_NO_NODE);
+            if (index != QUERY_NO_NODE) {
+                query->nodes[index].column = column;
+                query->usedColumns |= 1u << column;
+                query->position += length;
+            }
+            return index;
+        }
+    }
+    return query_fail(query, "unknown column");
+}
+
+static inline int query_parse_unary(batchQuery* query) {
+    if (!query_accept(query, "-")) {
+        return query_parse_primary(query);
+    }
+    int operand = query_parse_unary(query);
+    if (operand == QUERY_NO_NODE) {
+        return QUERY_NO_NODE;
+    }
+    if (query->nodes[operand].type == QUERY_CONSTANT) {
+        // Negative numbers stay constants, comparisons with constants take the faster path
+        query->nodes[operand].constant = (int64_t)(0 - (uint64_t)query->nodes[operand].constant);
+        return operand;
+    }
+    return query_add_node(query, QUERY_NEGATE, operand, QUERY_NO_NODE);
+}
+
+static inline int query_parse_product(batchQuery* query) {
+    int left = query_parse_unary(query);
+    while (left != QUERY_NO_NODE) {
+        queryNodeType type;
+        if (query_accept(query, "*")) {
+            type = QUERY_MULTIPLY;
+        }
+        else if (query_accept(query, "/")) {
+            type = QUERY_DIVIDE;
+        }
+        else if (query_accept(query, "%")) {
+            type = QUERY_MODULO;
+        }
+        else if (query_accept(query, "&")) {
+            type = QUERY_BIT_AND;
+        }
+        else {
+            break;
+        }
+        int right = query_parse_unary(query);
+        left = (right == QUERY_NO_NODE) ? QUERY_NO_NODE : query_add_node(query, type, left, right);
+    }
+    return left;
+}
+
+static inline int query_parse_sum(batchQuery* query) {
+    int left = query_parse_product(query);
+    while (left != QUERY_NO_NODE) {
+        queryNodeType type;
+        if (query_accept(query, "+")) {
+            type = QUERY_ADD;
+        }
+        else if (query_accept(query, "-")) {
+            type = QUERY_SUBTRACT;
+        }
+        else {
+            break;
+        }
+        int right = query_parse_product(query);
+        left = (right == QUERY_NO_NODE) ? QUERY_NO_NODE : query_add_node(query, type, left, right);
+    }
+    return left;
+}
+
+static inline int query_parse_comparison(batchQuery* query) {
+    int left = query_parse_sum(query);
+    if (left == QUERY_NO_NODE) {
+        return QUERY_NO_NODE;
+    }
+    // Two-character operators first, "<" would also match the start of "<="
+    static const char* const symbols[] = { "<=", ">=", "==", "!=", "<", ">", "=" };
+    static const queryNodeType types[] = { QUERY_LESS_EQUAL, QUERY_GREATER_EQUAL, QUERY_EQUAL, QUERY_NOT_EQUAL,
+                                           QUERY_LESS, QUERY_GREATER, QUERY_EQUAL };
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        if (query_accept(query, symbols[i])) {
+            int right = query_parse_sum(query);
+            return (right == QUERY_NO_NODE) ? QUERY_NO_NODE : query_add_node(query, types[i], left, right);
+        }
+    }
+    return left;
+}
+
+static inline int query_parse_not(batchQuery* query) {
+    if (query_accept(query, "not")) {
+        int operand = query_parse_not(query);
+        return (operand == QUERY_NO_NODE) ? QUERY_NO_NODE : query_add_node(query, QUERY_NOT, operand, QUERY_NO_NODE);
+    }
+    return query_parse_comparison(query);
+}
+
+static inline int query_parse_and(batchQuery* query) {
+    int left = query_parse_not(query);
+    while (left != QUERY_NO_NODE && query_accept(query, "and")) {
+        int right = query_parse_not(query);
+        left = (right == QUERY_NO_NODE) ? QUERY_NO_NODE : query_add_node(query, QUERY_AND, left, right);
+    }
+    return left;
+}
+
+static int query_parse_or(batchQuery* query) {
+    int left = query_parse_and(query);
+    while (left != QUERY_NO_NODE && query_accept(query, "or")) {
+        int right = query_parse_and(query);
+        left = (right == QUERY_NO_NODE) ? QUERY_NO_NODE : query_add_node(query, QUERY_OR, left, right);
+    }
+    return left;
+}
+
+static inline bool query_parse_aggregate(batchQuery* query) {
+    static const char* const names[] = { "count", "sum", "mean", "min", "max" };
+    static const queryAggregateType types[] = { QUERY_COUNT, QUERY_SUM, QUERY_MEAN, QUERY_MIN, QUERY_MAX };
+
+    if (query->aggregateCount == QUERY_MAX_AGGREGATES) {
+        query_fail(query, "too many aggregates");
+        return false;
+    }
+    queryAggregate* aggregate = &query->aggregates[query->aggregateCount];
+    query_skip_spaces(query);
+    aggregate->text = query->position;
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        if (!query_accept(query, names[i])) {
+            continue;
+        }
+        aggregate->type = types[i];
+        aggregate->argument = QUERY_NO_NODE;
+        if (types[i] == QUERY_COUNT) {
+            // "count()" is "count" too
+            if (query_accept(query, "(") && !query_accept(query, ")")) {
+                query_fail(query, "missing )");
+                return false;
+            }
+        }
+        else {
+            if (!query_accept(query, "(")) {
+                query_fail(query, "expected ( after the aggregate");
+                return false;
+            }
+            aggregate->argument = query_parse_or(query);
+            if (aggregate->argument == QUERY_NO_NODE) {
+                return false;
+            }
+            if (!query_accept(query, ")")) {
+                query_fail(query, "missing )");
+                return false;
+            }
+        }
+        aggregate->textLength = (size_t)(query->position - aggregate->text);
+        while (aggregate->textLength > 0 && aggregate->text[aggregate->textLength - 1] == ' ') {
+            aggregate->textLength--;
+        }
+        query->aggregateCount++;
+        return true;
+    }
+    query_fail(query, "expected count, sum, mean, min or max");
+    return false;
+}
+
+static inline void query_free(batchQuery* query) {
+    free(query->values);
+    free(query->selectionBuffers);
+    free(query->groups);
+    free(query->slots);
+    query->values = NULL;
+    query->selectionBuffers = NULL;
+    query->groups = NULL;
+    query->slots = NULL;
+}
+
+// Compiles the query for the given columns. On failure query->error says why and query->position
+// points into text where parsing stopped.
+static inline bool query_compile(batchQuery* query, const char* text, const char* const* columnNames, int columnCount) {
+    memset(query, 0, sizeof(*query));
+    query->columnNames = columnNames;
+    query->columnCount = (columnCount > QUERY_MAX_COLUMNS) ? QUERY_MAX_COLUMNS : columnCount;
+    query->position = text;
+    query->filter = QUERY_NO_NODE;
+    query->groupBy = QUERY_NO_NODE;
+
+    do {
+        if (!query_parse_aggregate(query)) {
+            return false;
+        }
+    } while (query_accept(query, ","));
+    if (query_accept(query, "where")) {
+        query->filter = query_parse_or(query);
+        if (query->filter == QUERY_NO_NODE) {
+            return false;
+        }
+    }
+    if (query_accept(query, "by")) {
+        query_skip_spaces(query);
+        query->groupByText = query->position;
+        query->groupBy = query_parse_or(query);
+        if (query->groupBy == QUERY_NO_NODE) {
+            return false;
+        }
+        query->groupByTextLength = (size_t)(query->position - query->groupByText);
+        while (query->groupByTextLength > 0 && query->groupByText[query->groupByTextLength - 1] == ' ') {
+            query->groupByTextLength--;
+        }
+    }
+    query_skip_spaces(query);
+    if (*query->position != '\0') {
+        query_fail(query, "unexpected text");
+        return false;
+    }
+
+    size_t nodes = (size_t)query->nodeCount;
+    query->values = malloc(nodes * QUERY_BATCH_SIZE * sizeof(int64_t));
+    query->selectionBuffers = malloc(nodes * 2 * QUERY_BATCH_SIZE * sizeof(uint16_t));
+    if ((nodes > 0 && (query->values == NULL || query->selectionBuffers == NULL))) {
+        query_free(query);
+        query_fail(query, "not enough memory");
+        return false;
+    }
+    for (size_t i = 0; i < nodes; i++) {
+        queryNode* node = &query->nodes[i];
+        node->values = query->values + i * QUERY_BATCH_SIZE;
+        node->selections[0] = query->selectionBuffers + 2 * i * QUERY_BATCH_SIZE;
+        node->selections[1] = node->selections[0] + QUERY_BATCH_SIZE;
+        if (node->type == QUERY_CONSTANT) {
+            for (size_t row = 0; row < QUERY_BATCH_SIZE; row++) {
+                node->values[row] = node->constant;
+            }
+        }
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Vectorized operators
+// ---------------------------------------------------------------------------
+
+static inline int64_t query_divide(int64_t dividend, int64_t divisor) {
+    if (divisor == 0) {
+        return 0;
+    }
+    // INT64_MIN / -1 overflows, negate it instead
+    return (divisor == -1) ? (int64_t)(0 - (uint64_t)dividend) : dividend / divisor;
+}
+
+static inline int64_t query_modulo(int64_t dividend, int64_t divisor) {
+    return (divisor == 0 || divisor == -1) ? 0 : dividend % divisor;
+}
+
+// Runs expression for every selected row (all count rows when selection is NULL)
+#define QUERY_FOR_ROWS(selection, count, statement)                     \
+    do {                                                                \
+        if ((selection) == NULL) {                                      \
+            for (size_t row = 0; row < (count); row++) {                \
+                statement;                                              \
+            }                                                           \
+        }                                                               \
+        else {                                                          \
+            for (size_t selected = 0; selected < (count); selected++) { \
+                size_t row = (selection)[selected];                     \
+                statement;                                              \
+            }                                                           \
+        }                                                               \
+    } while (0)
+
+// Keeps the selected rows for which condition holds, without branching on it
+#define QUERY_KEEP_ROWS(selection, count, kept, output, condition)      \
+    QUERY_FOR_ROWS(selection, count, (output)[kept] = (uint16_t)row; (kept) += (condition) ? 1 : 0)
+
+// Values of a node for the selected rows, indexed by row. Columns and constants are not copied.
+static const int64_t* query_evaluate(batchQuery* query, int index, const queryBatch* batch,
+                                     const uint16_t* selection, size_t count) {
+    queryNode* node = &query->nodes[index];
+    if (node->type == QUERY_COLUMN) {
+        return batch->columns[node->column];
+    }
+    if (node->type == QUERY_CONSTANT) {
+        return node->values;
+    }
+
+    const int64_t* left = query_evaluate(query, node->left, batch, selection, count);
+    const int64_t* right = (node->right == QUERY_NO_NODE) ? left : query_evaluate(query, node->right, batch, selection, count);
+    int64_t* out = node->values;
+    switch (node->type) {
+    case QUERY_ADD:
+        QUERY_FOR_ROWS(selection, count, out[row] = (int64_t)((uint64_t)left[row] + (uint64_t)right[row]));
+        break;
+    case QUERY_SUBTRACT:
+        QUERY_FOR_ROWS(selection, count, out[row] = (int64_t)((uint64_t)left[row] - (uint64_t)right[row]));
+        break;
+    case QUERY_MULTIPLY:
+        QUERY_FOR_ROWS(selection, count, out[row] = (int64_t)((uint64_t)left[row] * (uint64_t)right[row]));
+        break;
+    case QUERY_DIVIDE:
+        QUERY_FOR_ROWS(selection, count, out[row] = query_divide(left[row], right[row]));
+        break;
+    case QUERY_MODULO:
+        QUERY_FOR_ROWS(selection, count, out[row] = query_modulo(left[row], right[row]));
+        break;
+    case QUERY_BIT_AND:
+        QUERY_FOR_ROWS(selection, count, out[row] = left[row] & right[row]);
+        break;
+    case QUERY_NEGATE:
+        QUERY_FOR_ROWS(selection, count, out[row] = (int64_t)(0 - (uint64_t)left[row]));
+        break;
+    case QUERY_LESS:
+        QUERY_FOR_ROWS(selection, count, out[row] = left[row] < right[row]);
+        break;
+    case QUERY_LESS_EQUAL:
+        QUERY_FOR_ROWS(selection, count, out[row] = left[row] <= right[row]);
+        break;
+    case QUERY_GREATER:
+        QUERY_FOR_ROWS(selection, count, out[row] = left[row] > right[row]);
+        break;
+    case QUERY_GREATER_EQUAL:
+        QUERY_FOR_ROWS(selection, count, out[row] = left[row] >= right[row]);
+        break;
+    case QUERY_EQUAL:
+        QUERY_FOR_ROWS(selection, count, out[row] = left[row] == right[row]);
+        break;
+    case QUERY_NOT_EQUAL:
+        QUERY_FOR_ROWS(selection, count, out[row] = left[row] != right[row]);
+        break;
+    case QUERY_AND:
+        QUERY_FOR_ROWS(selection, count, out[row] = (left[row] != 0) & (right[row] != 0));
+        break;
+    case QUERY_OR:
+        QUERY_FOR_ROWS(selection, count, out[row] = (left[row] != 0) | (right[row] != 0));
+        break;
+    default:
+        QUERY_FOR_ROWS(selection, count, out[row] = left[row] == 0);
+        break;
+    }
+    return out;
+}
+
+// Writes the selected rows for which the node is true into output (which may be the selection itself),
+// returns how many there are
+static size_t query_select(batchQuery* query, int index, const queryBatch* batch,
+                           const uint16_t* selection, size_t count, uint16_t* output) {
+    queryNode* node = &query->nodes[index];
+    size_t kept = 0;
+
+    if (node->type == QUERY_AND) {
+        // The right side only sees the rows the left side kept
+        size_t leftKept = query_select(query, node->left, batch, selection, count, node->selections[0]);
+        return query_select(query, node->right, batch, node->selections[0], leftKept, output);
+    }
+    if (node->type == QUERY_OR) {
+        size_t leftKept = query_select(query, node->left, batch, selection, count, node->selections[0]);
+        size_t rightKept = query_select(query, node->right, batch, selection, count, node->selections[1]);
+        const uint16_t* first = node->selections[0];
+        const uint16_t* second = node->selections[1];
+        size_t i = 0;
+        size_t j = 0;
+        while (i < leftKept && j < rightKept) {
+            uint16_t a = first[i];
+            uint16_t b = second[j];
+            output[kept++] = (a < b) ? a : b;
+            i += (a <= b);
+            j += (b <= a);
+        }
+        while (i < leftKept) {
+            output[kept++] = first[i++];
+        }
+        while (j < rightKept) {
+            output[kept++] = second[j++];
+        }
+        return kept;
+    }
+    if (node->type == QUERY_NOT) {
+        size_t excluded = query_select(query, node->left, batch, selection, count, node->selections[0]);
+        const uint16_t* skip = node->selections[0];
+        size_t j = 0;
+        QUERY_FOR_ROWS(selection, count,
+            bool isSkipped = (j < excluded && skip[j] == row);
+            output[kept] = (uint16_t)row;
+            kept += !isSkipped;
+            j += isSkipped);
+        return kept;
+    }
+
+    if (node->type >= QUERY_LESS && node->type <= QUERY_NOT_EQUAL) {
+        const int64_t* left = query_evaluate(query, node->left, batch, selection, count);
+        const queryNode* rightNode = &query->nodes[node->right];
+        if (rightNode->type == QUERY_CONSTANT) {
+            // The usual "column > number": compare with a scalar
+            int64_t limit = rightNode->constant;
+            switch (node->type) {
+            case QUERY_LESS:
+                QUERY_KEEP_ROWS(selection, count, kept, output, left[row] < limit);
+                break;
+            case QUERY_LESS_EQUAL:
+                QUERY_KEEP_ROWS(selection, count, kept, output, left[row] <= limit);
+                break;
+            case QUERY_GREATER:
+                QUERY_KEEP_ROWS(selection, count, kept, output, left[row] > limit);
+                break;
+            case QUERY_GREATER_EQUAL:
+                QUERY_KEEP_ROWS(selection, count, kept, output, left[row] >= limit);
+                break;
+            case QUERY_EQUAL:
+                QUERY_KEEP_ROWS(selection, count, kept, output, left[row] == limit);
+                break;
+            default:
+                QUERY_KEEP_ROWS(selection, count, kept, output, left[row] != limit);
+                break;
+            }
+            return kept;
+        }
+        const int64_t* right = query_evaluate(query, node->right, batch, selection, count);
+        switch (node->type) {
+        case QUERY_LESS:
+            QUERY_KEEP_ROWS(selection, count, kept, output, left[row] < right[row]);
+            break;
+        case QUERY_LESS_EQUAL:
+            QUERY_KEEP_ROWS(selection, count, kept, output, left[row] <= right[row]);
+            break;
+        case QUERY_GREATER:
+            QUERY_KEEP_ROWS(selection, count, kept, output, left[row] > right[row]);
+            break;
+        case QUERY_GREATER_EQUAL:
+            QUERY_KEEP_ROWS(selection, count, kept, output, left[row] >= right[row]);
+            break;
+        case QUERY_EQUAL:
+            QUERY_KEEP_ROWS(selection, count, kept, output, left[row] == right[row]);
+            break;
+        default:
+            QUERY_KEEP_ROWS(selection, count, kept, output, left[row] != right[row]);
+            break;
+        }
+        return kept;
+    }
+
+    const int64_t* values = query_evaluate(query, index, batch, selection, count);
+    QUERY_KEEP_ROWS(selection, count, kept, output, values[row] != 0);
+    return kept;
+}
+
+// ---------------------------------------------------------------------------
+// Groups and aggregates
+// ---------------------------------------------------------------------------
+
+static inline size_t query_group_slot(const batchQuery* query, int64_t key) {
+    return (size_t)(((uint64_t)key * 0x9E3779B97F4A7C15ULL) >> 32) & query->slotMask;
+}
+
+// Index of the key's group, created on its first row. QUERY_EMPTY_SLOT when there is not enough memory.
+static inline uint32_t query_find_group(batchQuery* query, int64_t key) {
+    if (query->groupCount > 0 && query->groups[query->lastGroup].key == key) {
+        return (uint32_t)query->lastGroup;
+    }
+    // Keep the table at most half full, rebuilding it from the group list when it grows
+    if (2 * (query->groupCount + 1) > query->slotMask + 1 || query->slots == NULL) {
+        size_t slotCount = (query->slots == NULL) ? QUERY_MIN_GROUP_SLOTS : 2 * (query->slotMask + 1);
+        uint32_t* slots = malloc(slotCount * sizeof(uint32_t));
+        queryGroup* groups = realloc(query->groups, (slotCount / 2) * sizeof(queryGroup));
+        if (slots == NULL || groups == NULL) {
+            free(slots);
+            if (groups != NULL) {
+                query->groups = groups;
+            }
+            return QUERY_EMPTY_SLOT;
+        }
+        memset(slots, 0xFF, slotCount * sizeof(uint32_t));
+        free(query->slots);
+        query->slots = slots;
+        query->slotMask = slotCount - 1;
+        query->groups = groups;
+        query->groupCapacity = slotCount / 2;
+        for (size_t i = 0; i < query->groupCount; i++) {
+            size_t slot = query_group_slot(query, groups[i].key);
+            while (slots[slot] != QUERY_EMPTY_SLOT) {
+                slot = (slot + 1) & query->slotMask;
+            }
+            slots[slot] = (uint32_t)i;
+        }
+    }
+
+    size_t slot = query_group_slot(query, key);
+    while (query->slots[slot] != QUERY_EMPTY_SLOT) {
+        if (query->groups[query->slots[slot]].key == key) {
+            query->lastGroup = query->slots[slot];
+            return query->slots[slot];
+        }
+        slot = (slot + 1) & query->slotMask;
+    }
+
+    queryGroup* group = &query->groups[query->groupCount];
+    group->key = key;
+    group->rows = 0;
+    for (int i = 0; i < QUERY_MAX_AGGREGATES; i++) {
+        group->sum[i] = 0;
+        group->min[i] = INT64_MAX;
+        group->max[i] = INT64_MIN;
+    }
+    query->slots[slot] = (uint32_t)query->groupCount;
+    query->lastGroup = query->groupCount;
+    return (uint32_t)query->groupCount++;
+}
+
+// Adds the selected rows to their groups
+static inline bool query_aggregate(batchQuery* query, const queryBatch* batch, const uint16_t* selection, size_t count) {
+    if (count == 0) {
+        return true;
+    }
+
+    if (query->groupBy == QUERY_NO_NODE) {
+        uint32_t only = query_find_group(query, 0);
+        if (only == QUERY_EMPTY_SLOT) {
+            return false;
+        }
+        queryGroup* group = &query->groups[only];
+        group->rows += count;
+        for (int a = 0; a < query->aggregateCount; a++) {
+            const queryAggregate* aggregate = &query->aggregates[a];
+            if (aggregate->type == QUERY_COUNT) {
+                continue;
+            }
+            const int64_t* values = query_evaluate(query, aggregate->argument, batch, selection, count);
+            // Separate loops keep every one of them a plain reduction the compiler vectorizes
+            if (aggregate->type == QUERY_SUM || aggregate->type == QUERY_MEAN) {
+                uint64_t sum = 0;
+                QUERY_FOR_ROWS(selection, count, sum += (uint64_t)values[row]);
+                group->sum[a] = (int64_t)((uint64_t)group->sum[a] + sum);
+            }
+            else if (aggregate->type == QUERY_MIN) {
+                int64_t minimum = group->min[a];
+                QUERY_FOR_ROWS(selection, count, minimum = (values[row] < minimum) ? values[row] : minimum);
+                group->min[a] = minimum;
+            }
+            else {
+                int64_t maximum = group->max[a];
+                QUERY_FOR_ROWS(selection, count, maximum = (values[row] > maximum) ? values[row] : maximum);
+                group->max[a] = maximum;
+            }
+        }
+        return true;
+    }
+
+    const int64_t* keys = query_evaluate(query, query->groupBy, batch, selection, count);
+    uint32_t* rowGroups = query->rowGroups;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t group = query_find_group(query, keys[(selection == NULL) ? i : selection[i]]);
+        if (group == QUERY_EMPTY_SLOT) {
+            return false;
+        }
+        rowGroups[i] = group;
+        query->groups[group].rows++;
+    }
+    for (int a = 0; a < query->aggregateCount; a++) {
+        const queryAggregate* aggregate = &query->aggregates[a];
+        if (aggregate->type == QUERY_COUNT) {
+            continue;
+        }
+        const int64_t* values = query_evaluate(query, aggregate->argument, batch, selection, count);
+        for (size_t i = 0; i < count; i++) {
+            queryGroup* group = &query->groups[rowGroups[i]];
+            int64_t value = values[(selection == NULL) ? i : selection[i]];
+            group->sum[a] = (int64_t)((uint64_t)group->sum[a] + (uint64_t)value);
+            group->min[a] = (value < group->min[a]) ? value : group->min[a];
+            group->max[a] = (value > group->max[a]) ? value : group->max[a];
+        }
+    }
+    return true;
+}
+
+// Filters one batch and adds the rows that pass to the aggregates. False when there is not enough memory
+// for the groups.
+static inline bool query_run_batch(batchQuery* query, const queryBatch* batch) {
+    const uint16_t* selection = NULL;
+    size_t count = batch->count;
+    query->rows += count;
+    if (query->filter != QUERY_NO_NODE) {
+        count = query_select(query, query->filter, batch, NULL, count, query->selection);
+        selection = query->selection;
+    }
+    query->selectedRows += count;
+    return query_aggregate(query, batch, selection, count);
+}
+
+static inline int query_compare_groups(const void* first, const void* second) {
+    int64_t a = ((const queryGroup*)first)->key;
+    int64_t b = ((const queryGroup*)second)->key;
+    return (a > b) - (a < b);
+}
+
+// Orders the groups by key for the report; no more batches can be added afterwards
+static inline void query_sort_groups(batchQuery* query) {
+    if (query->groupCount > 1) {
+        qsort(query->groups, query->groupCount, sizeof(queryGroup), query_compare_groups);
+    }
+    free(query->slots);
+    query->slots = NULL;
+}
+
+#endif // BATCH_QUERY_H
@@ -0,0 +1,653 @@
+#ifndef BIG_NUMBER_H
+#define BIG_NUMBER_H
+
+// Numbers wider than uint64_t: unsigned __int128 (where the compiler has it)
+// and arbitrary-length arrays of 32-bit limbs, least significant limb first.
+// 32-bit limbs only need 32x32->64 bit multiplication, so this also builds for MCUs.
+//
+// Hex and binary output is a straight walk over the limbs. Decimal output splits
+// the number by powers 10^(9 * 2^k) (divide and conquer) instead of dividing by 10
+// again and again. The divisions use Barrett reduction with precomputed reciprocals
+// and Karatsuba multiplication, so a conversion costs O(M(n) log n) instead of O(n^2).
+// The reciprocals come from Newton iteration on the same multiplication, so building
+// the power table for the first conversion costs O(M(n)) as well.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bitToolkit.h"
+#include "numberFormatting.h"
+
+#define BIG_LIMB_BITS 32
+#define BIG_HEX_DIGITS_IN_LIMB 8
+#define BIG_DECIMAL_BASE 1000000000u            // 10^9, the biggest power of 10 in one limb
+#define BIG_DECIMAL_BASE_DIGITS 9
+#define BIG_KARATSUBA_THRESHOLD 32              // below this many limbs schoolbook multiplication is faster
+#define BIG_DECIMAL_LEAF_LIMBS 16               // below this many limbs repeated division by 10^9 is faster
+#define BIG_NEWTON_THRESHOLD 64                 // below this many limbs a reciprocal is one long division
+#define BIG_MAX_POWER_LEVELS 40
+
+// Arbitrary-length unsigned number, count never includes leading zero limbs
+typedef struct {
+    uint32_t* limbs;
+    size_t count;
+} bigNumber;
+
+// Powers 10^(9 * 2^k) and their Barrett reciprocals, built once and reused for many conversions
+typedef struct {
+    uint32_t* power[BIG_MAX_POWER_LEVELS];
+    size_t powerCount[BIG_MAX_POWER_LEVELS];
+    uint32_t* reciprocal[BIG_MAX_POWER_LEVELS];
+    size_t reciprocalCount[BIG_MAX_POWER_LEVELS];
+    int levels;
+} bigDecimalPowers;
+
+// Drops leading zero limbs, returns the remaining number of limbs
+static inline size_t big_normalize(const uint32_t* limbs, size_t count) {
+    while (count > 0 && limbs[count - 1] == 0) {
+        count--;
+    }
+    return count;
+}
+
+// Compares two normalized numbers, returns -1, 0 or 1
+static inline int big_compare(const uint32_t* a, size_t aCount, const uint32_t* b, size_t bCount) {
+    if (aCount != bCount) {
+        return (aCount < bCount) ? -1 : 1;
+    }
+    for (size_t i = aCount; i > 0; i--) {
+        if (a[i - 1] != b[i - 1]) {
+            return (a[i - 1] < b[i - 1]) ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+// a += b where aCount >= bCount, returns the carry out of the top limb
+static inline uint32_t big_add_to(uint32_t* a, size_t aCount, const uint32_t* b, size_t bCount) {
+    uint64_t carry = 0;
+    size_t i = 0;
+    for (; i < bCount; i++) {
+        carry += (uint64_t)a[i] + b[i];
+        a[i] = (uint32_t)carry;
+        carry >>= BIG_LIMB_BITS;
+    }
+    for (; carry != 0 && i < aCount; i++) {
+        carry += a[i];
+        a[i] = (uint32_t)carry;
+        carry >>= BIG_LIMB_BITS;
+    }
+    return (uint32_t)carry;
+}
+
+// a -= b where aCount >= bCount, returns the borrow out of the top limb
+static inline uint32_t big_subtract_from(uint32_t* a, size_t aCount, const uint32_t* b, size_t bCount) {
+    uint32_t borrow = 0;
+    size_t i = 0;
+    for (; i < bCount; i++) {
+        uint64_t difference = (uint64_t)a[i] - b[i] - borrow;
+        a[i] = (uint32_t)difference;
+        borrow = (uint32_t)(difference >> 63);
+    }
+    for (; borrow != 0 && i < aCount; i++) {
+        borrow = (a[i] == 0);
+        a[i]--;
+    }
+    return borrow;
+}
+
+// out = a * b, out must have room for aCount + bCount limbs
+static inline void big_multiply_schoolbook(const uint32_t* a, size_t aCount, const uint32_t* b, size_t bCount, uint32_t* out) {
+    memset(out, 0, (aCount + bCount) * sizeof(uint32_t));
+    for (size_t i = 0; i < aCount; i++) {
+        uint64_t carry = 0;
+        for (size_t j = 0; j < bCount; j++) {
+            carry += (uint64_t)a[i] * b[j] + out[i + j];
+            out[i + j] = (uint32_t)carry;
+            carry >>= BIG_LIMB_BITS;
+        }
+        out[i + bCount] = (uint32_t)carry;
+    }
+}
+
+// out = a * b (Karatsuba above BIG_KARATSUBA_THRESHOLD), out must have room for aCount + bCount limbs
+// and must not overlap the inputs. Returns false if there was no memory for the temporaries.
+static inline bool big_multiply(const uint32_t* a, size_t aCount, const uint32_t* b, size_t bCount, uint32_t* out) {
+    if (aCount < bCount) {
+        const uint32_t* swapLimbs = a;
+        a = b;
+        b = swapLimbs;
+        size_t swapCount = aCount;
+        aCount = bCount;
+        bCount = swapCount;
+    }
+    if (bCount < BIG_KARATSUBA_THRESHOLD) {
+        big_multiply_schoolbook(a, aCount, b, bCount, out);
+        return true;
+    }
+
+    size_t half = aCount / 2;
+    size_t outCount = aCount + bCount;
+
+    if (bCount <= half) {
+        // Unbalanced: a = a1 * B^half + a0, so a * b = a0 * b + (a1 * b) * B^half
+        size_t highCount = aCount - half + bCount;
+        uint32_t* high = malloc(highCount * sizeof(uint32_t));
+        if (high == NULL || !big_multiply(a + half, aCount - half, b, bCount, high) ||
+            !big_multiply(a, half, b, bCount, out)) {
+            free(high);
+            return false;
+        }
+        memset(out + half + bCount, 0, (outCount - half - bCount) * sizeof(uint32_t));
+        big_add_to(out + half, outCount - half, high, big_normalize(high, highCount));
+        free(high);
+        return true;
+    }
+
+    // a * b = z2 * B^(2 * half) + z1 * B^half + z0, z1 = (a0 + a1)(b0 + b1) - z0 - z2
+    size_t aSumCount = aCount - half + 1;
+    size_t bSumCount = half + 1;
+    if (bCount - half + 1 > bSumCount) {
+        bSumCount = bCount - half + 1;
+    }
+    size_t middleCount = aSumCount + bSumCount;
+    uint32_t* scratch = calloc(aSumCount + bSumCount + middleCount, sizeof(uint32_t));
+    if (scratch == NULL) {
+        return false;
+    }
+    uint32_t* aSum = scratch;
+    uint32_t* bSum = aSum + aSumCount;
+    uint32_t* middle = bSum + bSumCount;
+
+    memcpy(aSum, a + half, (aCount - half) * sizeof(uint32_t));
+    big_add_to(aSum, aSumCount, a, half);
+    memcpy(bSum, b, half * sizeof(uint32_t));
+    big_add_to(bSum, bSumCount, b + half, bCount - half);
+
+    if (!big_multiply(a, half, b, half, out) ||
+        !big_multiply(a + half, aCount - half, b + half, bCount - half, out + 2 * half) ||
+        !big_multiply(aSum, aSumCount, bSum, bSumCount, middle)) {
+        free(scratch);
+        return false;
+    }
+    big_subtract_from(middle, middleCount, out, 2 * half);
+    big_subtract_from(middle, middleCount, out + 2 * half, outCount - 2 * half);
+    big_add_to(out + half, outCount - half, middle, big_normalize(middle, middleCount));
+    free(scratch);
+    return true;
+}
+
+// limbs /= divisor in place, returns the remainder
+static inline uint32_t big_divide_small(uint32_t* limbs, size_t count, uint32_t divisor) {
+    uint64_t remainder = 0;
+    for (size_t i = count; i > 0; i--) {
+        uint64_t current = (remainder << BIG_LIMB_BITS) | limbs[i - 1];
+        limbs[i - 1] = (uint32_t)(current / divisor);
+        remainder = current % divisor;
+    }
+    return (uint32_t)remainder;
+}
+
+// Schoolbook long division (Knuth, algorithm D): quotient = u / v, remainder = u % v.
+// v must be normalized with vCount >= 2 and uCount >= vCount. quotient needs uCount - vCount + 1
+// limbs, remainder (may be NULL) needs vCount limbs. Returns false if there was no memory.
+static inline bool big_divide_long(const uint32_t* u, size_t uCount, const uint32_t* v, size_t vCount,
+                                   uint32_t* quotient, uint32_t* remainder) {
+    const uint64_t base = (uint64_t)1 << BIG_LIMB_BITS;
+    int shift = bit_clz32(v[vCount - 1]);
+    uint32_t* scratch = malloc((uCount + 1 + vCount) * sizeof(uint32_t));
+    if (scratch == NULL) {
+        return false;
+    }
+    uint32_t* un = scratch;
+    uint32_t* vn = scratch + uCount + 1;
+
+    // Shift both numbers so the top limb of the divisor has its highest bit set
+    for (size_t i = vCount - 1; i > 0; i--) {
+        vn[i] = (v[i] << shift) | (uint32_t)((uint64_t)v[i - 1] >> (BIG_LIMB_BITS - shift));
+    }
+    vn[0] = v[0] << shift;
+    un[uCount] = (uint32_t)((uint64_t)u[uCount - 1] >> (BIG_LIMB_BITS - shift));
+    for (size_t i = uCount - 1; i > 0; i--) {
+        un[i] = (u[i] << shift) | (uint32_t)((uint64_t)u[i - 1] >> (BIG_LIMB_BITS - shift));
+    }
+    un[0] = u[0] << shift;
+
+    for (size_t j = uCount - vCount + 1; j > 0; j--) {
+        size_t position = j - 1;
+        uint64_t top = ((uint64_t)un[position + vCount] << BIG_LIMB_BITS) | un[position + vCount - 1];
+        uint64_t estimate = top / vn[vCount - 1];
+        uint64_t rest = top % vn[vCount - 1];
+
+        while (estimate >= base ||
+               estimate * vn[vCount - 2] > ((rest << BIG_LIMB_BITS) | un[position + vCount - 2])) {
+            estimate--;
+            rest += vn[vCount - 1];
+            if (rest >= base) {
+                break;
+            }
+        }
+
+        // un[position ..] -= estimate * vn
+        int64_t borrow = 0;
+        int64_t difference;
+        for (size_t i = 0; i < vCount; i++) {
+            uint64_t product = estimate * vn[i];
+            difference = (int64_t)un[i + position] - borrow - (int64_t)(product & 0xFFFFFFFFu);
+            un[i + position] = (uint32_t)difference;
+            borrow = (int64_t)(product >> BIG_LIMB_BITS) - (difference >> BIG_LIMB_BITS);
+        }
+        difference = (int64_t)un[position + vCount] - borrow;
+        un[position + vCount] = (uint32_t)difference;
+
+        quotient[position] = (uint32_t)estimate;
+        if (difference < 0) {
+            // The estimate was one too big, add the divisor back
+            quotient[position]--;
+            uint64_t carry = 0;
+            for (size_t i = 0; i < vCount; i++) {
+                carry += (uint64_t)un[i + position] + vn[i];
+                un[i + position] = (uint32_t)carry;
+                carry >>= BIG_LIMB_BITS;
+            }
+            un[position + vCount] += (uint32_t)carry;
+        }
+    }
+
+    if (remainder != NULL) {
+        for (size_t i = 0; i + 1 < vCount; i++) {
+            remainder[i] = (un[i] >> shift) | (uint32_t)((uint64_t)un[i + 1] << (BIG_LIMB_BITS - shift));
+        }
+        remainder[vCount - 1] = un[vCount - 1] >> shift;
+    }
+    free(scratch);
+    return true;
+}
+
+// reciprocal = floor(B^(2n) / d) for a normalized d of n >= 2 limbs, reciprocal needs n + 2 limbs.
+// One Newton step from the reciprocal of the top k = n / 2 + 3 limbs of d doubles the number of correct
+// limbs, so the recursion costs a few multiplications of n limbs. The starting value
+// x0 = (floor(B^(2k) / top) - B^2) * B^(n - k) is never above B^(2n) / d, Newton steps from below stay
+// below, and the result is at most a few units short; the last loop adds them.
+static inline bool big_reciprocal(const uint32_t* d, size_t n, uint32_t* reciprocal) {
+    size_t xCount = n + 2;
+    memset(reciprocal, 0, xCount * sizeof(uint32_t));
+    if (n < BIG_NEWTON_THRESHOLD) {
+        uint32_t* numerator = calloc(2 * n + 1, sizeof(uint32_t));
+        if (numerator == NULL) {
+            return false;
+        }
+        numerator[2 * n] = 1;
+        bool divided = big_divide_long(numerator, 2 * n + 1, d, n, reciprocal, NULL);
+        free(numerator);
+        return divided;
+    }
+
+    size_t k = (n + 6) / 2;
+    size_t low = n - k;
+    size_t restSize = 2 * n + 1;
+    size_t productSize = xCount + restSize;
+    uint32_t* scratch = calloc(productSize + restSize + xCount, sizeof(uint32_t));
+    if (scratch == NULL || !big_reciprocal(d + low, k, reciprocal + low)) {
+        free(scratch);
+        return false;
+    }
+    uint32_t* product = scratch;
+    uint32_t* rest = scratch + productSize;         // B^(2n) - d * x
+    uint32_t* step = rest + restSize;
+    const uint32_t one = 1;
+    big_subtract_from(reciprocal + low + 2, xCount - low - 2, &one, 1);
+
+    size_t count = big_normalize(reciprocal, xCount);
+    if (!big_multiply(d, n, reciprocal, count, product)) {
+        free(scratch);
+        return false;
+    }
+    rest[2 * n] = 1;
+    big_subtract_from(rest, restSize, product, big_normalize(product, n + count));
+    size_t restCount = big_normalize(rest, restSize);
+
+    // x1 = x0 + step with step = floor(x0 * rest / B^(2n)), and the rest of x1 is rest - d * step
+    if (restCount > 0) {
+        if (!big_multiply(reciprocal, count, rest, restCount, product)) {
+            free(scratch);
+            return false;
+        }
+        size_t stepCount = (count + restCount > 2 * n) ? big_normalize(product + 2 * n, count + restCount - 2 * n) : 0;
+        memcpy(step, product + 2 * n, stepCount * sizeof(uint32_t));
+        big_add_to(reciprocal, xCount, step, stepCount);
+        if (stepCount > 0) {
+            if (!big_multiply(d, n, step, stepCount, product)) {
+                free(scratch);
+                return false;
+            }
+            big_subtract_from(rest, restCount, product, big_normalize(product, n + stepCount));
+            restCount = big_normalize(rest, restCount);
+        }
+    }
+
+    // The rest is below d once x is the floor
+    while (big_compare(rest, restCount, d, n) >= 0) {
+        big_subtract_from(rest, restCount, d, n);
+        restCount = big_normalize(rest, restCount);
+        big_add_to(reciprocal, xCount, &one, 1);
+    }
+    free(scratch);
+    return true;
+}
+
+// Frees everything allocated by big_decimal_powers_extend()
+static inline void big_decimal_powers_free(bigDecimalPowers* powers) {
+    for (int level = 0; level < powers->levels; level++) {
+        free(powers->power[level]);
+        free(powers->reciprocal[level]);
+    }
+    memset(powers, 0, sizeof(*powers));
+}
+
+// Makes sure the table holds every power 10^(9 * 2^k) up to the first one bigger than the number.
+// Each new reciprocal floor(B^(2m) / power) costs a few multiplications (big_reciprocal()), later conversions
+// only multiply. The top power is only compared with, it gets its reciprocal when a bigger power is added.
+static inline bool big_decimal_powers_extend(bigDecimalPowers* powers, const uint32_t* limbs, size_t count) {
+    if (powers->levels == 0) {
+        powers->power[0] = malloc(sizeof(uint32_t));
+        if (powers->power[0] == NULL) {
+            return false;
+        }
+        powers->power[0][0] = BIG_DECIMAL_BASE;
+        powers->powerCount[0] = 1;
+        powers->reciprocal[0] = NULL;       // single-limb powers are divided with big_divide_small()
+        powers->reciprocalCount[0] = 0;
+        powers->levels = 1;
+    }
+
+    while (big_compare(powers->power[powers->levels - 1], powers->powerCount[powers->levels - 1], limbs, count) <= 0) {
+        int level = powers->levels;
+        if (level >= BIG_MAX_POWER_LEVELS) {
+            return false;
+        }
+        size_t previousCount = powers->powerCount[level - 1];
+        size_t squareCount = 2 * previousCount;
+        uint32_t* square = malloc(squareCount * sizeof(uint32_t));
+        if (square == NULL || !big_multiply(powers->power[level - 1], previousCount,
+                                            powers->power[level - 1], previousCount, square)) {
+            free(square);
+            return false;
+        }
+        squareCount = big_normalize(square, squareCount);
+
+        // Barrett reciprocal of the power below the new one: floor(B^(2 * m) / power)
+        const uint32_t* divisor = powers->power[level - 1];
+        size_t reciprocalCount = (previousCount >= 2) ? previousCount + 2 : 0;
+        uint32_t* reciprocal = (reciprocalCount > 0) ? malloc(reciprocalCount * sizeof(uint32_t)) : NULL;
+        if (reciprocalCount > 0 && (reciprocal == NULL || !big_reciprocal(divisor, previousCount, reciprocal))) {
+            free(square);
+            free(reciprocal);
+            return false;
+        }
+
+        powers->reciprocal[level - 1] = reciprocal;
+        powers->reciprocalCount[level - 1] = big_normalize(reciprocal, reciprocalCount);
+        powers->power[level] = square;
+        powers->powerCount[level] = squareCount;
+        powers->reciprocal[level] = NULL;
+        powers->reciprocalCount[level] = 0;
+        powers->levels++;
+    }
+    return true;
+}
+
+// Barrett division of x (below power^2) by power of the given level.
+// quotient needs powerCount + 1 limbs and remainder xCount limbs, their used counts are returned through the pointers.
+static inline bool big_divide_by_power(const bigDecimalPowers* powers, int level, const uint32_t* x, size_t xCount,
+                                       uint32_t* quotient, size_t* quotientCount,
+                                       uint32_t* remainder, size_t* remainderCount) {
+    const uint32_t* power = powers->power[level];
+    size_t m = powers->powerCount[level];
+
+    if (big_compare(x, xCount, power, m) < 0) {
+        *quotientCount = 0;
+        memcpy(remainder, x, xCount * sizeof(uint32_t));
+        *remainderCount = xCount;
+        return true;
+    }
+
+    // quotient estimate = ((x >> (m - 1) limbs) * reciprocal) >> (m + 1) limbs, at most 2 below the real one
+    size_t shiftedCount = xCount - (m - 1);
+    size_t productCount = shiftedCount + powers->reciprocalCount[level];
+    uint32_t* product = malloc((productCount + xCount + 1) * sizeof(uint32_t));
+    if (product == NULL || !big_multiply(x + m - 1, shiftedCount, powers->reciprocal[level],
+                                         powers->reciprocalCount[level], product)) {
+        free(product);
+        return false;
+    }
+    size_t estimateCount = (productCount > m + 1) ? big_normalize(product + m + 1, productCount - m - 1) : 0;
+    memcpy(quotient, product + m + 1, estimateCount * sizeof(uint32_t));
+    memset(quotient + estimateCount, 0, (m + 1 - estimateCount) * sizeof(uint32_t));
+
+    // remainder = x - estimate * power
+    uint32_t* estimateTimesPower = product + productCount;
+    memcpy(remainder, x, xCount * sizeof(uint32_t));
+    if (estimateCount > 0) {
+        if (!big_multiply(quotient, estimateCount, power, m, estimateTimesPower)) {
+            free(product);
+            return false;
+        }
+        big_subtract_from(remainder, xCount, estimateTimesPower,
+                          big_normalize(estimateTimesPower, estimateCount + m));
+    }
+    size_t restCount = big_normalize(remainder, xCount);
+
+    while (big_compare(remainder, restCount, power, m) >= 0) {
+        big_subtract_from(remainder, restCount, power, m);
+        restCount = big_normalize(remainder, restCount);
+        uint32_t one = 1;
+        big_add_to(quotient, m + 1, &one, 1);
+    }
+    free(product);
+    *quotientCount = big_normalize(quotient, m + 1);
+    *remainderCount = restCount;
+    return true;
+}
+
+// Writes x (below 10^digits) as exactly digits characters with leading zeros, by repeated division by 10^9
+static inline void big_write_decimal_leaf(uint32_t* x, size_t xCount, char* out, size_t digits) {
+    char* position = out + digits;
+    while (xCount > 0 && position > out) {
+        uint32_t chunk = big_divide_small(x, xCount, BIG_DECIMAL_BASE);
+        xCount = big_normalize(x, xCount);
+        for (int i = 0; i < BIG_DECIMAL_BASE_DIGITS && position > out; i++) {
+            *--position = (char)('0' + chunk % 10);
+            chunk /= 10;
+        }
+    }
+    memset(out, '0', (size_t)(position - out));
+}
+
+// Writes x (below power[level]^2) as exactly 9 * 2^(level + 1) characters, splitting it by power[level]
+static inline bool big_write_decimal_level(const bigDecimalPowers* powers, int level, const uint32_t* x, size_t xCount,
+                                           char* out) {
+    size_t digits = (size_t)BIG_DECIMAL_BASE_DIGITS << (level + 1);
+
+    if (level <= 0 || xCount <= BIG_DECIMAL_LEAF_LIMBS) {
+        uint32_t* copy = malloc((xCount + 1) * sizeof(uint32_t));
+        if (copy == NULL) {
+            return false;
+        }
+        memcpy(copy, x, xCount * sizeof(uint32_t));
+        big_write_decimal_leaf(copy, xCount, out, digits);
+        free(copy);
+        return true;
+    }
+
+    size_t partLimbs = powers->powerCount[level] + 1;
+    uint32_t* parts = malloc((partLimbs + xCount) * sizeof(uint32_t));
+    if (parts == NULL) {
+        return false;
+    }
+    size_t highCount = 0;
+    size_t lowCount = 0;
+    bool written = big_divide_by_power(powers, level, x, xCount, parts, &highCount, parts + partLimbs, &lowCount) &&
+                   big_write_decimal_level(powers, level - 1, parts, highCount, out) &&
+                   big_write_decimal_level(powers, level - 1, parts + partLimbs, lowCount, out + digits / 2);
+    free(parts);
+    return written;
+}
+
+// Converts a number to a decimal string (caller frees it), powers may be reused between calls.
+// Returns NULL if there was not enough memory.
+static inline char* big_to_decimal_string(const bigNumber* number, bigDecimalPowers* powers) {
+    size_t count = big_normalize(number->limbs, number->count);
+    if (!big_decimal_powers_extend(powers, number->limbs, count)) {
+        return NULL;
+    }
+
+    // The first power above the number is power[levels - 1], so the number is below power[levels - 2]^2
+    int level = powers->levels - 2;
+    size_t digits = (size_t)BIG_DECIMAL_BASE_DIGITS << (level + 1);
+    char* text = malloc(digits + 1);
+    if (text == NULL || !big_write_decimal_level(powers, level, number->limbs, count, text)) {
+        free(text);
+        return NULL;
+    }
+
+    size_t leadingZeros = 0;
+    while (leadingZeros + 1 < digits && text[leadingZeros] == '0') {
+        leadingZeros++;
+    }
+    memmove(text, text + leadingZeros, digits - leadingZeros);
+    text[digits - leadingZeros] = '\0';
+    return text;
+}
+
+// Writes the number in hexadecimal without leading zeros, out needs count * 8 + 1 characters
+static inline size_t big_to_hex(const bigNumber* number, char* out) {
+    size_t count = big_normalize(number->limbs, number->count);
+    size_t length = 0;
+
+    if (count == 0) {
+        out[length++] = '0';
+    }
+    for (size_t i = count; i > 0; i--) {
+        for (int shift = BIG_LIMB_BITS - 4; shift >= 0; shift -= 4) {
+            char digit = hexDigits[(number->limbs[i - 1] >> shift) & 0xF];
+            if (length > 0 || digit != '0') {
+                out[length++] = digit;
+            }
+        }
+    }
+    out[length] = '\0';
+    return length;
+}
+
+// Writes the number in binary without leading zeros, out needs count * 32 + 1 characters
+static inline size_t big_to_binary(const bigNumber* number, char* out) {
+    size_t count = big_normalize(number->limbs, number->count);
+    size_t length = 0;
+
+    if (count == 0) {
+        out[length++] = '0';
+    }
+    for (size_t i = count; i > 0; i--) {
+        for (int bit = BIG_LIMB_BITS - 1; bit >= 0; bit--) {
+            char digit = (char)('0' + ((number->limbs[i - 1] >> bit) & 1));
+            if (length > 0 || digit != '0') {
+                out[length++] = digit;
+            }
+        }
+    }
+    out[length] = '\0';
+    return length;
+}
+
+// Parses a hexadecimal string of any length ("0x" prefix optional) into a new number (free limbs afterwards)
+static inline bool big_from_hex(const char* text, size_t length, bigNumber* number) {
+    if (length >= 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+        text += 2;
+        length -= 2;
+    }
+    if (length == 0) {
+        return false;
+    }
+
+    size_t count = (length + BIG_HEX_DIGITS_IN_LIMB - 1) / BIG_HEX_DIGITS_IN_LIMB;
+    uint32_t* limbs = calloc(count, sizeof(uint32_t));
+    if (limbs == NULL) {
+        return false;
+    }
+    for (size_t i = 0; i < length; i++) {
+        char character = text[length - 1 - i];
+        uint32_t digit;
+        if (character >= '0' && character <= '9') {
+            digit = (uint32_t)(character - '0');
+        }
+        else if (character >= 'a' && character <= 'f') {
+            digit = (uint32_t)(character - 'a' + 10);
+        }
+        else if (character >= 'A' && character <= 'F') {
+            digit = (uint32_t)(character - 'A' + 10);
+        }
+        else {
+            free(limbs);
+            return false;
+        }
+        limbs[i / BIG_HEX_DIGITS_IN_LIMB] |= digit << (4 * (i % BIG_HEX_DIGITS_IN_LIMB));
+    }
+    number->limbs = limbs;
+    number->count = big_normalize(limbs, count);
+    return true;
+}
+
+#if defined(__SIZEOF_INT128__)
+typedef unsigned __int128 uint128_t;
+
+#define UINT128_DECIMAL_DIGITS 39
+#define UINT64_DECIMAL_CHUNK 10000000000000000000ULL    // 10^19, the biggest power of 10 in uint64_t
+
+// Writes a 128-bit number in decimal, out needs 40 characters. Splits it into 19-digit
+// chunks, so only two 128-bit divisions are needed and the rest is 64-bit arithmetic.
+static inline size_t uint128_to_decimal(uint128_t value, char* out) {
+    uint64_t chunks[3];
+    int chunkCount = 0;
+    do {
+        chunks[chunkCount++] = (uint64_t)(value % UINT64_DECIMAL_CHUNK);
+        value /= UINT64_DECIMAL_CHUNK;
+    } while (value != 0);
+
+    size_t length = 0;
+    for (int i = chunkCount - 1; i >= 0; i--) {
+        char digits[20];
+        int digitCount = 0;
+        uint64_t chunk = chunks[i];
+        do {
+            digits[digitCount++] = (char)('0' + chunk % 10);
+            chunk /= 10;
+        } while (chunk != 0);
+        // Lower chunks keep their leading zeros
+        if (i != chunkCount - 1) {
+            while (digitCount < 19) {
+                digits[digitCount++] = '0';
+            }
+        }
+        while (digitCount > 0) {
+            out[length++] = digits[--digitCount];
+        }
+    }
+    out[length] = '\0';
+    return length;
+}
+
+// Views a 128-bit number as a 4-limb bigNumber, so the hex and binary writers can be shared
+static inline bigNumber uint128_as_big(uint128_t value, uint32_t limbs[4]) {
+    for (int i = 0; i < 4; i++) {
+        limbs[i] = (uint32_t)(value >> (BIG_LIMB_BITS * i));
+    }
+    bigNumber number = { limbs, big_normalize(limbs, 4) };
+    return number;
+}
+#endif
+
+#endif // BIG_NUMBER_H
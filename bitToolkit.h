@@ -0,0 +1,298 @@
+#ifndef BIT_TOOLKIT_H
+#define BIT_TOOLKIT_H
+
+// Header-only bit manipulation toolkit.
+// With GCC/Clang the operations map to __builtin_* (POPCNT/LZCNT/TZCNT/BSWAP/ROL when the
+// target has them) and to BMI/BMI2 intrinsics when compiled with -mbmi/-mbmi2. The portable
+// versions use no loops and no data-dependent branches, so they take the same time for every
+// value on MCUs. Define BIT_TOOLKIT_PORTABLE to force the portable versions everywhere.
+//
+// Bit numbering: bit 0 is the least significant bit, a field is [start, start + width).
+
+#include <stdint.h>
+
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(BIT_TOOLKIT_PORTABLE)
+#define BIT_TOOLKIT_BUILTINS 1
+#endif
+
+// Without a POPCNT instruction __builtin_popcount becomes a library call that is slower than the portable code
+#if defined(BIT_TOOLKIT_BUILTINS) && (defined(__POPCNT__) || defined(__aarch64__))
+#define BIT_TOOLKIT_POPCNT 1
+#endif
+
+#if defined(BIT_TOOLKIT_BUILTINS) && (defined(__BMI__) || defined(__BMI2__))
+#include <immintrin.h>
+#endif
+
+// ---------------------------------------------------------------------------
+// Portable versions (constant time)
+// ---------------------------------------------------------------------------
+
+// Number of bits set to 1: add neighbouring bits, then pairs, then nibbles, then all bytes at once
+static inline int bit_popcount32_portable(uint32_t value) {
+    value = value - ((value >> 1) & 0x55555555u);
+    value = (value & 0x33333333u) + ((value >> 2) & 0x33333333u);
+    value = (value + (value >> 4)) & 0x0F0F0F0Fu;
+    return (int)((value * 0x01010101u) >> 24);
+}
+
+static inline int bit_popcount64_portable(uint64_t value) {
+    value = value - ((value >> 1) & 0x5555555555555555ULL);
+    value = (value & 0x3333333333333333ULL) + ((value >> 2) & 0x3333333333333333ULL);
+    value = (value + (value >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int)((value * 0x0101010101010101ULL) >> 56);
+}
+
+// Leading zeros: copy the highest set bit into every lower bit, the zeros left above it are the answer
+static inline int bit_clz32_portable(uint32_t value) {
+    value |= value >> 1;
+    value |= value >> 2;
+    value |= value >> 4;
+    value |= value >> 8;
+    value |= value >> 16;
+    return bit_popcount32_portable(~value);
+}
+
+static inline int bit_clz64_portable(uint64_t value) {
+    value |= value >> 1;
+    value |= value >> 2;
+    value |= value >> 4;
+    value |= value >> 8;
+    value |= value >> 16;
+    value |= value >> 32;
+    return bit_popcount64_portable(~value);
+}
+
+// Trailing zeros: (value & -value) keeps only the lowest set bit, minus 1 sets all bits below it
+static inline int bit_ctz32_portable(uint32_t value) {
+    return bit_popcount32_portable((value & (0u - value)) - 1u);
+}
+
+static inline int bit_ctz64_portable(uint64_t value) {
+    return bit_popcount64_portable((value & (0ULL - value)) - 1ULL);
+}
+
+// Swaps neighbouring bits, then pairs, nibbles, bytes and halves
+static inline uint32_t bit_reverse32_portable(uint32_t value) {
+    value = ((value >> 1) & 0x55555555u) | ((value & 0x55555555u) << 1);
+    value = ((value >> 2) & 0x33333333u) | ((value & 0x33333333u) << 2);
+    value = ((value >> 4) & 0x0F0F0F0Fu) | ((value & 0x0F0F0F0Fu) << 4);
+    value = ((value >> 8) & 0x00FF00FFu) | ((value & 0x00FF00FFu) << 8);
+    return (value >> 16) | (value << 16);
+}
+
+static inline uint64_t bit_reverse64_portable(uint64_t value) {
+    value = ((value >> 1) & 0x5555555555555555ULL) | ((value & 0x5555555555555555ULL) << 1);
+    value = ((value >> 2) & 0x3333333333333333ULL) | ((value & 0x3333333333333333ULL) << 2);
+    value = ((value >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((value & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    value = ((value >> 8) & 0x00FF00FF00FF00FFULL) | ((value & 0x00FF00FF00FF00FFULL) << 8);
+    value = ((value >> 16) & 0x0000FFFF0000FFFFULL) | ((value & 0x0000FFFF0000FFFFULL) << 16);
+    return (value >> 32) | (value << 32);
+}
+
+static inline uint16_t bit_byte_swap16_portable(uint16_t value) {
+    return (uint16_t)((value >> 8) | (value << 8));
+}
+
+static inline uint32_t bit_byte_swap32_portable(uint32_t value) {
+    value = ((value >> 8) & 0x00FF00FFu) | ((value & 0x00FF00FFu) << 8);
+    return (value >> 16) | (value << 16);
+}
+
+static inline uint64_t bit_byte_swap64_portable(uint64_t value) {
+    value = ((value >> 8) & 0x00FF00FF00FF00FFULL) | ((value & 0x00FF00FF00FF00FFULL) << 8);
+    value = ((value >> 16) & 0x0000FFFF0000FFFFULL) | ((value & 0x0000FFFF0000FFFFULL) << 16);
+    return (value >> 32) | (value << 32);
+}
+
+// Mask of the lowest width bits (width 0..32), the 64-bit shift keeps width = 32 defined
+static inline uint32_t bit_mask32_portable(unsigned width) {
+    return (uint32_t)(((uint64_t)1 << width) - 1);
+}
+
+// Mask of the lowest width bits (width 0..64), split into two shifts so width = 64 stays defined
+static inline uint64_t bit_mask64_portable(unsigned width) {
+    return ((((uint64_t)1 << (width / 2)) << (width - width / 2)) - 1);
+}
+
+static inline uint32_t bit_field_extract32_portable(uint32_t value, unsigned start, unsigned width) {
+    return (value >> start) & bit_mask32_portable(width);
+}
+
+static inline uint64_t bit_field_extract64_portable(uint64_t value, unsigned start, unsigned width) {
+    return (value >> start) & bit_mask64_portable(width);
+}
+
+// ---------------------------------------------------------------------------
+// Operations used by the programs: intrinsic when available, portable otherwise
+// ---------------------------------------------------------------------------
+
+static inline int bit_popcount32(uint32_t value) {
+#if defined(BIT_TOOLKIT_POPCNT)
+    return __builtin_popcount(value);
+#else
+    return bit_popcount32_portable(value);
+#endif
+}
+
+static inline int bit_popcount64(uint64_t value) {
+#if defined(BIT_TOOLKIT_POPCNT)
+    return __builtin_popcountll(value);
+#else
+    return bit_popcount64_portable(value);
+#endif
+}
+
+// Leading zeros, bit_clz32(0) = 32 (the builtins are undefined for 0, so it is handled first)
+static inline int bit_clz32(uint32_t value) {
+#if defined(BIT_TOOLKIT_BUILTINS)
+    return value ? __builtin_clz(value) : 32;
+#else
+    return bit_clz32_portable(value);
+#endif
+}
+
+static inline int bit_clz64(uint64_t value) {
+#if defined(BIT_TOOLKIT_BUILTINS)
+    return value ? __builtin_clzll(value) : 64;
+#else
+    return bit_clz64_portable(value);
+#endif
+}
+
+// Trailing zeros, bit_ctz32(0) = 32
+static inline int bit_ctz32(uint32_t value) {
+#if defined(BIT_TOOLKIT_BUILTINS)
+    return value ? __builtin_ctz(value) : 32;
+#else
+    return bit_ctz32_portable(value);
+#endif
+}
+
+static inline int bit_ctz64(uint64_t value) {
+#if defined(BIT_TOOLKIT_BUILTINS)
+    return value ? __builtin_ctzll(value) : 64;
+#else
+    return bit_ctz64_portable(value);
+#endif
+}
+
+// Bit reverse: only Clang has a builtin for it (RBIT on ARM)
+static inline uint32_t bit_reverse32(uint32_t value) {
+#if defined(BIT_TOOLKIT_BUILTINS) && defined(__has_builtin)
+#if __has_builtin(__builtin_bitreverse32)
+    return __builtin_bitreverse32(value);
+#endif
+#endif
+    return bit_reverse32_portable(value);
+}
+
+static inline uint64_t bit_reverse64(uint64_t value) {
+#if defined(BIT_TOOLKIT_BUILTINS) && defined(__has_builtin)
+#if __has_builtin(__builtin_bitreverse64)
+    return __builtin_bitreverse64(value);
+#endif
+#endif
+    return bit_reverse64_portable(value);
+}
+
+static inline uint16_t bit_byte_swap16(uint16_t value) {
+#if defined(BIT_TOOLKIT_BUILTINS)
+    return __builtin_bswap16(value);
+#else
+    return bit_byte_swap16_portable(value);
+#endif
+}
+
+static inline uint32_t bit_byte_swap32(uint32_t value) {
+#if defined(BIT_TOOLKIT_BUILTINS)
+    return __builtin_bswap32(value);
+#else
+    return bit_byte_swap32_portable(value);
+#endif
+}
+
+static inline uint64_t bit_byte_swap64(uint64_t value) {
+#if defined(BIT_TOOLKIT_BUILTINS)
+    return __builtin_bswap64(value);
+#else
+    return bit_byte_swap64_portable(value);
+#endif
+}
+
+// Rotations: written so compilers recognise them as a single ROL/ROR, any count is allowed
+static inline uint32_t bit_rotate_left32(uint32_t value, unsigned count) {
+    count &= 31;
+    return (value << count) | (value >> ((32 - count) & 31));
+}
+
+static inline uint32_t bit_rotate_right32(uint32_t value, unsigned count) {
+    count &= 31;
+    return (value >> count) | (value << ((32 - count) & 31));
+}
+
+static inline uint64_t bit_rotate_left64(uint64_t value, unsigned count) {
+    count &= 63;
+    return (value << count) | (value >> ((64 - count) & 63));
+}
+
+static inline uint64_t bit_rotate_right64(uint64_t value, unsigned count) {
+    count &= 63;
+    return (value >> count) | (value << ((64 - count) & 63));
+}
+
+// Mask of the lowest width bits, BZHI on BMI2
+static inline uint32_t bit_mask32(unsigned width) {
+#if defined(BIT_TOOLKIT_BUILTINS) && defined(__BMI2__)
+    return _bzhi_u32(UINT32_MAX, width);
+#else
+    return bit_mask32_portable(width);
+#endif
+}
+
+static inline uint64_t bit_mask64(unsigned width) {
+#if defined(BIT_TOOLKIT_BUILTINS) && defined(__BMI2__) && defined(__x86_64__)
+    return _bzhi_u64(UINT64_MAX, width);
+#else
+    return bit_mask64_portable(width);
+#endif
+}
+
+// Mask of width bits starting at start
+static inline uint32_t bit_field_mask32(unsigned start, unsigned width) {
+    return bit_mask32(width) << start;
+}
+
+static inline uint64_t bit_field_mask64(unsigned start, unsigned width) {
+    return bit_mask64(width) << start;
+}
+
+// Reads the field [start, start + width), BEXTR on BMI
+static inline uint32_t bit_field_extract32(uint32_t value, unsigned start, unsigned width) {
+#if defined(BIT_TOOLKIT_BUILTINS) && defined(__BMI__)
+    return _bextr_u32(value, start, width);
+#else
+    return bit_field_extract32_portable(value, start, width);
+#endif
+}
+
+static inline uint64_t bit_field_extract64(uint64_t value, unsigned start, unsigned width) {
+#if defined(BIT_TOOLKIT_BUILTINS) && defined(__BMI__) && defined(__x86_64__)
+    return _bextr_u64(value, start, width);
+#else
+    return bit_field_extract64_portable(value, start, width);
+#endif
+}
+
+// Writes field into [start, start + width) and keeps all other bits of value
+static inline uint32_t bit_field_insert32(uint32_t value, uint32_t field, unsigned start, unsigned width) {
+    uint32_t mask = bit_field_mask32(start, width);
+    return (value & ~mask) | ((field << start) & mask);
+}
+
+static inline uint64_t bit_field_insert64(uint64_t value, uint64_t field, unsigned start, unsigned width) {
+    uint64_t mask = bit_field_mask64(start, width);
+    return (value & ~mask) | ((field << start) & mask);
+}
+
+#endif // BIT_TOOLKIT_H
@@ -0,0 +1,205 @@
+/*
+ * Benchmark of bitToolkit.h: for every operation the intrinsic version (what the programs use),
+ * the constant-time portable version (what an MCU build gets) and a naive bit-by-bit loop
+ * like the ones the programs used before are run over the same random values.
+ *
+ * Build:   gcc -O2 bitToolkitBenchmark.c -o bitToolkitBenchmark
+ *          (add -march=native to let the compiler use POPCNT/LZCNT/BMI)
+ * Output:  nanoseconds per value for every variant, the checksum keeps the work from being optimized away.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "bitToolkit.h"
+
+#define BENCH_VALUES 4096
+#define BENCH_ROUNDS 4096
+
+// Naive versions, one bit per loop iteration
+static int naive_popcount32(uint32_t value) {
+    int counter = 0;
+    for (int i = 0; i < 32; i++) {
+        counter += (value >> i) & 0x1;
+    }
+    return counter;
+}
+
+static int naive_popcount64(uint64_t value) {
+    int counter = 0;
+    for (int i = 0; i < 64; i++) {
+        counter += (int)((value >> i) & 0x1);
+    }
+    return counter;
+}
+
+static int naive_clz32(uint32_t value) {
+    int zeros = 0;
+    for (int i = 31; i >= 0 && !((value >> i) & 0x1); i--) {
+        zeros++;
+    }
+    return zeros;
+}
+
+static int naive_ctz32(uint32_t value) {
+    int zeros = 0;
+    for (int i = 0; i < 32 && !((value >> i) & 0x1); i++) {
+        zeros++;
+    }
+    return zeros;
+}
+
+static uint32_t naive_reverse32(uint32_t value) {
+    uint32_t result = 0;
+    for (int i = 0; i < 32; i++) {
+        result = (result << 1) | ((value >> i) & 0x1);
+    }
+    return result;
+}
+
+static uint64_t naive_reverse64(uint64_t value) {
+    uint64_t result = 0;
+    for (int i = 0; i < 64; i++) {
+        result = (result << 1) | ((value >> i) & 0x1);
+    }
+    return result;
+}
+
+static uint32_t naive_byte_swap32(uint32_t value) {
+    uint32_t result = 0;
+    for (int i = 0; i < 4; i++) {
+        result = (result << 8) | ((value >> (8 * i)) & 0xFF);
+    }
+    return result;
+}
+
+static uint64_t naive_byte_swap64(uint64_t value) {
+    uint64_t result = 0;
+    for (int i = 0; i < 8; i++) {
+        result = (result << 8) | ((value >> (8 * i)) & 0xFF);
+    }
+    return result;
+}
+
+static uint32_t naive_rotate_left32(uint32_t value, unsigned count) {
+    for (unsigned i = 0; i < (count & 31); i++) {
+        value = (value << 1) | (value >> 31);
+    }
+    return value;
+}
+
+static uint32_t naive_mask32(unsigned width) {
+    uint32_t mask = 0;
+    for (unsigned i = 0; i < width; i++) {
+        mask |= (uint32_t)1 << i;
+    }
+    return mask;
+}
+
+static uint32_t naive_field_extract32(uint32_t value, unsigned start, unsigned width) {
+    uint32_t field = 0;
+    for (unsigned i = 0; i < width; i++) {
+        field |= ((value >> (start + i)) & 0x1) << i;
+    }
+    return field;
+}
+
+static uint32_t naive_field_insert32(uint32_t value, uint32_t field, unsigned start, unsigned width) {
+    for (unsigned i = 0; i < width; i++) {
+        value &= ~((uint32_t)1 << (start + i));
+        value |= ((field >> i) & 0x1) << (start + i);
+    }
+    return value;
+}
+
+static uint32_t values32[BENCH_VALUES];
+static uint64_t values64[BENCH_VALUES];
+static unsigned counts[BENCH_VALUES];
+
+static double now_seconds(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double)time.tv_sec + (double)time.tv_nsec * 1e-9;
+}
+
+static void report(const char* operation, const char* variant, double start, uint64_t checksum) {
+    double seconds = now_seconds() - start;
+    printf("%-18s %-10s %8.3f ns/value   (checksum %016llx)\n", operation, variant,
+        seconds * 1e9 / ((double)BENCH_VALUES * BENCH_ROUNDS), (unsigned long long)checksum);
+}
+
+// Runs expression for every value; value, wide and count are the current inputs
+#define BENCHMARK(operation, variant, expression)                           \
+    do {                                                                    \
+        uint64_t checksum = 0;                                              \
+        double start = now_seconds();                                       \
+        for (int round = 0; round < BENCH_ROUNDS; round++) {                \
+            for (size_t i = 0; i < BENCH_VALUES; i++) {                     \
+                uint32_t value = values32[i] ^ (uint32_t)round;             \
+                uint64_t wide = values64[i] ^ (uint64_t)round;              \
+                unsigned count = counts[i];                                 \
+                (void)value; (void)wide; (void)count;                       \
+                checksum += (uint64_t)(expression);                         \
+            }                                                               \
+        }                                                                   \
+        report(operation, variant, start, checksum);                        \
+    } while (0)
+
+int main(void) {
+    srand(2137);
+    for (size_t i = 0; i < BENCH_VALUES; i++) {
+        values32[i] = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+        values64[i] = ((uint64_t)values32[i] << 32) ^ (((uint64_t)rand() << 16) ^ (uint64_t)rand());
+        counts[i] = (unsigned)rand() % 25;
+    }
+
+    BENCHMARK("popcount32", "intrinsic", bit_popcount32(value));
+    BENCHMARK("popcount32", "portable", bit_popcount32_portable(value));
+    BENCHMARK("popcount32", "naive", naive_popcount32(value));
+
+    BENCHMARK("popcount64", "intrinsic", bit_popcount64(wide));
+    BENCHMARK("popcount64", "portable", bit_popcount64_portable(wide));
+    BENCHMARK("popcount64", "naive", naive_popcount64(wide));
+
+    BENCHMARK("clz32", "intrinsic", bit_clz32(value >> count));
+    BENCHMARK("clz32", "portable", bit_clz32_portable(value >> count));
+    BENCHMARK("clz32", "naive", naive_clz32(value >> count));
+
+    BENCHMARK("ctz32", "intrinsic", bit_ctz32(value << count));
+    BENCHMARK("ctz32", "portable", bit_ctz32_portable(value << count));
+    BENCHMARK("ctz32", "naive", naive_ctz32(value << count));
+
+    BENCHMARK("reverse32", "intrinsic", bit_reverse32(value));
+    BENCHMARK("reverse32", "portable", bit_reverse32_portable(value));
+    BENCHMARK("reverse32", "naive", naive_reverse32(value));
+
+    BENCHMARK("reverse64", "intrinsic", bit_reverse64(wide));
+    BENCHMARK("reverse64", "portable", bit_reverse64_portable(wide));
+    BENCHMARK("reverse64", "naive", naive_reverse64(wide));
+
+    BENCHMARK("byte_swap32", "intrinsic", bit_byte_swap32(value));
+    BENCHMARK("byte_swap32", "portable", bit_byte_swap32_portable(value));
+    BENCHMARK("byte_swap32", "naive", naive_byte_swap32(value));
+
+    BENCHMARK("byte_swap64", "intrinsic", bit_byte_swap64(wide));
+    BENCHMARK("byte_swap64", "portable", bit_byte_swap64_portable(wide));
+    BENCHMARK("byte_swap64", "naive", naive_byte_swap64(wide));
+
+    BENCHMARK("rotate_left32", "intrinsic", bit_rotate_left32(value, count));
+    BENCHMARK("rotate_left32", "naive", naive_rotate_left32(value, count));
+
+    BENCHMARK("mask32", "intrinsic", bit_mask32(count));
+    BENCHMARK("mask32", "portable", bit_mask32_portable(count));
+    BENCHMARK("mask32", "naive", naive_mask32(count));
+
+    BENCHMARK("field_extract32", "intrinsic", bit_field_extract32(value, count, 7));
+    BENCHMARK("field_extract32", "portable", bit_field_extract32_portable(value, count, 7));
+    BENCHMARK("field_extract32", "naive", naive_field_extract32(value, count, 7));
+
+    BENCHMARK("field_insert32", "intrinsic", bit_field_insert32(value, count, 8, 7));
+    BENCHMARK("field_insert32", "naive", naive_field_insert32(value, count, 8, 7));
+
+    return 0;
+}
@@ -0,0 +1,496 @@
+#ifndef BULK_CONVERTER_H
+#define BULK_CONVERTER_H
+
+// Converts big files of numbers (one per line) between decimal, hexadecimal and binary
+// using all CPU cores. The memory-mapped input is cut into chunks at line boundaries,
+// worker threads convert the chunks into a ring of preallocated output buffers and the
+// calling thread writes the buffers out in the original order. Needs POSIX (mmap, pthreads).
+// Built with -DBULK_USE_ZLIB (and -lz) gzip-compressed input is read directly: a reader thread inflates
+// it into a ring of input buffers, cut at line boundaries, and publishes every buffer as a chunk, so
+// the workers convert while the next chunks are still being decompressed.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "numberParsing.h"
+#include "numberFormatting.h"
+
+#if defined(BULK_USE_ZLIB)
+#include <zlib.h>
+#endif
+
+#define BULK_CHUNK_SIZE (1024 * 1024)           // input bytes converted by one worker at a time
+#define BULK_SLOTS_PER_THREAD 2                 // output buffers in flight per worker
+#define BULK_OUTPUT_GROWTH 4                    // a number never gets more than 4x longer (decimal/hex -> binary)
+#define BULK_MAX_THREADS 256
+#define BULK_FREE_SLOT SIZE_MAX
+#define BULK_EXTRA_INPUT_BUFFERS 2              // gzip input buffers beyond the output slots, so the reader stays ahead
+#define BULK_GZIP_BUFFER_SIZE (1024 * 1024)     // zlib's own input buffer
+
+typedef enum {
+    NUMBER_BASE_DECIMAL,
+    NUMBER_BASE_HEX,
+    NUMBER_BASE_BINARY
+} numberBase;
+
+// One output buffer of the ring
+typedef struct {
+    char* buffer;
+    size_t used;
+    size_t chunk;       // chunk stored in the buffer, BULK_FREE_SLOT if the writer already took it
+    bool ready;         // the worker has finished converting the chunk
+} bulkSlot;
+
+// Decompressed input of one chunk
+typedef struct {
+    char* text;
+    size_t length;
+} bulkInputBuffer;
+
+// State shared by the reader, the workers and the writer
+typedef struct {
+    const char* input;
+    size_t* chunkStart;         // chunkCount + 1 offsets into the input, all at line starts
+    bulkInputBuffer* inputRing; // instead of input: chunk n is in inputRing[n % inputRingSize]
+    size_t inputRingSize;
+    size_t chunkCount;          // chunks available so far
+    bool isInputDone;           // no more chunks will come
+    bool hasInputError;
+    size_t writtenChunks;
+    bulkSlot* slots;
+    size_t slotCount;
+    size_t nextChunk;           // next chunk a worker will take
+    numberBase from;
+    numberBase to;
+    size_t invalidLines;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} bulkJob;
+
+// Text of a chunk, a slice of the mapped file or a buffer of the ring
+static inline const char* bulk_chunk_text(const bulkJob* job, size_t chunk, size_t* length) {
+    if (job->inputRing != NULL) {
+        const bulkInputBuffer* buffer = &job->inputRing[chunk % job->inputRingSize];
+        *length = buffer->length;
+        return buffer->text;
+    }
+    *length = job->chunkStart[chunk + 1] - job->chunkStart[chunk];
+    return job->input + job->chunkStart[chunk];
+}
+
+// Parses one number in the given base
+static inline bool bulk_parse(const char* text, size_t length, numberBase base, uint64_t* value) {
+    switch (base) {
+    case NUMBER_BASE_DECIMAL:
+        return parse_decimal_string(text, length, UINT64_MAX, value) == PARSE_OK;
+    case NUMBER_BASE_HEX:
+        return parse_hex_string(text, length, value);
+    default:
+        return parse_binary_string(text, length, value);
+    }
+}
+
+// Formats one number in the given base
+static inline size_t bulk_format(uint64_t value, numberBase base, char* out) {
+    switch (base) {
+    case NUMBER_BASE_DECIMAL:
+        return format_decimal_u64(value, out);
+    case NUMBER_BASE_HEX:
+        return format_hex_u64(value, out);
+    default:
+        return format_binary_u64(value, out);
+    }
+}
+
+// Converts every line of a chunk. Lines that are not numbers become empty lines,
+// so line N of the output always belongs to line N of the input.
+static inline size_t bulk_convert_chunk(const char* text, size_t length, numberBase from, numberBase to,
+                                        char* out, size_t* invalidLines) {
+    const char* end = text + length;
+    char* position = out;
+    size_t invalid = 0;
+
+    while (text < end) {
+        size_t lineLength = 0;
+        const char* nextLine = split_line(text, end, &lineLength);
+        uint64_t value;
+
+        if (lineLength > 0) {
+            if (bulk_parse(text, lineLength, from, &value)) {
+                position += bulk_format(value, to, position);
+            }
+            else {
+                invalid++;
+            }
+        }
+        *position++ = '\n';
+        text = nextLine;
+    }
+    *invalidLines = invalid;
+    return (size_t)(position - out);
+}
+
+// Worker thread: takes the next chunk, waits until its ring slot has been written out, converts it
+static void* bulk_worker(void* argument) {
+    bulkJob* job = argument;
+
+    pthread_mutex_lock(&job->lock);
+    while (true) {
+        while (job->nextChunk >= job->chunkCount && !job->isInputDone) {
+            pthread_cond_wait(&job->changed, &job->lock);
+        }
+        if (job->nextChunk >= job->chunkCount) {
+            break;
+        }
+        size_t chunk = job->nextChunk++;
+        bulkSlot* slot = &job->slots[chunk % job->slotCount];
+        while (slot->chunk != BULK_FREE_SLOT) {
+            pthread_cond_wait(&job->changed, &job->lock);
+        }
+        slot->chunk = chunk;
+        slot->ready = false;
+        pthread_mutex_unlock(&job->lock);
+
+        size_t invalid = 0;
+        size_t length;
+        const char* text = bulk_chunk_text(job, chunk, &length);
+        slot->used = bulk_convert_chunk(text, length, job->from, job->to, slot->buffer, &invalid);
+
+        pthread_mutex_lock(&job->lock);
+        slot->ready = true;
+        job->invalidLines += invalid;
+        pthread_cond_broadcast(&job->changed);
+    }
+    pthread_mutex_unlock(&job->lock);
+    return NULL;
+}
+
+// Cuts the input into chunks of about BULK_CHUNK_SIZE bytes, each ending right after a newline
+static inline size_t* bulk_split_chunks(const char* input, size_t length, size_t* chunkCount) {
+    size_t maxChunks = length / BULK_CHUNK_SIZE + 2;
+    size_t* starts = malloc((maxChunks + 1) * sizeof(size_t));
+    if (starts == NULL) {
+        return NULL;
+    }
+
+    size_t count = 0;
+    size_t position = 0;
+    starts[0] = 0;
+    while (position < length) {
+        size_t end = position + BULK_CHUNK_SIZE;
+        if (end >= length) {
+            end = length;
+        }
+        else {
+            const char* newLine = memchr(input + end, '\n', length - end);
+            end = newLine ? (size_t)(newLine - input) + 1 : length;
+        }
+        starts[++count] = end;
+        position = end;
+    }
+    *chunkCount = count;
+    return starts;
+}
+
+#if defined(BULK_USE_ZLIB)
+typedef struct {
+    bulkJob* job;
+    gzFile file;
+    size_t bufferSize;
+} bulkGzipReader;
+
+// Reader thread: inflates the input into the ring. A buffer ends after its last newline, the cut line
+// moves to the next buffer. A buffer is reused once the writer has written the chunk it held.
+static void* bulk_gzip_reader(void* argument) {
+    bulkGzipReader* reader = argument;
+    bulkJob* job = reader->job;
+    size_t carried = 0;
+    bool isEnd = false;
+
+    for (size_t chunk = 0; !isEnd; chunk++) {
+        bulkInputBuffer* buffer = &job->inputRing[chunk % job->inputRingSize];
+        bulkInputBuffer* previous = &job->inputRing[(chunk + job->inputRingSize - 1) % job->inputRingSize];
+
+        pthread_mutex_lock(&job->lock);
+        while (chunk >= job->writtenChunks + job->inputRingSize && !job->hasInputError) {
+            pthread_cond_wait(&job->changed, &job->lock);
+        }
+        bool isStopped = job->hasInputError;
+        pthread_mutex_unlock(&job->lock);
+        if (isStopped) {
+            break;
+        }
+
+        if (carried > 0) {
+            memcpy(buffer->text, previous->text + previous->length, carried);
+        }
+        size_t length = carried;
+        while (length < reader->bufferSize) {
+            int count = gzread(reader->file, buffer->text + length, (unsigned)(reader->bufferSize - length));
+            if (count <= 0) {
+                // A file cut short ends without an error from gzread(), only gzerror() tells
+                int error = Z_OK;
+                gzerror(reader->file, &error);
+                isEnd = true;
+                if (count < 0 || error != Z_OK) {
+                    pthread_mutex_lock(&job->lock);
+                    job->hasInputError = true;
+                    pthread_mutex_unlock(&job->lock);
+                }
+                break;
+            }
+            length += (size_t)count;
+        }
+
+        // Keep whole lines, unless a single line fills the whole buffer
+        buffer->length = length;
+        carried = 0;
+        if (!isEnd) {
+            const char* text = buffer->text;
+            size_t lineEnd = length;
+            while (lineEnd > 0 && text[lineEnd - 1] != '\n') {
+                lineEnd--;
+            }
+            if (lineEnd > 0) {
+                buffer->length = lineEnd;
+                carried = length - lineEnd;
+            }
+        }
+
+        pthread_mutex_lock(&job->lock);
+        if (buffer->length > 0) {
+            job->chunkCount++;
+        }
+        job->isInputDone = isEnd || job->hasInputError;
+        pthread_cond_broadcast(&job->changed);
+        pthread_mutex_unlock(&job->lock);
+    }
+
+    pthread_mutex_lock(&job->lock);
+    job->isInputDone = true;
+    pthread_cond_broadcast(&job->changed);
+    pthread_mutex_unlock(&job->lock);
+    return NULL;
+}
+#endif
+
+// Runs the workers on the chunks of job and writes the results in order. The chunks come from the
+// mapped input, or from the gzip reader thread when gzipInput is set.
+static inline int bulk_run(bulkJob* job, FILE* output, const char* outputPath, long threads, void* gzipInput) {
+    if (threads <= 0) {
+        threads = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (threads <= 0) {
+        threads = 1;
+    }
+    if (threads > BULK_MAX_THREADS) {
+        threads = BULK_MAX_THREADS;
+    }
+
+    job->slotCount = (size_t)threads * BULK_SLOTS_PER_THREAD;
+    job->slots = calloc(job->slotCount, sizeof(bulkSlot));
+    pthread_mutex_init(&job->lock, NULL);
+    pthread_cond_init(&job->changed, NULL);
+
+    // Worst case: every line gets 4x longer, plus one full binary number for a short last line
+    size_t slotCapacity = BULK_OUTPUT_GROWTH * (BULK_CHUNK_SIZE + MAX_BINARY_TEXT_64) + MAX_BINARY_TEXT_64 + 1;
+    bool ready = (job->slots != NULL && (job->chunkStart != NULL || gzipInput != NULL));
+    for (size_t i = 0; ready && i < job->slotCount; i++) {
+        job->slots[i].chunk = BULK_FREE_SLOT;
+        job->slots[i].buffer = malloc(slotCapacity);
+        ready = (job->slots[i].buffer != NULL);
+    }
+
+#if defined(BULK_USE_ZLIB)
+    // The ring holds a chunk and the start of the line cut off after it
+    bulkGzipReader reader = { job, gzipInput, BULK_CHUNK_SIZE };
+    pthread_t readerThread;
+    bool hasReader = false;
+    if (gzipInput != NULL) {
+        job->inputRingSize = job->slotCount + BULK_EXTRA_INPUT_BUFFERS;
+        job->inputRing = calloc(job->inputRingSize, sizeof(bulkInputBuffer));
+        ready = ready && job->inputRing != NULL;
+        for (size_t i = 0; ready && i < job->inputRingSize; i++) {
+            job->inputRing[i].text = malloc(BULK_CHUNK_SIZE);
+            ready = (job->inputRing[i].text != NULL);
+        }
+        hasReader = ready && pthread_create(&readerThread, NULL, bulk_gzip_reader, &reader) == 0;
+        ready = hasReader;
+    }
+#endif
+
+    pthread_t workers[BULK_MAX_THREADS];
+    long started = 0;
+    for (; ready && started < threads; started++) {
+        if (pthread_create(&workers[started], NULL, bulk_worker, job) != 0) {
+            break;
+        }
+    }
+
+    int result = 0;
+    if (!ready || started == 0) {
+        fprintf(stderr, "Not enough resources to start the conversion\n");
+        result = 1;
+    }
+    else {
+        // Write the chunks in input order as soon as each one is ready
+        for (size_t chunk = 0; ; chunk++) {
+            bulkSlot* slot = &job->slots[chunk % job->slotCount];
+            pthread_mutex_lock(&job->lock);
+            while ((slot->chunk != chunk || !slot->ready) && !(job->isInputDone && chunk >= job->chunkCount)) {
+                pthread_cond_wait(&job->changed, &job->lock);
+            }
+            bool isDone = (slot->chunk != chunk || !slot->ready);
+            pthread_mutex_unlock(&job->lock);
+            if (isDone) {
+                break;
+            }
+
+            if (fwrite(slot->buffer, 1, slot->used, output) != slot->used) {
+                result = 1;
+            }
+
+            pthread_mutex_lock(&job->lock);
+            slot->chunk = BULK_FREE_SLOT;
+            job->writtenChunks = chunk + 1;
+            pthread_cond_broadcast(&job->changed);
+            pthread_mutex_unlock(&job->lock);
+        }
+    }
+    // Workers wait for chunks until the input is done, so a failed start has to end the input for them
+    pthread_mutex_lock(&job->lock);
+    if (result != 0 || !ready) {
+        job->hasInputError = true;
+        job->isInputDone = true;
+        job->nextChunk = job->chunkCount;
+    }
+    pthread_cond_broadcast(&job->changed);
+    pthread_mutex_unlock(&job->lock);
+    for (long i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    bool isInputDamaged = false;
+#if defined(BULK_USE_ZLIB)
+    if (hasReader) {
+        pthread_join(readerThread, NULL);
+        isInputDamaged = (job->hasInputError && result == 0);
+    }
+    for (size_t i = 0; job->inputRing != NULL && i < job->inputRingSize; i++) {
+        free(job->inputRing[i].text);
+    }
+    free(job->inputRing);
+#endif
+
+    if (job->invalidLines > 0) {
+        fprintf(stderr, "%zu lines were not valid numbers and were left empty\n", job->invalidLines);
+    }
+    if (fflush(output) != 0 || result != 0) {
+        perror(outputPath);
+        result = 1;
+    }
+    if (isInputDamaged) {
+        fprintf(stderr, "The compressed input is damaged or cut short\n");
+        result = 1;
+    }
+
+    for (size_t i = 0; job->slots != NULL && i < job->slotCount; i++) {
+        free(job->slots[i].buffer);
+    }
+    free(job->slots);
+    pthread_cond_destroy(&job->changed);
+    pthread_mutex_destroy(&job->lock);
+    return result;
+}
+
+// True when the file starts with the gzip magic bytes
+static inline bool bulk_is_gzip(const char* input, size_t length) {
+    return length >= 2 && (uint8_t)input[0] == 0x1F && (uint8_t)input[1] == 0x8B;
+}
+
+// Converts the input file into the output file ("-" for stdout). threads = 0 uses all online CPUs.
+// Returns 0 on success, prints the reason and returns 1 otherwise.
+static inline int bulk_convert_file(const char* inputPath, const char* outputPath, numberBase from, numberBase to,
+                                    long threads) {
+    int inputFile = open(inputPath, O_RDONLY);
+    struct stat inputInfo;
+    if (inputFile < 0 || fstat(inputFile, &inputInfo) != 0) {
+        perror(inputPath);
+        if (inputFile >= 0) {
+            close(inputFile);
+        }
+        return 1;
+    }
+    FILE* output = (strcmp(outputPath, "-") == 0) ? stdout : fopen(outputPath, "wb");
+    if (output == NULL) {
+        perror(outputPath);
+        close(inputFile);
+        return 1;
+    }
+
+    size_t length = (size_t)inputInfo.st_size;
+    const char* input = NULL;
+    if (length > 0) {
+        input = mmap(NULL, length, PROT_READ, MAP_PRIVATE, inputFile, 0);
+        if (input == MAP_FAILED) {
+            perror(inputPath);
+            close(inputFile);
+            if (output != stdout) {
+                fclose(output);
+            }
+            return 1;
+        }
+        madvise((void*)input, length, MADV_SEQUENTIAL);
+    }
+
+    bulkJob job = { 0 };
+    job.from = from;
+    job.to = to;
+    int result;
+    if (bulk_is_gzip(input, length)) {
+#if defined(BULK_USE_ZLIB)
+        // zlib reads the file itself (all members of a concatenated .gz one after another)
+        munmap((void*)input, length);
+        input = NULL;
+        gzFile gzipInput = gzdopen(dup(inputFile), "rb");
+        if (gzipInput == NULL) {
+            perror(inputPath);
+            result = 1;
+        }
+        else {
+            gzbuffer(gzipInput, BULK_GZIP_BUFFER_SIZE);
+            result = bulk_run(&job, output, outputPath, threads, gzipInput);
+            gzclose(gzipInput);
+        }
+#else
+        fprintf(stderr, "%s is gzip-compressed, build with -DBULK_USE_ZLIB -lz to read it\n", inputPath);
+        result = 1;
+#endif
+    }
+    else {
+        job.input = input;
+        job.chunkStart = bulk_split_chunks(input, length, &job.chunkCount);
+        job.isInputDone = true;
+        result = bulk_run(&job, output, outputPath, threads, NULL);
+        free(job.chunkStart);
+    }
+
+    if (input != NULL) {
+        munmap((void*)input, length);
+    }
+    close(inputFile);
+    if (output != stdout) {
+        fclose(output);
+    }
+    return result;
+}
+
+#endif // BULK_CONVERTER_H
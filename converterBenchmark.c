@@ -0,0 +1,337 @@
+/*
+ * Benchmark of the converter's output paths. The original per-bit printf print_in_binary and the
+ * %x / %llu printing are compared with the table (LUT), SWAR and SIMD writers of numberFormatting.h
+ * for 8, 16, 32 and 64-bit values. Doubles (64-bit patterns only) compare printf("%.17g") with the
+ * shortest round-trip writer of floatFormatting.h. Octal and base 36 compare a naive % / loop with a
+ * base read at run time against the per-base writers of baseConversion.h.
+ *
+ * Distributions:  random  - uniform over the whole width
+ *                 small   - 0..9, the shortest text
+ *                 max     - all bits set, the longest text
+ *                 pow10   - 10^k - 1 and 10^k, where digit counting code changes its mind
+ * Modes:          single  - every value is formatted and written to the output on its own
+ *                 bulk    - all values are packed into one buffer that is written at once
+ * The output goes to /dev/null, every value is followed by a newline.
+ *
+ * Build:   gcc -O2 converterBenchmark.c -o converterBenchmark
+ * Output:  ns/value and output GB/s for every base, method, width, distribution and mode.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+
+#include "numberFormatting.h"
+#include "floatFormatting.h"
+#include "baseConversion.h"
+
+#define BENCH_VALUES 65536
+#define BENCH_MIN_SECONDS 0.05
+#define BENCH_MAX_TEXT 65                       // 64 binary digits + newline
+
+typedef enum {
+    DISTRIBUTION_RANDOM,
+    DISTRIBUTION_SMALL,
+    DISTRIBUTION_MAX,
+    DISTRIBUTION_POW10,
+    DISTRIBUTION_COUNT
+} valueDistribution;
+
+static const char* distributionNames[DISTRIBUTION_COUNT] = { "random", "small", "max", "pow10" };
+
+// A way of printing numbers: into a buffer (returns the length) and optionally straight into a stream
+typedef struct {
+    const char* base;
+    const char* name;
+    size_t (*toBuffer)(uint64_t value, int bits, char* out);
+    void (*toStream)(uint64_t value, int bits, FILE* stream);      // NULL: toBuffer + fwrite
+} converterMethod;
+
+// The converter's original print_in_binary: one printf per bit
+static void binary_printf_per_bit_stream(uint64_t value, int bits, FILE* stream) {
+    for (int i = 0; i < bits; i++) {
+        fprintf(stream, "%d", (int)((value >> (bits - 1 - i)) & 0x1));
+    }
+    fputc('\n', stream);
+}
+
+static size_t binary_printf_per_bit_buffer(uint64_t value, int bits, char* out) {
+    for (int i = 0; i < bits; i++) {
+        sprintf(out + i, "%d", (int)((value >> (bits - 1 - i)) & 0x1));
+    }
+    return (size_t)bits;
+}
+
+static void hex_printf_stream(uint64_t value, int bits, FILE* stream) {
+    fprintf(stream, "%0*" PRIx64 "\n", bits / 4, value);
+}
+
+static size_t hex_printf_buffer(uint64_t value, int bits, char* out) {
+    return (size_t)sprintf(out, "%0*" PRIx64, bits / 4, value);
+}
+
+static void decimal_printf_stream(uint64_t value, int bits, FILE* stream) {
+    (void)bits;
+    fprintf(stream, "%" PRIu64 "\n", value);
+}
+
+static size_t decimal_printf_buffer(uint64_t value, int bits, char* out) {
+    (void)bits;
+    return (size_t)sprintf(out, "%" PRIu64, value);
+}
+
+// Textbook decimal conversion: one division by 10 per digit
+static size_t decimal_divide_by_10(uint64_t value, int bits, char* out) {
+    char digits[MAX_DECIMAL_TEXT_64];
+    size_t count = 0;
+    (void)bits;
+    do {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    for (size_t i = 0; i < count; i++) {
+        out[i] = digits[count - 1 - i];
+    }
+    return count;
+}
+
+static size_t decimal_digit_pairs(uint64_t value, int bits, char* out) {
+    (void)bits;
+    return format_decimal_u64(value, out);
+}
+
+// Naive base-N conversion: the base is only known at run time, so every digit costs two divisions
+static volatile unsigned naiveBase;
+
+static size_t base_naive(uint64_t value, char* out) {
+    unsigned base = naiveBase;
+    char digits[MAX_BASE_TEXT_64];
+    size_t count = 0;
+    do {
+        digits[count++] = baseDigits[value % base];
+        value /= base;
+    } while (value != 0);
+    for (size_t i = 0; i < count; i++) {
+        out[i] = digits[count - 1 - i];
+    }
+    return count;
+}
+
+static size_t octal_naive(uint64_t value, int bits, char* out) {
+    (void)bits;
+    naiveBase = 8;
+    return base_naive(value, out);
+}
+
+static size_t octal_shifts(uint64_t value, int bits, char* out) {
+    (void)bits;
+    return format_base8_u64(value, out);
+}
+
+static size_t base36_naive(uint64_t value, int bits, char* out) {
+    (void)bits;
+    naiveBase = 36;
+    return base_naive(value, out);
+}
+
+static size_t base36_reciprocal(uint64_t value, int bits, char* out) {
+    (void)bits;
+    return format_base36_u64(value, out);
+}
+
+static size_t decimal_reciprocal(uint64_t value, int bits, char* out) {
+    (void)bits;
+    return format_base10_u64(value, out);
+}
+
+// Doubles take the value as the bit pattern
+static double double_of_bits(uint64_t value) {
+    double number;
+    memcpy(&number, &value, sizeof(number));
+    return number;
+}
+
+static void double_printf_stream(uint64_t value, int bits, FILE* stream) {
+    (void)bits;
+    fprintf(stream, "%.17g\n", double_of_bits(value));
+}
+
+static size_t double_printf_buffer(uint64_t value, int bits, char* out) {
+    (void)bits;
+    return (size_t)sprintf(out, "%.17g", double_of_bits(value));
+}
+
+static size_t double_shortest(uint64_t value, int bits, char* out) {
+    (void)bits;
+    return format_double_shortest(double_of_bits(value), out);
+}
+
+#if defined(FORMAT_HAS_SSSE3_PATH)
+// Wrapper so the SSSE3 method is only listed when the CPU has it
+static size_t hex_ssse3(uint64_t value, int bits, char* out) {
+    return format_hex_fixed_ssse3(value, bits, out);
+}
+#endif
+
+static const converterMethod methods[] = {
+    { "binary", "printf/bit", binary_printf_per_bit_buffer, binary_printf_per_bit_stream },
+    { "binary", "LUT", format_binary_fixed_lut, NULL },
+    { "binary", "SWAR", format_binary_fixed, NULL },
+#if defined(__SSE2__)
+    { "binary", "SSE2", format_binary_fixed_sse2, NULL },
+#endif
+    { "hex", "printf", hex_printf_buffer, hex_printf_stream },
+    { "hex", "LUT", format_hex_fixed, NULL },
+    { "hex", "SWAR", format_hex_fixed_swar, NULL },
+#if defined(FORMAT_HAS_SSSE3_PATH)
+    { "hex", "SSSE3", hex_ssse3, NULL },
+#endif
+    { "decimal", "printf", decimal_printf_buffer, decimal_printf_stream },
+    { "decimal", "div10", decimal_divide_by_10, NULL },
+    { "decimal", "LUT", decimal_digit_pairs, NULL },
+    { "decimal", "chunked", decimal_reciprocal, NULL },
+    { "octal", "naive", octal_naive, NULL },
+    { "octal", "shifts", octal_shifts, NULL },
+    { "base36", "naive", base36_naive, NULL },
+    { "base36", "chunked", base36_reciprocal, NULL },
+    { "double", "printf", double_printf_buffer, double_printf_stream },
+    { "double", "Ryu", double_shortest, NULL },
+};
+
+static uint64_t values[BENCH_VALUES];
+
+static double now_seconds(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double)time.tv_sec + (double)time.tv_nsec * 1e-9;
+}
+
+static uint64_t random_u64(void) {
+    return ((uint64_t)rand() << 42) ^ ((uint64_t)rand() << 21) ^ (uint64_t)rand();
+}
+
+// Fills the value array for one width and distribution
+static void fill_values(int bits, valueDistribution distribution) {
+    uint64_t mask = bit_mask64((unsigned)bits);
+    uint64_t powers[MAX_DECIMAL_TEXT_64];
+    int powerCount = 0;
+
+    // Powers of 10 that fit into the width
+    for (uint64_t power = 10; powerCount < MAX_DECIMAL_TEXT_64 && power - 1 <= mask; power *= 10) {
+        powers[powerCount++] = power;
+        if (power > UINT64_MAX / 10) {
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < BENCH_VALUES; i++) {
+        switch (distribution) {
+        case DISTRIBUTION_RANDOM:
+            values[i] = random_u64() & mask;
+            break;
+        case DISTRIBUTION_SMALL:
+            values[i] = (uint64_t)(rand() % 10);
+            break;
+        case DISTRIBUTION_MAX:
+            values[i] = mask;
+            break;
+        default: {
+            uint64_t power = powers[rand() % powerCount];
+            values[i] = (rand() & 1) && power <= mask ? power : power - 1;
+            break;
+        }
+        }
+    }
+}
+
+// Runs one method over all values until enough time has passed, returns seconds per pass
+static double run_method(const converterMethod* method, int bits, bool bulk, char* buffer, FILE* sink,
+                         size_t* bytesPerPass) {
+    size_t passes = 0;
+    double elapsed;
+
+    // The amount of text is the same for every pass, count it once outside of the timing
+    char* position = buffer;
+    for (size_t i = 0; i < BENCH_VALUES; i++) {
+        position += method->toBuffer(values[i], bits, position) + 1;
+    }
+    *bytesPerPass = (size_t)(position - buffer);
+
+    double start = now_seconds();
+    do {
+        if (bulk) {
+            position = buffer;
+            for (size_t i = 0; i < BENCH_VALUES; i++) {
+                position += method->toBuffer(values[i], bits, position);
+                *position++ = '\n';
+            }
+            fwrite(buffer, 1, (size_t)(position - buffer), sink);
+        }
+        else {
+            char text[BENCH_MAX_TEXT + 1];
+            for (size_t i = 0; i < BENCH_VALUES; i++) {
+                if (method->toStream != NULL) {
+                    method->toStream(values[i], bits, sink);
+                }
+                else {
+                    size_t length = method->toBuffer(values[i], bits, text);
+                    text[length++] = '\n';
+                    fwrite(text, 1, length, sink);
+                }
+            }
+        }
+        passes++;
+        elapsed = now_seconds() - start;
+    } while (elapsed < BENCH_MIN_SECONDS);
+
+    return elapsed / (double)passes;
+}
+
+int main(void) {
+    static const int widths[] = { 8, 16, 32, 64 };
+    FILE* sink = fopen("/dev/null", "wb");
+    char* buffer = malloc((size_t)BENCH_VALUES * BENCH_MAX_TEXT);
+    if (sink == NULL || buffer == NULL) {
+        fprintf(stderr, "Cannot prepare the benchmark\n");
+        return 1;
+    }
+    setvbuf(sink, NULL, _IOFBF, 1 << 16);
+    srand(2137);
+
+    printf("%-8s %-11s %5s %-7s %-6s %12s %10s\n", "base", "method", "bits", "values", "mode", "ns/value", "GB/s");
+    for (size_t m = 0; m < sizeof(methods) / sizeof(methods[0]); m++) {
+#if defined(FORMAT_HAS_SSSE3_PATH)
+        if (methods[m].toBuffer == hex_ssse3 && !__builtin_cpu_supports("ssse3")) {
+            continue;
+        }
+#endif
+        for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); w++) {
+            // Narrower patterns would only be denormal doubles
+            if (strcmp(methods[m].base, "double") == 0 && widths[w] != 64) {
+                continue;
+            }
+            for (int distribution = 0; distribution < DISTRIBUTION_COUNT; distribution++) {
+                fill_values(widths[w], (valueDistribution)distribution);
+                for (int bulk = 0; bulk <= 1; bulk++) {
+                    // Single values are only measured on random data, the rest is about the data
+                    if (!bulk && distribution != DISTRIBUTION_RANDOM) {
+                        continue;
+                    }
+                    size_t bytes = 0;
+                    double seconds = run_method(&methods[m], widths[w], bulk, buffer, sink, &bytes);
+                    printf("%-8s %-11s %5d %-7s %-6s %12.2f %10.3f\n", methods[m].base, methods[m].name,
+                           widths[w], distributionNames[distribution], bulk ? "bulk" : "single",
+                           seconds * 1e9 / BENCH_VALUES, (double)bytes / seconds / 1e9);
+                }
+            }
+        }
+    }
+
+    free(buffer);
+    fclose(sink);
+    return 0;
+}
@@ -1,8 +1,22 @@
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "bitToolkit.h"
+#include "numberParsing.h"
+#include "numberFormatting.h"
+#include "bigNumber.h"
+#include "floatFormatting.h"
+#include "fixedPoint.h"
+#include "baseConversion.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include "bulkConverter.h"
+#include "memoryDump.h"
+#endif
 
 // Constants for bit operations
-#define LAST_BIT 0x1
 #define BITS_IN_BYTE 8
 
 // Define a custom number type for uniform formatting, 
@@ -10,10 +24,59 @@
 // Using signed types may lead to unexpected binary representations.
 typedef uint16_t selectedNumberFormat;
 
-// Function prototype
+// Size of a single read when loading input data
+#define READ_CHUNK_SIZE 65536
+// Number of words that can be selected for the binary view of --dump
+#define MAX_DUMP_WORDS 64
+
+// Function prototypes
 void print_in_binary(selectedNumberFormat number);
+char* read_whole_stream(FILE* stream, size_t* length);
+int convert_binary_input(FILE* stream);
+int convert_decimal_input(FILE* stream);
+int convert_wide_hex_input(FILE* stream);
+int convert_float_input(FILE* stream);
+int convert_fixed_input(FILE* stream, const char* formatName, bool rawInput);
+int convert_base_input(FILE* stream, unsigned from, unsigned to);
+void print_float_views(double number);
+int run_bulk_conversion(int argc, char* argv[]);
+int run_memory_dump(int argc, char* argv[]);
+
+int main(int argc, char* argv[]) {
+    // "--bin": read binary numbers (one per line) from stdin and print them in decimal and hexadecimal
+    if (argc > 1 && strcmp(argv[1], "--bin") == 0) {
+        return convert_binary_input(stdin);
+    }
+    // "--dec": read decimal numbers (one per line) that must fit into selectedNumberFormat
+    // and print them in hexadecimal and binary
+    if (argc > 1 && strcmp(argv[1], "--dec") == 0) {
+        return convert_decimal_input(stdin);
+    }
+    // "--wide": read hexadecimal numbers of any width (register dumps, keys) and print them in decimal and binary
+    if (argc > 1 && strcmp(argv[1], "--wide") == 0) {
+        return convert_wide_hex_input(stdin);
+    }
+    // "--float": read decimal floating point numbers and print their shortest text and IEEE-754 bits
+    if (argc > 1 && strcmp(argv[1], "--float") == 0) {
+        return convert_float_input(stdin);
+    }
+    // "--fixed <Qm.n> [raw]": read fixed-point values (or raw words in hexadecimal) and print them exactly
+    if (argc > 2 && strcmp(argv[1], "--fixed") == 0) {
+        return convert_fixed_input(stdin, argv[2], argc > 3 && strcmp(argv[3], "raw") == 0);
+    }
+    // "--base <from> <to>": read numbers in any base from 2 to 36 and print them in another one
+    if (argc > 3 && strcmp(argv[1], "--base") == 0) {
+        return convert_base_input(stdin, (unsigned)strtoul(argv[2], NULL, 10), (unsigned)strtoul(argv[3], NULL, 10));
+    }
+    // "--bulk <from> <to> <input> <output> [threads]": convert a whole file on all cores
+    if (argc > 1 && strcmp(argv[1], "--bulk") == 0) {
+        return run_bulk_conversion(argc, argv);
+    }
+    // "--dump <file> [offset...]": xxd-style dump, words at the offsets are also shown in binary and decimal
+    if (argc > 1 && strcmp(argv[1], "--dump") == 0) {
+        return run_memory_dump(argc, argv);
+    }
 
-int main(void) {
     // Define decimal, hexadecimal, and binary number representations
     selectedNumberFormat decimalNumber = 2137;
     selectedNumberFormat hexNumber = 0x1660;
@@ -45,17 +108,448 @@ int main(void) {
     printf("Other formats in hexadecimal:\n");
     printf("decimalNumber = 0x%x\n", decimalNumber);
     printf("binNumber     = 0x%x\n", binNumber);
-    //putchar('\n');
+    putchar('\n');
+
+    // Parse a binary string back into a number
+    const char binaryText[] = "0b10111";
+    uint64_t parsedNumber = 0;
+    printf("Binary string parsed back to a number:\n");
+    if (parse_binary_string(binaryText, strlen(binaryText), &parsedNumber)) {
+        printf("%s = %" PRIu64 " = 0x%" PRIx64 "\n", binaryText, parsedNumber, parsedNumber);
+    }
+
+#if defined(__SIZEOF_INT128__)
+    // Numbers wider than 64 bits
+    uint128_t wideNumber = ((uint128_t)0x0123456789abcdefULL << 64) | 0xfedcba9876543210ULL;
+    uint32_t wideLimbs[4];
+    bigNumber wideView = uint128_as_big(wideNumber, wideLimbs);
+    char wideText[sizeof(uint128_t) * BITS_IN_BYTE + 1];
+    putchar('\n');
+    printf("128-bit number:\n");
+    uint128_to_decimal(wideNumber, wideText);
+    printf("decimal = %s\n", wideText);
+    big_to_hex(&wideView, wideText);
+    printf("hex     = 0x%s\n", wideText);
+    big_to_binary(&wideView, wideText);
+    printf("binary  = 0b%s\n", wideText);
+#endif
+
+    // Floating point numbers: shortest decimal text and sign | exponent | mantissa bits
+    putchar('\n');
+    printf("Floating point numbers:\n");
+    print_float_views(0.1);
+    print_float_views(-21.37);
 
     return 0;
 }
 
-// Prints an 8, 16, or 32-bit number in binary format, depending on the chosen type
+// Prints an 8, 16, 32 or 64-bit number in binary format, depending on the chosen type
 void print_in_binary(selectedNumberFormat number) {
-    int totalBits = sizeof(number) * BITS_IN_BYTE;
-    for (int i = 0; i < totalBits; i++) {
-        // Shift the number to isolate each bit and print it
-        printf("%d", (number >> (totalBits - 1 - i)) & LAST_BIT);
+    char text[sizeof(number) * BITS_IN_BYTE + 1];
+    // Every byte of the number becomes 8 characters at once instead of one printf per bit
+    size_t length = format_binary_fixed(number, (int)(sizeof(number) * BITS_IN_BYTE), text);
+    text[length] = '\n';
+    fwrite(text, 1, length + 1, stdout);
+}
+
+// Reads everything from the stream into one heap buffer, the caller frees it
+char* read_whole_stream(FILE* stream, size_t* length) {
+    size_t capacity = READ_CHUNK_SIZE;
+    size_t used = 0;
+    char* buffer = malloc(capacity);
+
+    while (buffer != NULL) {
+        if (capacity - used < READ_CHUNK_SIZE) {
+            char* bigger = realloc(buffer, capacity * 2);
+            if (bigger == NULL) {
+                free(buffer);
+                return NULL;
+            }
+            buffer = bigger;
+            capacity *= 2;
+        }
+        size_t readBytes = fread(buffer + used, 1, READ_CHUNK_SIZE, stream);
+        used += readBytes;
+        if (readBytes < READ_CHUNK_SIZE) {
+            break;
+        }
     }
-    putchar('\n');
+    *length = used;
+    return buffer;
+}
+
+// Converts binary lines ("0b1011" or "1011", up to 64 digits) from the stream to decimal and hexadecimal
+int convert_binary_input(FILE* stream) {
+    size_t length = 0;
+    char* text = read_whole_stream(stream, &length);
+    if (text == NULL) {
+        fprintf(stderr, "Not enough memory for the input data\n");
+        return 1;
+    }
+
+    // Every value needs at least one digit and a newline, so this is the upper bound
+    size_t maxValues = length / 2 + 1;
+    uint64_t* values = malloc(maxValues * sizeof(uint64_t));
+    if (values == NULL) {
+        fprintf(stderr, "Not enough memory for the input data\n");
+        free(text);
+        return 1;
+    }
+
+    size_t invalidLines = 0;
+    size_t count = parse_binary_lines(text, length, values, maxValues, &invalidLines);
+    for (size_t i = 0; i < count; i++) {
+        printf("%" PRIu64 " = 0x%" PRIx64 "\n", values[i], values[i]);
+    }
+    if (invalidLines > 0) {
+        fprintf(stderr, "Skipped %zu lines that are not binary numbers\n", invalidLines);
+    }
+
+    free(values);
+    free(text);
+    return 0;
+}
+
+// Converts decimal lines from the stream to hexadecimal and binary, values wider than selectedNumberFormat are rejected
+int convert_decimal_input(FILE* stream) {
+    size_t length = 0;
+    char* text = read_whole_stream(stream, &length);
+    if (text == NULL) {
+        fprintf(stderr, "Not enough memory for the input data\n");
+        return 1;
+    }
+
+    size_t maxValues = length / 2 + 1;
+    uint64_t* values = malloc(maxValues * sizeof(uint64_t));
+    if (values == NULL) {
+        fprintf(stderr, "Not enough memory for the input data\n");
+        free(text);
+        return 1;
+    }
+
+    size_t invalidLines = 0;
+    size_t overflowLines = 0;
+    size_t count = parse_decimal_lines(text, length, (selectedNumberFormat)-1, values, maxValues,
+                                       &invalidLines, &overflowLines);
+    for (size_t i = 0; i < count; i++) {
+        printf("%" PRIu64 " = 0x%" PRIx64 " = 0b", values[i], values[i]);
+        print_in_binary((selectedNumberFormat)values[i]);
+    }
+    if (invalidLines > 0) {
+        fprintf(stderr, "Skipped %zu lines that are not decimal numbers\n", invalidLines);
+    }
+    if (overflowLines > 0) {
+        fprintf(stderr, "Skipped %zu numbers that do not fit into %zu bits\n", overflowLines,
+                sizeof(selectedNumberFormat) * BITS_IN_BYTE);
+    }
+
+    free(values);
+    free(text);
+    return 0;
+}
+
+// Converts hexadecimal lines of any length from the stream to decimal
+int convert_wide_hex_input(FILE* stream) {
+    size_t length = 0;
+    char* text = read_whole_stream(stream, &length);
+    if (text == NULL) {
+        fprintf(stderr, "Not enough memory for the input data\n");
+        return 1;
+    }
+
+    // The table of powers of 10 grows with the widest number and is reused for all lines
+    bigDecimalPowers powers = { 0 };
+    size_t invalidLines = 0;
+    const char* line = text;
+    const char* end = text + length;
+    int result = 0;
+
+    while (line < end) {
+        size_t lineLength = 0;
+        const char* nextLine = split_line(line, end, &lineLength);
+        bigNumber number;
+
+        if (lineLength > 0) {
+            if (big_from_hex(line, lineLength, &number)) {
+                char* decimal = big_to_decimal_string(&number, &powers);
+                free(number.limbs);
+                if (decimal == NULL) {
+                    fprintf(stderr, "Not enough memory for the decimal conversion\n");
+                    result = 1;
+                    break;
+                }
+                printf("%s\n", decimal);
+                free(decimal);
+            }
+            else {
+                invalidLines++;
+            }
+        }
+        line = nextLine;
+    }
+    if (invalidLines > 0) {
+        fprintf(stderr, "Skipped %zu lines that are not hexadecimal numbers\n", invalidLines);
+    }
+
+    big_decimal_powers_free(&powers);
+    free(text);
+    return result;
+}
+
+// Prints the shortest text and the bits of a number as double and as float
+void print_float_views(double number) {
+    char text[MAX_FLOAT_TEXT + 1];
+    char bits[MAX_FLOAT_BITS_TEXT + 1];
+    float single = (float)number;
+
+    text[format_double_shortest(number, text)] = '\0';
+    bits[format_double_bits(number, bits)] = '\0';
+    printf("double %-24s = 0b %s\n", text, bits);
+    text[format_float_shortest(single, text)] = '\0';
+    bits[format_float_bits(single, bits)] = '\0';
+    printf("float  %-24s = 0b %s\n", text, bits);
+}
+
+// Converts floating point lines ("0.1", "-1e-7", "inf") from the stream to their double and float views
+int convert_float_input(FILE* stream) {
+    size_t length = 0;
+    char* text = read_whole_stream(stream, &length);
+    if (text == NULL) {
+        fprintf(stderr, "Not enough memory for the input data\n");
+        return 1;
+    }
+
+    size_t invalidLines = 0;
+    const char* line = text;
+    const char* end = text + length;
+    char lineText[MAX_FLOAT_TEXT * 4];
+
+    while (line < end) {
+        size_t lineLength = 0;
+        const char* nextLine = split_line(line, end, &lineLength);
+
+        if (lineLength > 0) {
+            // strtod needs a terminated string, longer lines cannot be numbers we care about
+            char* parsedEnd = lineText;
+            if (lineLength < sizeof(lineText)) {
+                memcpy(lineText, line, lineLength);
+                lineText[lineLength] = '\0';
+                double number = strtod(lineText, &parsedEnd);
+                if (parsedEnd != lineText && *parsedEnd == '\0') {
+                    print_float_views(number);
+                }
+            }
+            if (parsedEnd == lineText || *parsedEnd != '\0') {
+                invalidLines++;
+            }
+        }
+        line = nextLine;
+    }
+    if (invalidLines > 0) {
+        fprintf(stderr, "Skipped %zu lines that are not floating point numbers\n", invalidLines);
+    }
+
+    free(text);
+    return 0;
+}
+
+// Converts fixed-point lines from the stream. Values ("-1.25", "0x1.8", "0b1.01") are printed in decimal,
+// hexadecimal and binary with their raw bits; with rawInput the lines are raw words in hexadecimal
+// (e.g. a telemetry dump) and only their decimal values are written, all at once.
+int convert_fixed_input(FILE* stream, const char* formatName, bool rawInput) {
+    qFormat format;
+    if (!parse_q_format(formatName, &format)) {
+        fprintf(stderr, "Unknown fixed-point format %s (expected e.g. Q15, Q16.16, UQ8.8)\n", formatName);
+        return 1;
+    }
+
+    size_t length = 0;
+    char* text = read_whole_stream(stream, &length);
+    if (text == NULL) {
+        fprintf(stderr, "Not enough memory for the input data\n");
+        return 1;
+    }
+    size_t maxValues = length / 2 + 1;
+    uint64_t* raws = malloc(maxValues * sizeof(uint64_t));
+    if (raws == NULL) {
+        fprintf(stderr, "Not enough memory for the input data\n");
+        free(text);
+        return 1;
+    }
+
+    size_t count = 0;
+    size_t invalidLines = 0;
+    size_t overflowLines = 0;
+    int result = 0;
+    if (rawInput) {
+        const char* line = text;
+        const char* end = text + length;
+        while (line < end) {
+            size_t lineLength = 0;
+            const char* nextLine = split_line(line, end, &lineLength);
+            if (lineLength > 0) {
+                if (!parse_hex_string(line, lineLength, &raws[count])) {
+                    invalidLines++;
+                }
+                else if (raws[count] > bit_mask64(format.totalBits)) {
+                    overflowLines++;
+                }
+                else {
+                    count++;
+                }
+            }
+            line = nextLine;
+        }
+
+        char* output = malloc(count * (MAX_FIXED_TEXT + 1) + 1);
+        if (output == NULL) {
+            fprintf(stderr, "Not enough memory for the output data\n");
+            result = 1;
+        }
+        else {
+            fwrite(output, 1, format_fixed_lines(raws, count, format, FIXED_TEXT_DECIMAL, output), stdout);
+            free(output);
+        }
+    }
+    else {
+        count = parse_fixed_lines(text, length, format, raws, maxValues, &invalidLines, &overflowLines);
+        char decimal[MAX_FIXED_TEXT + 1];
+        char hex[MAX_FIXED_TEXT + 1];
+        char binary[MAX_FIXED_TEXT + 1];
+        for (size_t i = 0; i < count; i++) {
+            decimal[format_fixed_decimal(raws[i], format, decimal)] = '\0';
+            hex[format_fixed_hex(raws[i], format, hex)] = '\0';
+            binary[format_fixed_binary(raws[i], format, binary)] = '\0';
+            printf("%s = %s = %s (raw 0x%0*" PRIx64 ")\n", decimal, hex, binary, (format.totalBits + 3) / 4, raws[i]);
+        }
+    }
+    if (invalidLines > 0) {
+        fprintf(stderr, "Skipped %zu lines that are not %s numbers\n", invalidLines, rawInput ? "hexadecimal" : "fixed-point");
+    }
+    if (overflowLines > 0) {
+        fprintf(stderr, "Skipped %zu numbers that do not fit into %s\n", overflowLines, formatName);
+    }
+
+    free(raws);
+    free(text);
+    return result;
+}
+
+// Converts lines in base from (2..36) to base to, e.g. octal permissions or base-36 IDs
+int convert_base_input(FILE* stream, unsigned from, unsigned to) {
+    if (from < MIN_NUMBER_BASE || from > MAX_NUMBER_BASE || to < MIN_NUMBER_BASE || to > MAX_NUMBER_BASE) {
+        fprintf(stderr, "Bases must be between %d and %d\n", MIN_NUMBER_BASE, MAX_NUMBER_BASE);
+        return 1;
+    }
+
+    size_t length = 0;
+    char* text = read_whole_stream(stream, &length);
+    if (text == NULL) {
+        fprintf(stderr, "Not enough memory for the input data\n");
+        return 1;
+    }
+    // Every line holds at least one digit, its text in the new base needs at most 64 digits and a newline
+    char* output = malloc((length / 2 + 1) * (MAX_BASE_TEXT_64 + 1));
+    if (output == NULL) {
+        fprintf(stderr, "Not enough memory for the output data\n");
+        free(text);
+        return 1;
+    }
+
+    size_t invalidLines = 0;
+    size_t overflowLines = 0;
+    char* position = output;
+    const char* line = text;
+    const char* end = text + length;
+    while (line < end) {
+        size_t lineLength = 0;
+        const char* nextLine = split_line(line, end, &lineLength);
+        uint64_t value;
+
+        if (lineLength > 0) {
+            numberParseStatus status = parse_base_string(line, lineLength, from, &value);
+            if (status == PARSE_OK) {
+                position += format_base_u64(value, to, position);
+                *position++ = '\n';
+            }
+            else if (status == PARSE_OVERFLOW) {
+                overflowLines++;
+            }
+            else {
+                invalidLines++;
+            }
+        }
+        line = nextLine;
+    }
+    fwrite(output, 1, (size_t)(position - output), stdout);
+    if (invalidLines > 0) {
+        fprintf(stderr, "Skipped %zu lines that are not base %u numbers\n", invalidLines, from);
+    }
+    if (overflowLines > 0) {
+        fprintf(stderr, "Skipped %zu numbers that do not fit into 64 bits\n", overflowLines);
+    }
+
+    free(output);
+    free(text);
+    return 0;
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+// Reads "dec", "hex" or "bin" into a numberBase, returns false for anything else
+static bool parse_base_name(const char* name, numberBase* base) {
+    if (strcmp(name, "dec") == 0) {
+        *base = NUMBER_BASE_DECIMAL;
+    }
+    else if (strcmp(name, "hex") == 0) {
+        *base = NUMBER_BASE_HEX;
+    }
+    else if (strcmp(name, "bin") == 0) {
+        *base = NUMBER_BASE_BINARY;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+// Handles "--bulk <from> <to> <input> <output> [threads]", bases are dec, hex or bin
+int run_bulk_conversion(int argc, char* argv[]) {
+    numberBase from;
+    numberBase to;
+
+    if (argc < 6 || !parse_base_name(argv[2], &from) || !parse_base_name(argv[3], &to)) {
+        fprintf(stderr, "Usage: %s --bulk <dec|hex|bin> <dec|hex|bin> <input> <output|-> [threads]\n", argv[0]);
+        return 1;
+    }
+    long threads = (argc > 6) ? strtol(argv[6], NULL, 10) : 0;
+    return bulk_convert_file(argv[4], argv[5], from, to, threads);
+}
+
+// Handles "--dump <file> [offset...]", the selected words are selectedNumberFormat wide
+int run_memory_dump(int argc, char* argv[]) {
+    uint64_t wordOffsets[MAX_DUMP_WORDS];
+    size_t wordCount = 0;
+
+    if (argc < 3 || argc - 3 > MAX_DUMP_WORDS) {
+        fprintf(stderr, "Usage: %s --dump <file> [offset...] (at most %d offsets)\n", argv[0], MAX_DUMP_WORDS);
+        return 1;
+    }
+    for (int i = 3; i < argc; i++) {
+        wordOffsets[wordCount++] = strtoull(argv[i], NULL, 0);
+    }
+    return dump_file(argv[2], stdout, wordOffsets, wordCount, (int)(sizeof(selectedNumberFormat) * BITS_IN_BYTE));
+}
+#else
+// Bulk conversion and dumps need mmap and pthreads
+int run_bulk_conversion(int argc, char* argv[]) {
+    (void)argc;
+    fprintf(stderr, "%s: --bulk is only available on POSIX systems\n", argv[0]);
+    return 1;
+}
+
+int run_memory_dump(int argc, char* argv[]) {
+    (void)argc;
+    fprintf(stderr, "%s: --dump is only available on POSIX systems\n", argv[0]);
+    return 1;
 }
+#endif
@@ -0,0 +1,173 @@
+#ifndef DOWNSAMPLER_H
+#define DOWNSAMPLER_H
+
+// Streaming Largest-Triangle-Three-Buckets (LTTB) downsampling of a time series.
+// The series is cut into buckets of bucketSize samples and one sample per bucket is kept: the one that
+// forms the largest triangle with the sample kept from the previous bucket and the average of the
+// next bucket, so peaks and edges survive while flat stretches collapse. The first and the last
+// sample of the series are always kept.
+// Only two buckets are held at a time (the one being decided and the next one whose average is
+// needed), so a series of any length needs bounded memory. All arithmetic is integer.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+typedef struct {
+    int64_t x;
+    int32_t y;
+} lttbPoint;
+
+typedef struct {
+    uint32_t bucketSize;
+    bool hasAnchor;
+    lttbPoint anchor;               // last kept sample
+    lttbPoint last;                 // newest sample, kept when the series ends
+    bool lastIsKept;
+    lttbPoint* current;             // bucket waiting for the next bucket's average
+    uint32_t currentCount;
+    lttbPoint* next;
+    uint32_t nextCount;
+    int64_t nextSumX;               // relative to anchor.x, so the sums stay small
+    int64_t nextSumY;
+} lttbSeries;
+
+// Points kept per bucket and at the ends of a series, for sizing output buffers
+#define LTTB_MAX_POINTS_PER_ADD 1
+#define LTTB_MAX_POINTS_PER_FLUSH 3
+
+static inline bool lttb_init(lttbSeries* series, uint32_t bucketSize) {
+    series->bucketSize = (bucketSize < 1) ? 1 : bucketSize;
+    series->hasAnchor = false;
+    series->lastIsKept = false;
+    series->currentCount = 0;
+    series->nextCount = 0;
+    series->nextSumX = 0;
+    series->nextSumY = 0;
+    series->current = malloc(series->bucketSize * sizeof(lttbPoint));
+    series->next = malloc(series->bucketSize * sizeof(lttbPoint));
+    if (series->current == NULL || series->next == NULL) {
+        free(series->current);
+        free(series->next);
+        return false;
+    }
+    return true;
+}
+
+static inline void lttb_free(lttbSeries* series) {
+    free(series->current);
+    free(series->next);
+    series->current = NULL;
+    series->next = NULL;
+}
+
+// Picks the sample of the current bucket with the largest triangle (anchor, sample, average of the
+// next bucket). The average is kept as sums over count samples (sumX relative to the anchor), so the
+// cross product gives the doubled area scaled by count, which picks the same sample.
+static inline lttbPoint lttb_select(const lttbSeries* series, int64_t count, int64_t sumX, int64_t sumY) {
+    const lttbPoint* candidates = series->current;
+    lttbPoint anchor = series->anchor;
+    int64_t averageDx = sumX;
+    int64_t averageDy = sumY - count * anchor.y;
+    size_t best = 0;
+    uint64_t bestArea = 0;
+
+    for (uint32_t i = 0; i < series->currentCount; i++) {
+        int64_t dx = candidates[i].x - anchor.x;
+        int64_t dy = (int64_t)candidates[i].y - anchor.y;
+        int64_t cross = dx * averageDy - averageDx * dy;
+        uint64_t area = (cross < 0) ? (uint64_t)-cross : (uint64_t)cross;
+        if (area > bestArea || i == 0) {
+            bestArea = area;
+            best = i;
+        }
+    }
+    return candidates[best];
+}
+
+// Adds a sample (x must grow). Returns true and fills kept when a sample was chosen.
+static inline bool lttb_add(lttbSeries* series, int64_t x, int32_t y, lttbPoint* kept) {
+    lttbPoint point = { x, y };
+    series->last = point;
+    series->lastIsKept = false;
+
+    // The first sample of a series is always kept
+    if (!series->hasAnchor) {
+        series->anchor = point;
+        series->hasAnchor = true;
+        series->lastIsKept = true;
+        *kept = point;
+        return true;
+    }
+    if (series->currentCount < series->bucketSize) {
+        series->current[series->currentCount++] = point;
+        return false;
+    }
+
+    series->next[series->nextCount++] = point;
+    series->nextSumX += x - series->anchor.x;
+    series->nextSumY += y;
+    if (series->nextCount < series->bucketSize) {
+        return false;
+    }
+
+    // Both buckets are full: decide the current one, the next one takes its place
+    *kept = lttb_select(series, series->nextCount, series->nextSumX, series->nextSumY);
+    series->anchor = *kept;
+    lttbPoint* swap = series->current;
+    series->current = series->next;
+    series->currentCount = series->nextCount;
+    series->next = swap;
+    series->nextCount = 0;
+    series->nextSumX = 0;
+    series->nextSumY = 0;
+    return true;
+}
+
+// Ends the series: decides the pending bucket and the partial one after it, then keeps the last sample.
+// Writes up to LTTB_MAX_POINTS_PER_FLUSH points, returns how many.
+static inline size_t lttb_flush(lttbSeries* series, lttbPoint* kept) {
+    size_t count = 0;
+    if (!series->hasAnchor || series->lastIsKept) {
+        return 0;
+    }
+
+    // The last sample is kept on its own, so it must not be chosen from a bucket as well
+    if (series->nextCount > 0) {
+        series->nextCount--;
+        series->nextSumX -= series->last.x - series->anchor.x;
+        series->nextSumY -= series->last.y;
+    }
+    else {
+        series->currentCount--;
+    }
+    if (series->currentCount > 0) {
+        if (series->nextCount > 0) {
+            kept[count] = lttb_select(series, series->nextCount, series->nextSumX, series->nextSumY);
+        }
+        else {
+            kept[count] = lttb_select(series, 1, series->last.x - series->anchor.x, series->last.y);
+        }
+        series->anchor = kept[count++];
+    }
+    if (series->nextCount > 0) {
+        lttbPoint* swap = series->current;
+        series->current = series->next;
+        series->currentCount = series->nextCount;
+        series->next = swap;
+        kept[count++] = lttb_select(series, 1, series->last.x - series->anchor.x, series->last.y);
+    }
+    kept[count++] = series->last;
+
+    // The series can go on, its next sample starts from the last one
+    series->anchor = series->last;
+    series->lastIsKept = true;
+    series->currentCount = 0;
+    series->nextCount = 0;
+    series->nextSumX = 0;
+    series->nextSumY = 0;
+    return count;
+}
+
+#endif // DOWNSAMPLER_H
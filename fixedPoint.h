@@ -0,0 +1,443 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+// Fixed-point (Qm.n) values to and from decimal, hexadecimal and binary text with integer arithmetic only.
+// A value is kept as its raw bit pattern in the low totalBits bits of a uint64_t, exactly as the
+// firmware stores it; the real value is raw / 2^n (two's complement for signed formats).
+//
+// Format names follow the usual embedded convention, the sign bit counts as an integer bit:
+//   Q15    = 16-bit signed, 15 fraction bits       Q16.16 = 32-bit signed, 16 fraction bits
+//   Q1.15  = same as Q15                           UQ8.8  = 16-bit unsigned, 8 fraction bits
+//
+// Every output is exact: n fraction bits never need more than n decimal digits. Parsing rounds to the
+// nearest value (ties to even) and reports values outside of the format as PARSE_OVERFLOW.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "bitToolkit.h"
+#include "numberParsing.h"
+#include "numberFormatting.h"
+
+#define MAX_FIXED_TOTAL_BITS 64
+#define MAX_FIXED_FRACTION_BITS 63
+// Longest text: "-0b" + 64 integer bits + "." + 63 fraction bits
+#define MAX_FIXED_TEXT 132
+// Fraction digits that fit into the fast parser (10^18 < 2^63, so doubling the remainder cannot overflow)
+#define FIXED_FAST_FRACTION_DIGITS 18
+// Longer decimal fractions are parsed digit array by digit array, up to this many digits
+#define MAX_FIXED_FRACTION_DIGITS 128
+
+typedef struct {
+    uint8_t totalBits;          // 1..64, the sign bit included
+    uint8_t fractionBits;       // 0..63
+    bool isSigned;
+} qFormat;
+
+// Text bases of the batch writer
+typedef enum {
+    FIXED_TEXT_DECIMAL,
+    FIXED_TEXT_HEX,
+    FIXED_TEXT_BINARY
+} fixedTextBase;
+
+static const uint64_t fixedPowersOf10[FIXED_FAST_FRACTION_DIGITS + 1] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+    1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+    100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+    1000000000000000000ULL
+};
+
+// Reads "Q15", "Q16.16", "UQ8.8" etc., returns false for names that do not describe a 1 to 64-bit format
+static inline bool parse_q_format(const char* name, qFormat* format) {
+    bool isSigned = true;
+    if (name[0] == 'U' || name[0] == 'u') {
+        isSigned = false;
+        name++;
+    }
+    if (name[0] != 'Q' && name[0] != 'q') {
+        return false;
+    }
+    name++;
+
+    const char* dot = strchr(name, '.');
+    uint64_t first = 0;
+    uint64_t second = 0;
+    size_t firstLength = dot ? (size_t)(dot - name) : strlen(name);
+    if (parse_decimal_string(name, firstLength, MAX_FIXED_TOTAL_BITS, &first) != PARSE_OK) {
+        return false;
+    }
+    if (dot != NULL && parse_decimal_string(dot + 1, strlen(dot + 1), MAX_FIXED_TOTAL_BITS, &second) != PARSE_OK) {
+        return false;
+    }
+
+    // "Qn" has only the sign bit (or nothing for UQn) in front of the point
+    uint64_t integerBits = dot ? first : (isSigned ? 1 : 0);
+    uint64_t fractionBits = dot ? second : first;
+    if ((isSigned && integerBits == 0) || integerBits + fractionBits == 0 ||
+        integerBits + fractionBits > MAX_FIXED_TOTAL_BITS || fractionBits > MAX_FIXED_FRACTION_BITS) {
+        return false;
+    }
+    format->totalBits = (uint8_t)(integerBits + fractionBits);
+    format->fractionBits = (uint8_t)fractionBits;
+    format->isSigned = isSigned;
+    return true;
+}
+
+// Splits the raw bits into a sign and the magnitude (the most negative value fits as well)
+static inline uint64_t fixed_magnitude(uint64_t raw, qFormat format, bool* negative) {
+    uint64_t mask = bit_mask64(format.totalBits);
+    raw &= mask;
+    *negative = format.isSigned && ((raw >> (format.totalBits - 1)) & 0x1);
+    return *negative ? ((0 - raw) & mask) : raw;
+}
+
+// Multiplies the fraction (below 2^fractionBits) by factor and returns the integer part of the product,
+// the fraction keeps the rest. The product may need up to 71 bits, so it is built from 32-bit halves.
+static inline unsigned fixed_next_digits(uint64_t* fraction, unsigned fractionBits, unsigned factor) {
+    uint64_t low = (*fraction & 0xFFFFFFFFULL) * factor;
+    uint64_t high = (*fraction >> 32) * factor + (low >> 32);
+    uint64_t product = (high << 32) | (low & 0xFFFFFFFFULL);
+    uint64_t carry = high >> 32;
+    *fraction = product & bit_mask64(fractionBits);
+    return (unsigned)((carry << (64 - fractionBits)) | (product >> fractionBits));
+}
+
+// Writes the exact decimal value, e.g. "-1.25" or "0.000030517578125", returns the length (no terminator)
+static inline size_t format_fixed_decimal(uint64_t raw, qFormat format, char* out) {
+    bool negative;
+    uint64_t magnitude = fixed_magnitude(raw, format, &negative);
+    unsigned fractionBits = format.fractionBits;
+    uint64_t fraction = magnitude & bit_mask64(fractionBits);
+    char* position = out;
+
+    if (negative) {
+        *position++ = '-';
+    }
+    position += format_decimal_u64(magnitude >> fractionBits, position);
+    *position++ = '.';
+    if (fraction == 0) {
+        *position++ = '0';
+        return (size_t)(position - out);
+    }
+    // Two digits per multiplication, the fraction reaches 0 after at most fractionBits digits
+    while (fraction != 0) {
+        unsigned pair = fixed_next_digits(&fraction, fractionBits, 100);
+        memcpy(position, &decimalDigitPairs[pair * 2], 2);
+        position += 2;
+    }
+    // The last pair may end with a zero that is not part of the value
+    if (position[-1] == '0') {
+        position--;
+    }
+    return (size_t)(position - out);
+}
+
+// Writes "0x<integer>.<fraction>" in hexadecimal, e.g. Q16.16 0x00018000 -> "0x1.8"
+static inline size_t format_fixed_hex(uint64_t raw, qFormat format, char* out) {
+    bool negative;
+    uint64_t magnitude = fixed_magnitude(raw, format, &negative);
+    unsigned fractionBits = format.fractionBits;
+    uint64_t fraction = magnitude & bit_mask64(fractionBits);
+    char* position = out;
+
+    if (negative) {
+        *position++ = '-';
+    }
+    memcpy(position, "0x", 2);
+    position += 2;
+    position += format_hex_u64(magnitude >> fractionBits, position);
+    *position++ = '.';
+
+    // Fraction bits padded on the right to whole digits, trailing zero digits dropped (one is kept)
+    unsigned digits = (fractionBits + 3) / 4;
+    if (digits == 0) {
+        *position++ = '0';
+        return (size_t)(position - out);
+    }
+    position += format_hex_fixed(fraction << (4 * digits - fractionBits), (int)(4 * digits), position);
+    while (digits > 1 && position[-1] == '0') {
+        position--;
+        digits--;
+    }
+    return (size_t)(position - out);
+}
+
+// Writes "0b<integer>.<fraction>" in binary with all fraction bits, e.g. UQ4.4 0x28 -> "0b10.1000"
+static inline size_t format_fixed_binary(uint64_t raw, qFormat format, char* out) {
+    bool negative;
+    uint64_t magnitude = fixed_magnitude(raw, format, &negative);
+    unsigned fractionBits = format.fractionBits;
+    char* position = out;
+
+    if (negative) {
+        *position++ = '-';
+    }
+    memcpy(position, "0b", 2);
+    position += 2;
+    position += format_binary_u64(magnitude >> fractionBits, position);
+    *position++ = '.';
+    if (fractionBits == 0) {
+        *position++ = '0';
+        return (size_t)(position - out);
+    }
+    char bits[MAX_BINARY_TEXT_64];
+    format_binary_fixed(magnitude, MAX_BINARY_TEXT_64, bits);
+    memcpy(position, bits + MAX_BINARY_TEXT_64 - fractionBits, fractionBits);
+    position += fractionBits;
+    return (size_t)(position - out);
+}
+
+// Formats count raw values into out, one per line; out needs count * (MAX_FIXED_TEXT + 1) characters
+static inline size_t format_fixed_lines(const uint64_t* raws, size_t count, qFormat format, fixedTextBase base, char* out) {
+    char* position = out;
+    // One loop per base, so the writer is inlined instead of being called through a pointer
+    switch (base) {
+    case FIXED_TEXT_DECIMAL:
+        for (size_t i = 0; i < count; i++) {
+            position += format_fixed_decimal(raws[i], format, position);
+            *position++ = '\n';
+        }
+        break;
+    case FIXED_TEXT_HEX:
+        for (size_t i = 0; i < count; i++) {
+            position += format_fixed_hex(raws[i], format, position);
+            *position++ = '\n';
+        }
+        break;
+    default:
+        for (size_t i = 0; i < count; i++) {
+            position += format_fixed_binary(raws[i], format, position);
+            *position++ = '\n';
+        }
+        break;
+    }
+    return (size_t)(position - out);
+}
+
+// Value of a hexadecimal or binary digit, 16 for characters that are not digits of the base
+static inline unsigned fixed_digit_value(char character, unsigned bitsPerDigit) {
+    unsigned digit = (unsigned)(uint8_t)(character - '0');
+    if (bitsPerDigit == 4 && digit > 9) {
+        digit = (unsigned)(uint8_t)((character | 0x20) - 'a');
+        digit = (digit > 5) ? 16 : digit + 10;
+    }
+    return (digit < (1u << bitsPerDigit)) ? digit : 16;
+}
+
+// Rounds fraction digits of a power-of-2 base to fractionBits bits (ties to even; without fraction bits
+// integerIsOdd decides), the result may be 2^fractionBits when the fraction rounds up to the next integer
+static inline bool fixed_fraction_from_bits(const char* digits, size_t count, unsigned bitsPerDigit,
+                                            unsigned fractionBits, bool integerIsOdd, uint64_t* fraction) {
+    uint64_t collected = 0;
+    unsigned collectedBits = 0;
+    bool sticky = false;
+
+    for (size_t i = 0; i < count; i++) {
+        unsigned digit = fixed_digit_value(digits[i], bitsPerDigit);
+        if (digit > 15) {
+            return false;
+        }
+        if (collectedBits + bitsPerDigit <= 64) {
+            collected = (collected << bitsPerDigit) | digit;
+            collectedBits += bitsPerDigit;
+        }
+        else {
+            sticky |= (digit != 0);
+        }
+    }
+
+    if (collectedBits <= fractionBits) {
+        *fraction = collected << (fractionBits - collectedBits);
+        return true;
+    }
+    unsigned dropped = collectedBits - fractionBits;
+    uint64_t kept = (dropped == 64) ? 0 : collected >> dropped;
+    uint64_t rest = collected & bit_mask64(dropped);
+    uint64_t half = (uint64_t)1 << (dropped - 1);
+    bool keptIsOdd = fractionBits ? (kept & 0x1) : integerIsOdd;
+    *fraction = kept + (rest > half || (rest == half && (sticky || keptIsOdd)));
+    return true;
+}
+
+// Rounds a decimal fraction ("5" for .5) to fractionBits bits the same way as fixed_fraction_from_bits()
+static inline bool fixed_fraction_from_decimal(const char* digits, size_t count, unsigned fractionBits,
+                                               bool integerIsOdd, uint64_t* fraction) {
+    // Trailing zeros do not change the value
+    while (count > 0 && digits[count - 1] == '0') {
+        count--;
+    }
+    if (count == 0) {
+        *fraction = 0;
+        return true;
+    }
+
+    if (count <= FIXED_FAST_FRACTION_DIGITS) {
+        // value = numerator / 10^count: binary long division gives one fraction bit per step
+        uint64_t numerator;
+        if (parse_decimal_string(digits, count, UINT64_MAX, &numerator) != PARSE_OK) {
+            return false;
+        }
+        uint64_t divisor = fixedPowersOf10[count];
+        uint64_t remainder = numerator;
+        uint64_t bits = 0;
+        for (unsigned i = 0; i < fractionBits; i++) {
+            remainder <<= 1;
+            bool isSet = remainder >= divisor;
+            remainder -= isSet ? divisor : 0;
+            bits = (bits << 1) | isSet;
+        }
+        uint64_t twice = remainder << 1;
+        bool bitsAreOdd = fractionBits ? (bits & 0x1) : integerIsOdd;
+        *fraction = bits + (twice > divisor || (twice == divisor && bitsAreOdd));
+        return true;
+    }
+
+    // Long fractions: double the decimal digits, every carry out of the first digit is the next bit
+    uint8_t decimal[MAX_FIXED_FRACTION_DIGITS];
+    if (count > MAX_FIXED_FRACTION_DIGITS) {
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        decimal[i] = (uint8_t)(digits[i] - '0');
+        if (decimal[i] > 9) {
+            return false;
+        }
+    }
+    uint64_t bits = 0;
+    unsigned carry = 0;
+    for (unsigned bit = 0; bit <= fractionBits; bit++) {
+        carry = 0;
+        for (size_t i = count; i-- > 0;) {
+            unsigned doubled = decimal[i] * 2u + carry;
+            carry = doubled >= 10;
+            decimal[i] = (uint8_t)(doubled - (carry ? 10 : 0));
+        }
+        if (bit < fractionBits) {
+            bits = (bits << 1) | carry;
+        }
+    }
+    // The last carry is the bit worth half of the last kept bit, the digits left over are the sticky part
+    bool restIsZero = true;
+    for (size_t i = 0; i < count; i++) {
+        restIsZero &= (decimal[i] == 0);
+    }
+    bool bitsAreOdd = fractionBits ? (bits & 0x1) : integerIsOdd;
+    *fraction = bits + (carry && (!restIsZero || bitsAreOdd));
+    return true;
+}
+
+// Parses "-1.25", "0x1.8", "-0b10.01", ".5" or "3" into the raw bits of the format (no terminator needed)
+static inline numberParseStatus parse_fixed_string(const char* text, size_t length, qFormat format, uint64_t* raw) {
+    bool negative = false;
+    if (length > 0 && (text[0] == '-' || text[0] == '+')) {
+        negative = (text[0] == '-');
+        text++;
+        length--;
+    }
+    unsigned bitsPerDigit = 0;      // 0: decimal
+    if (length >= 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+        bitsPerDigit = 4;
+    }
+    else if (length >= 2 && text[0] == '0' && (text[1] == 'b' || text[1] == 'B')) {
+        bitsPerDigit = 1;
+    }
+    if (bitsPerDigit != 0) {
+        text += 2;
+        length -= 2;
+    }
+
+    const char* dot = memchr(text, '.', length);
+    size_t integerLength = dot ? (size_t)(dot - text) : length;
+    const char* fractionText = dot ? dot + 1 : text + length;
+    size_t fractionLength = dot ? length - integerLength - 1 : 0;
+    if (integerLength + fractionLength == 0) {
+        return PARSE_INVALID;
+    }
+
+    uint64_t integer = 0;
+    uint64_t fraction = 0;
+    unsigned fractionBits = format.fractionBits;
+    if (integerLength > 0) {
+        bool isValid;
+        if (bitsPerDigit == 4) {
+            isValid = parse_hex_string(text, integerLength, &integer);
+        }
+        else if (bitsPerDigit == 1) {
+            isValid = parse_binary_string(text, integerLength, &integer);
+        }
+        else {
+            numberParseStatus status = parse_decimal_string(text, integerLength, UINT64_MAX, &integer);
+            if (status != PARSE_OK) {
+                return status;
+            }
+            isValid = true;
+        }
+        if (!isValid) {
+            return PARSE_INVALID;
+        }
+    }
+    bool isValid = (bitsPerDigit == 0)
+        ? fixed_fraction_from_decimal(fractionText, fractionLength, fractionBits, integer & 0x1, &fraction)
+        : fixed_fraction_from_bits(fractionText, fractionLength, bitsPerDigit, fractionBits, integer & 0x1,
+                                   &fraction);
+    if (!isValid) {
+        return PARSE_INVALID;
+    }
+
+    // magnitude = integer * 2^n + fraction, the fraction may have rounded up to a whole 2^n
+    if (fractionBits > 0 && integer > bit_mask64(64 - fractionBits)) {
+        return PARSE_OVERFLOW;
+    }
+    uint64_t magnitude = (integer << fractionBits) + fraction;
+    if (magnitude < fraction) {
+        return PARSE_OVERFLOW;
+    }
+    uint64_t largest = format.isSigned ? ((uint64_t)1 << (format.totalBits - 1)) - !negative
+                                       : bit_mask64(format.totalBits);
+    if (magnitude > largest || (negative && !format.isSigned && magnitude != 0)) {
+        return PARSE_OVERFLOW;
+    }
+    *raw = (negative ? 0 - magnitude : magnitude) & bit_mask64(format.totalBits);
+    return PARSE_OK;
+}
+
+// Parses a block of newline separated fixed-point numbers, the same way as parse_decimal_lines()
+static inline size_t parse_fixed_lines(const char* text, size_t length, qFormat format, uint64_t* raws,
+                                       size_t maxValues, size_t* invalidLines, size_t* overflowLines) {
+    size_t stored = 0;
+    size_t invalid = 0;
+    size_t overflow = 0;
+    const char* end = text + length;
+
+    while (text < end && stored < maxValues) {
+        size_t lineLength = 0;
+        const char* nextLine = split_line(text, end, &lineLength);
+
+        if (lineLength > 0) {
+            numberParseStatus status = parse_fixed_string(text, lineLength, format, &raws[stored]);
+            if (status == PARSE_OK) {
+                stored++;
+            }
+            else if (status == PARSE_OVERFLOW) {
+                overflow++;
+            }
+            else {
+                invalid++;
+            }
+        }
+        text = nextLine;
+    }
+
+    if (invalidLines != NULL) {
+        *invalidLines = invalid;
+    }
+    if (overflowLines != NULL) {
+        *overflowLines = overflow;
+    }
+    return stored;
+}
+
+#endif // FIXED_POINT_H
@@ -0,0 +1,488 @@
+#ifndef FLOAT_FORMATTING_H
+#define FLOAT_FORMATTING_H
+
+// IEEE-754 float/double views for the converter:
+//  - the raw bits split into sign | exponent | mantissa, written with the fast binary writer
+//  - the shortest decimal text that reads back to exactly the same bits (Ryu algorithm,
+//    Ulf Adams 2018): the interval of decimals that round to the value is scaled by a
+//    precomputed power of 5 (floatTables.h) with integer arithmetic only, then digits are
+//    removed while the interval still holds two candidates. No floating point is used.
+// Text uses the same layout as Python's repr(): "0.1", "1.5e-07", "1e+16", "-0.0", "inf", "nan".
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "bitToolkit.h"
+#include "numberFormatting.h"
+#include "floatTables.h"
+
+#define DOUBLE_MANTISSA_BITS 52
+#define DOUBLE_EXPONENT_BITS 11
+#define DOUBLE_BIAS 1023
+#define FLOAT_MANTISSA_BITS 23
+#define FLOAT_EXPONENT_BITS 8
+#define FLOAT_BIAS 127
+
+#define MAX_FLOAT_TEXT 32                       // "-2.2250738585072014e-308" and friends
+#define MAX_FLOAT_BITS_TEXT 72                  // 64 binary digits + 2 separators " | "
+#define FIXED_NOTATION_MIN_EXPONENT (-4)        // below 1e-4 scientific notation is used
+#define FIXED_NOTATION_MAX_EXPONENT 16          // from 1e16 on scientific notation is used
+
+// Shortest decimal of a float/double: value = mantissa * 10^exponent
+typedef struct {
+    uint64_t mantissa;
+    int32_t exponent;
+} shortestDecimal;
+
+// ceil(log2(5^e)) for e > 0, 1 for e = 0 (valid for 0 <= e <= 3528)
+static inline int32_t ryu_pow5_bits(int32_t e) {
+    return (int32_t)((((uint32_t)e * 1217359) >> 19) + 1);
+}
+
+// floor(log10(2^e)) (valid for 0 <= e <= 1650)
+static inline uint32_t ryu_log10_pow2(int32_t e) {
+    return ((uint32_t)e * 78913) >> 18;
+}
+
+// floor(log10(5^e)) (valid for 0 <= e <= 2620)
+static inline uint32_t ryu_log10_pow5(int32_t e) {
+    return ((uint32_t)e * 732923) >> 20;
+}
+
+static inline uint32_t ryu_pow5_factor(uint64_t value) {
+    uint32_t count = 0;
+    while (value % 5 == 0) {
+        value /= 5;
+        count++;
+    }
+    return count;
+}
+
+static inline bool ryu_multiple_of_pow5(uint64_t value, uint32_t power) {
+    return ryu_pow5_factor(value) >= power;
+}
+
+static inline bool ryu_multiple_of_pow2(uint64_t value, uint32_t power) {
+    return (value & bit_mask64(power)) == 0;
+}
+
+// (m * multiplier) >> shift, where multiplier is a 128-bit table entry and 64 < shift < 128
+static inline uint64_t ryu_multiply_shift64(uint64_t m, const uint64_t multiplier[2], int32_t shift) {
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 low = (unsigned __int128)m * multiplier[0];
+    unsigned __int128 high = (unsigned __int128)m * multiplier[1];
+    return (uint64_t)(((low >> 64) + high) >> (shift - 64));
+#else
+    // 64x64 -> 128-bit products from 32-bit halves for compilers without __int128
+    uint64_t products[2][2];
+    for (int i = 0; i < 2; i++) {
+        uint64_t aLow = (uint32_t)m, aHigh = m >> 32;
+        uint64_t bLow = (uint32_t)multiplier[i], bHigh = multiplier[i] >> 32;
+        uint64_t lowLow = aLow * bLow, lowHigh = aLow * bHigh, highLow = aHigh * bLow, highHigh = aHigh * bHigh;
+        uint64_t middle = (lowLow >> 32) + (uint32_t)lowHigh + (uint32_t)highLow;
+        products[i][0] = (middle << 32) | (uint32_t)lowLow;
+        products[i][1] = highHigh + (lowHigh >> 32) + (highLow >> 32) + (middle >> 32);
+    }
+    uint64_t sumLow = products[0][1] + products[1][0];
+    uint64_t sumHigh = products[1][1] + (sumLow < products[0][1]);
+    int32_t distance = shift - 64;
+    return (sumHigh << (64 - distance)) | (sumLow >> distance);
+#endif
+}
+
+// (m * multiplier) >> shift for the 64-bit float table entries, 32 < shift < 96
+static inline uint32_t ryu_multiply_shift32(uint32_t m, uint64_t multiplier, int32_t shift) {
+    uint64_t low = (uint64_t)m * (uint32_t)multiplier;
+    uint64_t high = (uint64_t)m * (uint32_t)(multiplier >> 32);
+    return (uint32_t)(((low >> 32) + high) >> (shift - 32));
+}
+
+// Shortest decimal of a finite, non-zero double given as its raw mantissa and exponent fields
+static inline shortestDecimal ryu_double_to_decimal(uint64_t ieeeMantissa, uint32_t ieeeExponent) {
+    int32_t e2;
+    uint64_t m2;
+    if (ieeeExponent == 0) {
+        e2 = 1 - DOUBLE_BIAS - DOUBLE_MANTISSA_BITS - 2;
+        m2 = ieeeMantissa;
+    }
+    else {
+        e2 = (int32_t)ieeeExponent - DOUBLE_BIAS - DOUBLE_MANTISSA_BITS - 2;
+        m2 = ((uint64_t)1 << DOUBLE_MANTISSA_BITS) | ieeeMantissa;
+    }
+    // Round-half-even: the interval bounds belong to the value when its mantissa is even
+    bool acceptBounds = (m2 & 1) == 0;
+
+    // The value is mv / 4 * 2^e2, the halfway points to its neighbours are mp and mm
+    uint64_t mv = 4 * m2;
+    uint32_t mmShift = (ieeeMantissa != 0 || ieeeExponent <= 1);
+
+    uint64_t vr, vp, vm;
+    int32_t e10;
+    bool vmIsTrailingZeros = false;
+    bool vrIsTrailingZeros = false;
+    if (e2 >= 0) {
+        uint32_t q = ryu_log10_pow2(e2) - (e2 > 3);
+        e10 = (int32_t)q;
+        int32_t k = DOUBLE_POW5_INV_BITCOUNT + ryu_pow5_bits((int32_t)q) - 1;
+        int32_t i = -e2 + (int32_t)q + k;
+        vr = ryu_multiply_shift64(4 * m2, DOUBLE_POW5_INV_SPLIT[q], i);
+        vp = ryu_multiply_shift64(4 * m2 + 2, DOUBLE_POW5_INV_SPLIT[q], i);
+        vm = ryu_multiply_shift64(4 * m2 - 1 - mmShift, DOUBLE_POW5_INV_SPLIT[q], i);
+        if (q <= 21) {
+            // Only one of mp, mv and mm can be a multiple of 5
+            if (mv % 5 == 0) {
+                vrIsTrailingZeros = ryu_multiple_of_pow5(mv, q);
+            }
+            else if (acceptBounds) {
+                vmIsTrailingZeros = ryu_multiple_of_pow5(mv - 1 - mmShift, q);
+            }
+            else {
+                vp -= ryu_multiple_of_pow5(mv + 2, q);
+            }
+        }
+    }
+    else {
+        uint32_t q = ryu_log10_pow5(-e2) - (-e2 > 1);
+        e10 = (int32_t)q + e2;
+        int32_t i = -e2 - (int32_t)q;
+        int32_t k = ryu_pow5_bits(i) - DOUBLE_POW5_BITCOUNT;
+        int32_t j = (int32_t)q - k;
+        vr = ryu_multiply_shift64(4 * m2, DOUBLE_POW5_SPLIT[i], j);
+        vp = ryu_multiply_shift64(4 * m2 + 2, DOUBLE_POW5_SPLIT[i], j);
+        vm = ryu_multiply_shift64(4 * m2 - 1 - mmShift, DOUBLE_POW5_SPLIT[i], j);
+        if (q <= 1) {
+            // mv = 4 * m2 always has two trailing zero bits
+            vrIsTrailingZeros = true;
+            if (acceptBounds) {
+                vmIsTrailingZeros = (mmShift == 1);
+            }
+            else {
+                vp--;
+            }
+        }
+        else if (q < 63) {
+            vrIsTrailingZeros = ryu_multiple_of_pow2(mv, q);
+        }
+    }
+
+    // Remove digits while vp and vm still differ in the remaining ones
+    int32_t removed = 0;
+    uint8_t lastRemovedDigit = 0;
+    uint64_t output;
+    if (vmIsTrailingZeros || vrIsTrailingZeros) {
+        // Rare case: exact ties and the lower bound have to be tracked digit by digit
+        while (vp / 10 > vm / 10) {
+            vmIsTrailingZeros &= (vm % 10 == 0);
+            vrIsTrailingZeros &= (lastRemovedDigit == 0);
+            lastRemovedDigit = (uint8_t)(vr % 10);
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        if (vmIsTrailingZeros) {
+            while (vm % 10 == 0) {
+                vrIsTrailingZeros &= (lastRemovedDigit == 0);
+                lastRemovedDigit = (uint8_t)(vr % 10);
+                vr /= 10;
+                vp /= 10;
+                vm /= 10;
+                removed++;
+            }
+        }
+        if (vrIsTrailingZeros && lastRemovedDigit == 5 && vr % 2 == 0) {
+            // Exactly halfway: round to even
+            lastRemovedDigit = 4;
+        }
+        output = vr + ((vr == vm && (!acceptBounds || !vmIsTrailingZeros)) || lastRemovedDigit >= 5);
+    }
+    else {
+        // Common case: two digits at a time first, then one by one
+        bool roundUp = false;
+        if (vp / 100 > vm / 100) {
+            roundUp = (vr % 100) >= 50;
+            vr /= 100;
+            vp /= 100;
+            vm /= 100;
+            removed += 2;
+        }
+        while (vp / 10 > vm / 10) {
+            roundUp = (vr % 10) >= 5;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        output = vr + (vr == vm || roundUp);
+    }
+
+    shortestDecimal result = { output, e10 + removed };
+    return result;
+}
+
+// Shortest decimal of a finite, non-zero float, the 32-bit version of ryu_double_to_decimal()
+static inline shortestDecimal ryu_float_to_decimal(uint32_t ieeeMantissa, uint32_t ieeeExponent) {
+    int32_t e2;
+    uint32_t m2;
+    if (ieeeExponent == 0) {
+        e2 = 1 - FLOAT_BIAS - FLOAT_MANTISSA_BITS - 2;
+        m2 = ieeeMantissa;
+    }
+    else {
+        e2 = (int32_t)ieeeExponent - FLOAT_BIAS - FLOAT_MANTISSA_BITS - 2;
+        m2 = ((uint32_t)1 << FLOAT_MANTISSA_BITS) | ieeeMantissa;
+    }
+    bool acceptBounds = (m2 & 1) == 0;
+
+    uint32_t mv = 4 * m2;
+    uint32_t mp = 4 * m2 + 2;
+    uint32_t mmShift = (ieeeMantissa != 0 || ieeeExponent <= 1);
+    uint32_t mm = 4 * m2 - 1 - mmShift;
+
+    uint32_t vr, vp, vm;
+    int32_t e10;
+    bool vmIsTrailingZeros = false;
+    bool vrIsTrailingZeros = false;
+    uint8_t lastRemovedDigit = 0;
+    if (e2 >= 0) {
+        uint32_t q = ryu_log10_pow2(e2);
+        e10 = (int32_t)q;
+        int32_t k = FLOAT_POW5_INV_BITCOUNT + ryu_pow5_bits((int32_t)q) - 1;
+        int32_t i = -e2 + (int32_t)q + k;
+        vr = ryu_multiply_shift32(mv, FLOAT_POW5_INV_SPLIT[q], i);
+        vp = ryu_multiply_shift32(mp, FLOAT_POW5_INV_SPLIT[q], i);
+        vm = ryu_multiply_shift32(mm, FLOAT_POW5_INV_SPLIT[q], i);
+        if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+            // The loop below may not run, but the first removed digit is still needed for rounding
+            int32_t l = FLOAT_POW5_INV_BITCOUNT + ryu_pow5_bits((int32_t)(q - 1)) - 1;
+            lastRemovedDigit = (uint8_t)(ryu_multiply_shift32(mv, FLOAT_POW5_INV_SPLIT[q - 1],
+                                                              -e2 + (int32_t)q - 1 + l) % 10);
+        }
+        if (q <= 9) {
+            if (mv % 5 == 0) {
+                vrIsTrailingZeros = ryu_multiple_of_pow5(mv, q);
+            }
+            else if (acceptBounds) {
+                vmIsTrailingZeros = ryu_multiple_of_pow5(mm, q);
+            }
+            else {
+                vp -= ryu_multiple_of_pow5(mp, q);
+            }
+        }
+    }
+    else {
+        uint32_t q = ryu_log10_pow5(-e2);
+        e10 = (int32_t)q + e2;
+        int32_t i = -e2 - (int32_t)q;
+        int32_t k = ryu_pow5_bits(i) - FLOAT_POW5_BITCOUNT;
+        int32_t j = (int32_t)q - k;
+        vr = ryu_multiply_shift32(mv, FLOAT_POW5_SPLIT[i], j);
+        vp = ryu_multiply_shift32(mp, FLOAT_POW5_SPLIT[i], j);
+        vm = ryu_multiply_shift32(mm, FLOAT_POW5_SPLIT[i], j);
+        if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+            j = (int32_t)q - 1 - (ryu_pow5_bits(i + 1) - FLOAT_POW5_BITCOUNT);
+            lastRemovedDigit = (uint8_t)(ryu_multiply_shift32(mv, FLOAT_POW5_SPLIT[i + 1], j) % 10);
+        }
+        if (q <= 1) {
+            vrIsTrailingZeros = true;
+            if (acceptBounds) {
+                vmIsTrailingZeros = (mmShift == 1);
+            }
+            else {
+                vp--;
+            }
+        }
+        else if (q < 31) {
+            vrIsTrailingZeros = ryu_multiple_of_pow2(mv, q - 1);
+        }
+    }
+
+    int32_t removed = 0;
+    uint32_t output;
+    if (vmIsTrailingZeros || vrIsTrailingZeros) {
+        while (vp / 10 > vm / 10) {
+            vmIsTrailingZeros &= (vm % 10 == 0);
+            vrIsTrailingZeros &= (lastRemovedDigit == 0);
+            lastRemovedDigit = (uint8_t)(vr % 10);
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        if (vmIsTrailingZeros) {
+            while (vm % 10 == 0) {
+                vrIsTrailingZeros &= (lastRemovedDigit == 0);
+                lastRemovedDigit = (uint8_t)(vr % 10);
+                vr /= 10;
+                vp /= 10;
+                vm /= 10;
+                removed++;
+            }
+        }
+        if (vrIsTrailingZeros && lastRemovedDigit == 5 && vr % 2 == 0) {
+            lastRemovedDigit = 4;
+        }
+        output = vr + ((vr == vm && (!acceptBounds || !vmIsTrailingZeros)) || lastRemovedDigit >= 5);
+    }
+    else {
+        while (vp / 10 > vm / 10) {
+            lastRemovedDigit = (uint8_t)(vr % 10);
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        output = vr + (vr == vm || lastRemovedDigit >= 5);
+    }
+
+    shortestDecimal result = { output, e10 + removed };
+    return result;
+}
+
+// Lays out digits * 10^exponent like Python's repr(), returns the length (no terminator)
+static inline size_t format_shortest_decimal(bool negative, shortestDecimal decimal, char* out) {
+    char digits[MAX_DECIMAL_TEXT_64];
+    int count = (int)format_decimal_u64(decimal.mantissa, digits);
+    int scientificExponent = count - 1 + decimal.exponent;
+    char* position = out;
+
+    if (negative) {
+        *position++ = '-';
+    }
+    if (scientificExponent >= FIXED_NOTATION_MIN_EXPONENT && scientificExponent < FIXED_NOTATION_MAX_EXPONENT) {
+        if (decimal.exponent >= 0) {
+            // Whole number: digits, zeros, ".0"
+            memcpy(position, digits, (size_t)count);
+            position += count;
+            memset(position, '0', (size_t)decimal.exponent);
+            position += decimal.exponent;
+            memcpy(position, ".0", 2);
+            position += 2;
+        }
+        else if (scientificExponent >= 0) {
+            // Point inside the digits
+            int integerDigits = scientificExponent + 1;
+            memcpy(position, digits, (size_t)integerDigits);
+            position += integerDigits;
+            *position++ = '.';
+            memcpy(position, digits + integerDigits, (size_t)(count - integerDigits));
+            position += count - integerDigits;
+        }
+        else {
+            // "0.000ddd"
+            memcpy(position, "0.", 2);
+            position += 2;
+            memset(position, '0', (size_t)(-scientificExponent - 1));
+            position += -scientificExponent - 1;
+            memcpy(position, digits, (size_t)count);
+            position += count;
+        }
+    }
+    else {
+        *position++ = digits[0];
+        if (count > 1) {
+            *position++ = '.';
+            memcpy(position, digits + 1, (size_t)(count - 1));
+            position += count - 1;
+        }
+        *position++ = 'e';
+        *position++ = (scientificExponent < 0) ? '-' : '+';
+        int exponentValue = (scientificExponent < 0) ? -scientificExponent : scientificExponent;
+        if (exponentValue < 10) {
+            *position++ = '0';
+        }
+        position += format_decimal_u64((uint64_t)exponentValue, position);
+    }
+    return (size_t)(position - out);
+}
+
+// Writes text for the cases without digits to find (nan, inf, zero), returns 0 for the others
+static inline size_t format_special_float(bool negative, bool isNan, bool isInfinite, bool isZero, char* out) {
+    const char* text = NULL;
+    if (isNan) {
+        text = "nan";
+    }
+    else if (isInfinite) {
+        text = negative ? "-inf" : "inf";
+    }
+    else if (isZero) {
+        text = negative ? "-0.0" : "0.0";
+    }
+    if (text == NULL) {
+        return 0;
+    }
+    size_t length = strlen(text);
+    memcpy(out, text, length);
+    return length;
+}
+
+// Shortest text that reads back as exactly the same double, out needs MAX_FLOAT_TEXT characters
+static inline size_t format_double_shortest(double value, char* out) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    bool negative = (bits >> 63) != 0;
+    uint64_t ieeeMantissa = bit_field_extract64(bits, 0, DOUBLE_MANTISSA_BITS);
+    uint32_t ieeeExponent = (uint32_t)bit_field_extract64(bits, DOUBLE_MANTISSA_BITS, DOUBLE_EXPONENT_BITS);
+    uint32_t allOnes = (uint32_t)bit_mask32(DOUBLE_EXPONENT_BITS);
+
+    size_t length = format_special_float(negative, ieeeExponent == allOnes && ieeeMantissa != 0,
+                                         ieeeExponent == allOnes, ieeeExponent == 0 && ieeeMantissa == 0, out);
+    if (length > 0) {
+        return length;
+    }
+    return format_shortest_decimal(negative, ryu_double_to_decimal(ieeeMantissa, ieeeExponent), out);
+}
+
+// Shortest text that reads back as exactly the same float, out needs MAX_FLOAT_TEXT characters
+static inline size_t format_float_shortest(float value, char* out) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    bool negative = (bits >> 31) != 0;
+    uint32_t ieeeMantissa = bit_field_extract32(bits, 0, FLOAT_MANTISSA_BITS);
+    uint32_t ieeeExponent = bit_field_extract32(bits, FLOAT_MANTISSA_BITS, FLOAT_EXPONENT_BITS);
+    uint32_t allOnes = bit_mask32(FLOAT_EXPONENT_BITS);
+
+    size_t length = format_special_float(negative, ieeeExponent == allOnes && ieeeMantissa != 0,
+                                         ieeeExponent == allOnes, ieeeExponent == 0 && ieeeMantissa == 0, out);
+    if (length > 0) {
+        return length;
+    }
+    return format_shortest_decimal(negative, ryu_float_to_decimal(ieeeMantissa, ieeeExponent), out);
+}
+
+// Writes the raw bits as "sign | exponent | mantissa" in binary
+static inline size_t format_ieee_bits(uint64_t bits, int totalBits, int mantissaBits, char* out) {
+    char binary[MAX_BINARY_TEXT_64];
+    int exponentBits = totalBits - mantissaBits - 1;
+    format_binary_fixed(bits, totalBits, binary);
+
+    char* position = out;
+    *position++ = binary[0];
+    memcpy(position, " | ", 3);
+    position += 3;
+    memcpy(position, binary + 1, (size_t)exponentBits);
+    position += exponentBits;
+    memcpy(position, " | ", 3);
+    position += 3;
+    memcpy(position, binary + 1 + exponentBits, (size_t)mantissaBits);
+    position += mantissaBits;
+    return (size_t)(position - out);
+}
+
+// Binary view of a double (1 | 11 | 52 bits), out needs MAX_FLOAT_BITS_TEXT characters
+static inline size_t format_double_bits(double value, char* out) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return format_ieee_bits(bits, 64, DOUBLE_MANTISSA_BITS, out);
+}
+
+// Binary view of a float (1 | 8 | 23 bits), out needs MAX_FLOAT_BITS_TEXT characters
+static inline size_t format_float_bits(float value, char* out) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return format_ieee_bits(bits, 32, FLOAT_MANTISSA_BITS, out);
+}
+
+#endif // FLOAT_FORMATTING_H
@@ -0,0 +1,116 @@
+#ifndef FRAME_PLUGIN_H
+#define FRAME_PLUGIN_H
+
+// Plugin interface for site-specific processing of decoded frames (basicBinOperators --plugin).
+// A plugin is a shared object that exports
+//   const framePlugin* frame_plugin_entry(void);
+// (extern "C" when it is written in C++). The host reads frames in batches, decodes every field into its
+// own array and calls process() once per batch, never per frame, so a call costs nothing next to the
+// thousands of frames it covers. The plugin reads the field arrays and may
+//  - add alarm bits from FRAME_PLUGIN_FIRST_ALARM_BIT on (or clear built-in ones) in alarms[], and
+//  - write one derived value per frame into values[] and set hasValues.
+// Everything a plugin keeps between batches lives in the state returned by open().
+// The host loads plugins with dlopen() (POSIX; link with -ldl on glibc older than 2.34).
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define FRAME_PLUGIN_ABI_VERSION 1
+#define FRAME_PLUGIN_ENTRY "frame_plugin_entry"
+#define FRAME_PLUGIN_FIRST_ALARM_BIT 8          // bits 0-6 are the built-in ALARM_* flags
+
+// One batch, struct of arrays: element i of every array belongs to frame i
+typedef struct {
+    size_t count;
+    const uint32_t* devices;
+    const uint32_t* frames;             // raw frames
+    const int16_t* temperature;         // Celsius
+    const uint16_t* pressure;           // hPa
+    const uint8_t* humidity;            // the 4 raw humidity bits
+    const uint8_t* humidityBits;        // number of humidity bits set
+    const uint16_t* fluidLevel;         // liters
+    uint32_t* alarms;                   // built-in ALARM_* flags on entry, the plugin's mask on return
+    int64_t* values;                    // derived value per frame, printed when hasValues is set
+    bool hasValues;
+} framePluginBatch;
+
+typedef struct {
+    uint32_t abiVersion;                // FRAME_PLUGIN_ABI_VERSION the plugin was built with
+    const char* name;
+    void* (*open)(const char* argument);                    // may be NULL; NULL result means failure
+    void (*process)(void* state, framePluginBatch* batch);
+    void (*close)(void* state);                             // may be NULL; may print a summary to stderr
+} framePlugin;
+
+typedef const framePlugin* (*framePluginEntry)(void);
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <dlfcn.h>
+#define FRAME_PLUGIN_SUPPORTED 1
+
+// A loaded plugin and its state
+typedef struct {
+    void* library;
+    const framePlugin* plugin;
+    void* state;
+} framePluginHandle;
+
+// Loads the shared object and opens the plugin with its argument. On failure returns false and
+// *error says why (dlerror() text or a short message).
+static inline bool frame_plugin_load(framePluginHandle* handle, const char* path, const char* argument, const char** error) {
+    handle->library = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    handle->plugin = NULL;
+    handle->state = NULL;
+    if (handle->library == NULL) {
+        *error = dlerror();
+        return false;
+    }
+
+    // Object to function pointer through a union, ISO C has no direct conversion
+    union {
+        void* symbol;
+        framePluginEntry entry;
+    } lookup;
+    lookup.symbol = dlsym(handle->library, FRAME_PLUGIN_ENTRY);
+    handle->plugin = (lookup.symbol != NULL) ? lookup.entry() : NULL;
+    if (handle->plugin == NULL) {
+        *error = "the library has no " FRAME_PLUGIN_ENTRY "()";
+    }
+    else if (handle->plugin->abiVersion != FRAME_PLUGIN_ABI_VERSION) {
+        *error = "the plugin was built for another version of framePlugin.h";
+    }
+    else if (handle->plugin->process == NULL) {
+        *error = "the plugin has no process()";
+    }
+    else if (handle->plugin->open != NULL && (handle->state = handle->plugin->open(argument)) == NULL) {
+        *error = "the plugin could not start";
+    }
+    else {
+        return true;
+    }
+    dlclose(handle->library);
+    handle->library = NULL;
+    return false;
+}
+
+static inline void frame_plugin_process(const framePluginHandle* handle, framePluginBatch* batch) {
+    batch->hasValues = false;
+    handle->plugin->process(handle->state, batch);
+}
+
+static inline void frame_plugin_unload(framePluginHandle* handle) {
+    if (handle->plugin != NULL && handle->plugin->close != NULL) {
+        handle->plugin->close(handle->state);
+    }
+    if (handle->library != NULL) {
+        dlclose(handle->library);
+    }
+    handle->library = NULL;
+    handle->plugin = NULL;
+    handle->state = NULL;
+}
+
+#endif // __unix__ || __APPLE__
+
+#endif // FRAME_PLUGIN_H
@@ -0,0 +1,217 @@
+#ifndef GZIP_INPUT_H
+#define GZIP_INPUT_H
+
+// Transparent reading of gzip-compressed input for the modes that read frame lines from stdin.
+// gzip_input_start() looks at the first byte of stdin without stdio buffering: anything but the gzip magic is
+// pushed back with ungetc() and the mode reads stdin as before. A gzip input is moved to a thread that
+// inflates it with zlib into large buffers and writes them into a pipe that becomes the mode's new stdin, so
+// parsing runs while the next buffer is decompressed (no "gunzip |" process in between). On Linux the pipe is
+// enlarged to GZIP_INPUT_BUFFER_SIZE, the kernel ring then holds a whole buffer.
+// Concatenated (multi-member) files are inflated member after member; their boundaries are unknown without
+// scanning the whole file, so members are not inflated in parallel. A truncated or damaged input is an error.
+// Built without -DGZIP_INPUT_USE_ZLIB (and -lz) a gzip input is refused with a message.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+#define GZIP_INPUT_SUPPORTED 1
+
+#if defined(GZIP_INPUT_USE_ZLIB)
+#include <zlib.h>
+#endif
+
+#define GZIP_INPUT_MAGIC 0x1f                   // first byte of every gzip member, never the start of a text line
+#define GZIP_INPUT_BUFFER_SIZE (1024 * 1024)    // decompressed bytes written into the pipe at once
+#define GZIP_INPUT_READ_SIZE (1u << 16)         // compressed bytes read at once
+
+typedef enum {
+    GZIP_INPUT_PLAIN,       // stdin is read as it is
+    GZIP_INPUT_STARTED,     // stdin is the pipe of the decompressing thread
+    GZIP_INPUT_UNSUPPORTED, // gzip input, but built without zlib
+    GZIP_INPUT_FAILED
+} gzipInputState;
+
+typedef struct {
+    int source;             // the original stdin
+    int decoder;            // write end of the mode's pipe
+    pthread_t thread;
+    uint64_t inflated;
+    bool hasError;
+    const char* error;      // zlib's message when hasError is set
+} gzipInput;
+
+#if defined(GZIP_INPUT_USE_ZLIB)
+// Writes all of data to file, false on error (EPIPE when the mode has stopped reading)
+static inline bool gzip_input_write_all(int file, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(file, data, size);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        size -= (size_t)written;
+    }
+    return true;
+}
+
+// Decompressing thread: inflates the source (its first byte was already read) into the mode's pipe
+static inline void* gzip_input_thread(void* argument) {
+    gzipInput* input = argument;
+    unsigned char* compressed = malloc(GZIP_INPUT_READ_SIZE);
+    unsigned char* text = malloc(GZIP_INPUT_BUFFER_SIZE);
+    z_stream stream = { 0 };
+    bool isOpen = false;
+
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+    // 16 + MAX_WBITS: gzip header and trailer, the trailer's CRC is checked
+    if (compressed == NULL || text == NULL || inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) {
+        input->hasError = true;
+        input->error = "out of memory";
+    }
+    else {
+        isOpen = true;
+        compressed[0] = GZIP_INPUT_MAGIC;
+        stream.next_in = compressed;
+        stream.avail_in = 1;
+    }
+
+    bool isEnd = false;
+    bool isMemberEnd = false;
+    while (isOpen && !isEnd) {
+        if (stream.avail_in == 0) {
+            // Waiting for input is the only place gzip_input_finish() may cancel the thread
+            pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+            ssize_t count = read(input->source, compressed, GZIP_INPUT_READ_SIZE);
+            pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count <= 0) {
+                // Input that ends inside a member is cut short
+                input->hasError = (count < 0 || !isMemberEnd);
+                input->error = (count < 0) ? "read error" : "unexpected end of file";
+                break;
+            }
+            stream.next_in = compressed;
+            stream.avail_in = (uInt)count;
+        }
+
+        // Inflate all bytes read so far, a buffer at a time
+        do {
+            if (isMemberEnd) {
+                // More bytes after a member: the next member of a concatenated file
+                inflateReset(&stream);
+                isMemberEnd = false;
+            }
+            stream.next_out = text;
+            stream.avail_out = GZIP_INPUT_BUFFER_SIZE;
+            int status = inflate(&stream, Z_NO_FLUSH);
+            if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR) {
+                input->hasError = true;
+                input->error = (stream.msg != NULL) ? stream.msg : "invalid data";
+                isEnd = true;
+                break;
+            }
+            isMemberEnd = (status == Z_STREAM_END);
+
+            size_t length = GZIP_INPUT_BUFFER_SIZE - stream.avail_out;
+            input->inflated += length;
+            if (length > 0 && !gzip_input_write_all(input->decoder, (const char*)text, length)) {
+                // The mode has stopped reading, the rest is not needed
+                isEnd = true;
+            }
+        } while (!isEnd && (stream.avail_out == 0 || stream.avail_in > 0));
+    }
+
+    if (isOpen) {
+        inflateEnd(&stream);
+    }
+    free(compressed);
+    free(text);
+    close(input->decoder);
+    return NULL;
+}
+#endif
+
+// Looks at the first byte of stdin and, when it starts a gzip member, replaces stdin with the pipe of a
+// decompressing thread. Must run before anything reads stdin through stdio.
+static inline gzipInputState gzip_input_start(gzipInput* input) {
+    unsigned char first;
+    ssize_t count;
+    do {
+        count = read(STDIN_FILENO, &first, 1);
+    } while (count < 0 && errno == EINTR);
+    if (count <= 0) {
+        return GZIP_INPUT_PLAIN;
+    }
+    if (first != GZIP_INPUT_MAGIC) {
+        // Nothing was read through stdin yet, one byte of pushback is always possible
+        ungetc(first, stdin);
+        return GZIP_INPUT_PLAIN;
+    }
+#if defined(GZIP_INPUT_USE_ZLIB)
+    int decoderPipe[2];
+    input->inflated = 0;
+    input->hasError = false;
+    input->error = NULL;
+    if (pipe(decoderPipe) != 0) {
+        return GZIP_INPUT_FAILED;
+    }
+#if defined(F_SETPIPE_SZ)
+    // Best effort, the default pipe size only means more, smaller writes
+    fcntl(decoderPipe[1], F_SETPIPE_SZ, GZIP_INPUT_BUFFER_SIZE);
+#endif
+    input->source = dup(STDIN_FILENO);
+    if (input->source < 0 || dup2(decoderPipe[0], STDIN_FILENO) < 0) {
+        close(decoderPipe[0]);
+        close(decoderPipe[1]);
+        return GZIP_INPUT_FAILED;
+    }
+    close(decoderPipe[0]);
+    input->decoder = decoderPipe[1];
+
+    // A mode that stops early closes its pipe, the thread must get EPIPE rather than a signal
+    signal(SIGPIPE, SIG_IGN);
+    if (pthread_create(&input->thread, NULL, gzip_input_thread, input) != 0) {
+        dup2(input->source, STDIN_FILENO);
+        close(input->source);
+        close(input->decoder);
+        return GZIP_INPUT_FAILED;
+    }
+    return GZIP_INPUT_STARTED;
+#else
+    (void)input;
+    return GZIP_INPUT_UNSUPPORTED;
+#endif
+}
+
+// Closes the mode's stdin and stops the thread. False when the input could not be decompressed completely.
+static inline bool gzip_input_finish(gzipInput* input) {
+#if defined(GZIP_INPUT_USE_ZLIB)
+    // A thread blocked writing into the mode's pipe gets EPIPE, one waiting for input is cancelled
+    fclose(stdin);
+    pthread_cancel(input->thread);
+    pthread_join(input->thread, NULL);
+    close(input->source);
+    return !input->hasError;
+#else
+    (void)input;
+    return true;
+#endif
+}
+
+#endif // __unix__ || __APPLE__
+
+#endif // GZIP_INPUT_H
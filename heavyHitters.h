@@ -0,0 +1,277 @@
+#ifndef HEAVY_HITTERS_H
+#define HEAVY_HITTERS_H
+
+// Streaming heavy hitters in bounded memory:
+//  - Space-Saving keeps the k most frequent keys: k counters, a new key replaces the smallest counter
+//    and inherits its count as the error bound. Every count is an overestimate by at most its error,
+//    and error <= total / k. The counters form a min-heap, an open addressing table finds a key's counter.
+//  - Count-Min answers "how often did this key occur" for any key: depth rows of width counters,
+//    the estimate is the smallest of the key's counters and overestimates by at most
+//    e / width * total with probability 1 - e^-depth.
+// Both are mergeable: sketches filled by different threads can be added together.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SPACE_SAVING_EMPTY_SLOT UINT32_MAX
+
+typedef struct {
+    uint64_t key;
+    uint64_t count;
+    uint64_t error;         // count - error is a lower bound of the real count
+    uint32_t slot;          // position of the key in the lookup table
+} spaceSavingCounter;
+
+typedef struct {
+    size_t capacity;
+    size_t used;
+    uint64_t total;
+    spaceSavingCounter* counters;       // min-heap on count
+    uint32_t* table;                    // counter index per slot, linear probing
+    size_t tableMask;
+} spaceSaving;
+
+typedef struct {
+    size_t width;                       // power of two
+    size_t depth;
+    uint64_t total;
+    uint64_t* counters;                 // depth rows of width counters
+} countMinSketch;
+
+// 64-bit mixer (splitmix64 finalizer), spreads nearby device numbers over the whole table
+static inline uint64_t sketch_hash(uint64_t key) {
+    key ^= key >> 30;
+    key *= 0xBF58476D1CE4E5B9ULL;
+    key ^= key >> 27;
+    key *= 0x94D049BB133111EBULL;
+    return key ^ (key >> 31);
+}
+
+// ---------------------------------------------------------------------------
+// Space-Saving
+// ---------------------------------------------------------------------------
+
+static inline bool space_saving_init(spaceSaving* summary, size_t capacity) {
+    size_t tableSize = 16;
+    while (tableSize < 2 * capacity) {
+        tableSize *= 2;
+    }
+    memset(summary, 0, sizeof(*summary));
+    summary->capacity = capacity;
+    summary->tableMask = tableSize - 1;
+    summary->counters = malloc(capacity * sizeof(spaceSavingCounter));
+    summary->table = malloc(tableSize * sizeof(uint32_t));
+    if (capacity == 0 || summary->counters == NULL || summary->table == NULL) {
+        free(summary->counters);
+        free(summary->table);
+        return false;
+    }
+    memset(summary->table, 0xFF, tableSize * sizeof(uint32_t));
+    return true;
+}
+
+static inline void space_saving_reset(spaceSaving* summary) {
+    summary->used = 0;
+    summary->total = 0;
+    memset(summary->table, 0xFF, (summary->tableMask + 1) * sizeof(uint32_t));
+}
+
+static inline void space_saving_free(spaceSaving* summary) {
+    free(summary->counters);
+    free(summary->table);
+    memset(summary, 0, sizeof(*summary));
+}
+
+// Returns the slot holding key, or the empty slot where it would go
+static inline size_t space_saving_find_slot(const spaceSaving* summary, uint64_t key) {
+    size_t slot = (size_t)sketch_hash(key) & summary->tableMask;
+    while (summary->table[slot] != SPACE_SAVING_EMPTY_SLOT && summary->counters[summary->table[slot]].key != key) {
+        slot = (slot + 1) & summary->tableMask;
+    }
+    return slot;
+}
+
+// Removes a slot and shifts the following entries back, so no probe sequence is broken
+static inline void space_saving_remove_slot(spaceSaving* summary, size_t slot) {
+    size_t next = slot;
+    summary->table[slot] = SPACE_SAVING_EMPTY_SLOT;
+    while (true) {
+        next = (next + 1) & summary->tableMask;
+        uint32_t index = summary->table[next];
+        if (index == SPACE_SAVING_EMPTY_SLOT) {
+            return;
+        }
+        size_t home = (size_t)sketch_hash(summary->counters[index].key) & summary->tableMask;
+        // Move the entry when its home is not cyclically inside (slot, next]
+        bool staysAfterGap = (slot <= next) ? (slot < home && home <= next) : (slot < home || home <= next);
+        if (!staysAfterGap) {
+            summary->table[slot] = index;
+            summary->counters[index].slot = (uint32_t)slot;
+            summary->table[next] = SPACE_SAVING_EMPTY_SLOT;
+            slot = next;
+        }
+    }
+}
+
+static inline void space_saving_swap(spaceSaving* summary, size_t first, size_t second) {
+    spaceSavingCounter counter = summary->counters[first];
+    summary->counters[first] = summary->counters[second];
+    summary->counters[second] = counter;
+    summary->table[summary->counters[first].slot] = (uint32_t)first;
+    summary->table[summary->counters[second].slot] = (uint32_t)second;
+}
+
+static inline void space_saving_sift_up(spaceSaving* summary, size_t index) {
+    while (index > 0 && summary->counters[(index - 1) / 2].count > summary->counters[index].count) {
+        space_saving_swap(summary, index, (index - 1) / 2);
+        index = (index - 1) / 2;
+    }
+}
+
+static inline void space_saving_sift_down(spaceSaving* summary, size_t index) {
+    while (true) {
+        size_t smallest = index;
+        size_t left = 2 * index + 1;
+        size_t right = left + 1;
+        if (left < summary->used && summary->counters[left].count < summary->counters[smallest].count) {
+            smallest = left;
+        }
+        if (right < summary->used && summary->counters[right].count < summary->counters[smallest].count) {
+            smallest = right;
+        }
+        if (smallest == index) {
+            return;
+        }
+        space_saving_swap(summary, index, smallest);
+        index = smallest;
+    }
+}
+
+// Counts key weight times; error is the error the weight already carries (0 for fresh events)
+static inline void space_saving_add(spaceSaving* summary, uint64_t key, uint64_t weight, uint64_t error) {
+    size_t slot = space_saving_find_slot(summary, key);
+    summary->total += weight;
+
+    if (summary->table[slot] != SPACE_SAVING_EMPTY_SLOT) {
+        size_t index = summary->table[slot];
+        summary->counters[index].count += weight;
+        summary->counters[index].error += error;
+        space_saving_sift_down(summary, index);
+        return;
+    }
+    if (summary->used < summary->capacity) {
+        size_t index = summary->used++;
+        spaceSavingCounter counter = { key, weight, error, (uint32_t)slot };
+        summary->counters[index] = counter;
+        summary->table[slot] = (uint32_t)index;
+        space_saving_sift_up(summary, index);
+        return;
+    }
+
+    // Replace the smallest counter: the new key may have occurred up to that many times unseen
+    uint64_t minimum = summary->counters[0].count;
+    space_saving_remove_slot(summary, summary->counters[0].slot);
+    slot = space_saving_find_slot(summary, key);
+    spaceSavingCounter counter = { key, minimum + weight, minimum + error, (uint32_t)slot };
+    summary->counters[0] = counter;
+    summary->table[slot] = 0;
+    space_saving_sift_down(summary, 0);
+}
+
+// Adds all counters of from into into (e.g. per-thread summaries into the global one).
+// The counts of a summary always add up to its total, so the merged total is the sum of both.
+static inline void space_saving_merge(spaceSaving* into, const spaceSaving* from) {
+    for (size_t i = 0; i < from->used; i++) {
+        space_saving_add(into, from->counters[i].key, from->counters[i].count, from->counters[i].error);
+    }
+}
+
+static inline int space_saving_compare_counters(const void* first, const void* second) {
+    const spaceSavingCounter* a = first;
+    const spaceSavingCounter* b = second;
+    return (a->count < b->count) - (a->count > b->count);
+}
+
+// Copies the most frequent keys (largest count first) into top, returns how many were copied
+static inline size_t space_saving_top(const spaceSaving* summary, spaceSavingCounter* top, size_t count) {
+    spaceSavingCounter* sorted = malloc(summary->used * sizeof(spaceSavingCounter) + 1);
+    if (sorted == NULL) {
+        return 0;
+    }
+    memcpy(sorted, summary->counters, summary->used * sizeof(spaceSavingCounter));
+    qsort(sorted, summary->used, sizeof(spaceSavingCounter), space_saving_compare_counters);
+    if (count > summary->used) {
+        count = summary->used;
+    }
+    memcpy(top, sorted, count * sizeof(spaceSavingCounter));
+    free(sorted);
+    return count;
+}
+
+// ---------------------------------------------------------------------------
+// Count-Min
+// ---------------------------------------------------------------------------
+
+// width is rounded up to a power of two
+static inline bool count_min_init(countMinSketch* sketch, size_t width, size_t depth) {
+    size_t roundedWidth = 1;
+    while (roundedWidth < width) {
+        roundedWidth *= 2;
+    }
+    sketch->width = roundedWidth;
+    sketch->depth = depth;
+    sketch->total = 0;
+    sketch->counters = calloc(roundedWidth * depth, sizeof(uint64_t));
+    return depth > 0 && sketch->counters != NULL;
+}
+
+static inline void count_min_reset(countMinSketch* sketch) {
+    sketch->total = 0;
+    memset(sketch->counters, 0, sketch->width * sketch->depth * sizeof(uint64_t));
+}
+
+static inline void count_min_free(countMinSketch* sketch) {
+    free(sketch->counters);
+    sketch->counters = NULL;
+}
+
+// Column of key in row: two halves of one hash combined per row (double hashing)
+static inline size_t count_min_column(const countMinSketch* sketch, uint64_t hash, size_t row) {
+    uint64_t step = (hash >> 32) | 1;
+    return (size_t)((hash + row * step) & (sketch->width - 1));
+}
+
+static inline void count_min_add(countMinSketch* sketch, uint64_t key, uint64_t count) {
+    uint64_t hash = sketch_hash(key);
+    for (size_t row = 0; row < sketch->depth; row++) {
+        sketch->counters[row * sketch->width + count_min_column(sketch, hash, row)] += count;
+    }
+    sketch->total += count;
+}
+
+static inline uint64_t count_min_estimate(const countMinSketch* sketch, uint64_t key) {
+    uint64_t hash = sketch_hash(key);
+    uint64_t estimate = UINT64_MAX;
+    for (size_t row = 0; row < sketch->depth; row++) {
+        uint64_t counter = sketch->counters[row * sketch->width + count_min_column(sketch, hash, row)];
+        estimate = (counter < estimate) ? counter : estimate;
+    }
+    return estimate;
+}
+
+// Adds from into into, both must have the same width and depth
+static inline bool count_min_merge(countMinSketch* into, const countMinSketch* from) {
+    if (into->width != from->width || into->depth != from->depth) {
+        return false;
+    }
+    for (size_t i = 0; i < into->width * into->depth; i++) {
+        into->counters[i] += from->counters[i];
+    }
+    into->total += from->total;
+    return true;
+}
+
+#endif // HEAVY_HITTERS_H
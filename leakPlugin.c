@@ -0,0 +1,129 @@
+/*
+ * Example plugin for basicBinOperators --plugin (framePlugin.h): leak detection.
+ * The derived value of every frame is the change of the fluid level since the previous frame of the same
+ * device; a drop of more than the threshold (the plugin argument, 500 liters by default) raises alarm bit 8.
+ * The last level of every device is kept in an open addressing table that doubles when half full.
+ *
+ * Build:   gcc -O2 -shared -fPIC leakPlugin.c -o leakPlugin.so
+ * Run:     basicBinOperators --plugin ./leakPlugin.so 300 < frames.txt
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "framePlugin.h"
+
+#define LEAK_DEFAULT_DROP 500
+#define LEAK_ALARM_BIT FRAME_PLUGIN_FIRST_ALARM_BIT
+#define LEAK_MIN_SLOTS 1024
+
+typedef struct {
+    uint32_t device;
+    uint16_t level;
+    uint16_t isUsed;
+} leakDevice;
+
+typedef struct {
+    leakDevice* slots;
+    size_t mask;
+    size_t used;
+    int64_t drop;
+    uint64_t leaks;
+} leakState;
+
+static size_t leak_slot(uint32_t device, size_t mask) {
+    return (size_t)((device * 0x9E3779B1u) >> 8) & mask;
+}
+
+static leakDevice* leak_find(leakState* state, uint32_t device) {
+    size_t slot = leak_slot(device, state->mask);
+    while (state->slots[slot].isUsed && state->slots[slot].device != device) {
+        slot = (slot + 1) & state->mask;
+    }
+    return &state->slots[slot];
+}
+
+static int leak_grow(leakState* state) {
+    size_t count = 2 * (state->mask + 1);
+    leakDevice* slots = calloc(count, sizeof(leakDevice));
+    if (slots == NULL) {
+        return 0;
+    }
+    leakDevice* old = state->slots;
+    size_t oldCount = state->mask + 1;
+    state->slots = slots;
+    state->mask = count - 1;
+    for (size_t i = 0; i < oldCount; i++) {
+        if (old[i].isUsed) {
+            *leak_find(state, old[i].device) = old[i];
+        }
+    }
+    free(old);
+    return 1;
+}
+
+static void* leak_open(const char* argument) {
+    leakState* state = calloc(1, sizeof(leakState));
+    if (state == NULL) {
+        return NULL;
+    }
+    state->drop = (argument != NULL) ? strtoll(argument, NULL, 10) : LEAK_DEFAULT_DROP;
+    state->mask = LEAK_MIN_SLOTS - 1;
+    state->slots = calloc(LEAK_MIN_SLOTS, sizeof(leakDevice));
+    if (state->slots == NULL) {
+        free(state);
+        return NULL;
+    }
+    return state;
+}
+
+static void leak_process(void* argument, framePluginBatch* batch) {
+    leakState* state = argument;
+
+    for (size_t i = 0; i < batch->count; i++) {
+        if (2 * (state->used + 1) > state->mask + 1 && !leak_grow(state)) {
+            batch->values[i] = 0;
+            continue;
+        }
+        leakDevice* device = leak_find(state, batch->devices[i]);
+        int64_t change = 0;
+        if (device->isUsed) {
+            change = (int64_t)batch->fluidLevel[i] - device->level;
+        }
+        else {
+            device->isUsed = 1;
+            device->device = batch->devices[i];
+            state->used++;
+        }
+        device->level = batch->fluidLevel[i];
+
+        batch->values[i] = change;
+        if (-change > state->drop) {
+            batch->alarms[i] |= 1u << LEAK_ALARM_BIT;
+            state->leaks++;
+        }
+    }
+    batch->hasValues = true;
+}
+
+static void leak_close(void* argument) {
+    leakState* state = argument;
+    fprintf(stderr, "leak: %llu drops of more than %lld l in %zu tanks\n", (unsigned long long)state->leaks,
+        (long long)state->drop, state->used);
+    free(state->slots);
+    free(state);
+}
+
+static const framePlugin leakPlugin = {
+    FRAME_PLUGIN_ABI_VERSION,
+    "leak",
+    leak_open,
+    leak_process,
+    leak_close
+};
+
+const framePlugin* frame_plugin_entry(void) {
+    return &leakPlugin;
+}
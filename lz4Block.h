@@ -0,0 +1,617 @@
+#ifndef LZ4_BLOCK_H
+#define LZ4_BLOCK_H
+
+// Self-contained LZ4 compression in the standard LZ4 frame format (files open with the lz4 tool).
+// The block codec is the greedy LZ4 one: a 4096-entry hash table of 4-byte sequences finds earlier
+// occurrences up to 64 KB back, and every sequence is a token, literals, a 2-byte offset and a length.
+// The frame writer cuts its input into independent 1 MB blocks, so a group of blocks is compressed on
+// worker threads at the same time while the writer fills the next group, and the groups are written in
+// order. A block that does not shrink is stored as it is. Every block carries its xxHash32.
+// The reader accepts frames with independent blocks (the lz4 tool's default) and verifies the block and
+// content checksums a frame declares.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bitToolkit.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#define LZ4_HAS_THREADS 1
+#endif
+
+#define LZ4_BLOCK_MIN_MATCH 4
+#define LZ4_BLOCK_LAST_LITERALS 5       // the last 5 bytes are always literals
+#define LZ4_BLOCK_MATCH_LIMIT 12        // no match starts in the last 12 bytes
+#define LZ4_BLOCK_MAX_OFFSET 65535
+#define LZ4_BLOCK_HASH_LOG 12
+#define LZ4_BLOCK_SKIP_TRIGGER 6        // the search step grows by one every 64 misses
+#define LZ4_BLOCK_BOUND(size) ((size) + (size) / 255 + 16)
+
+#define LZ4_FRAME_MAGIC 0x184D2204u
+#define LZ4_FRAME_SKIPPABLE_MAGIC 0x184D2A50u       // 16 magics, low 4 bits free
+#define LZ4_FRAME_BLOCK_SIZE (1u << 20)             // block maximum size code 6
+#define LZ4_FRAME_BLOCK_SIZE_CODE 6
+#define LZ4_FRAME_STORED_BLOCK 0x80000000u
+#define LZ4_FRAME_MAX_THREADS 64
+
+static inline uint32_t lz4_read32(const uint8_t* data) {
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static inline uint32_t lz4_read_le32(const uint8_t* data) {
+    return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+static inline void lz4_write_le32(uint8_t* data, uint32_t value) {
+    data[0] = (uint8_t)value;
+    data[1] = (uint8_t)(value >> 8);
+    data[2] = (uint8_t)(value >> 16);
+    data[3] = (uint8_t)(value >> 24);
+}
+
+// ---------------------------------------------------------------------------
+// Block codec
+// ---------------------------------------------------------------------------
+
+static inline uint32_t lz4_hash(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - LZ4_BLOCK_HASH_LOG);
+}
+
+// Number of equal bytes at first and second, first stops at limit. Compares 8 bytes at once,
+// the lowest differing byte of the XOR is the end of the match.
+static inline size_t lz4_count_equal(const uint8_t* first, const uint8_t* second, const uint8_t* limit) {
+    const uint8_t* start = first;
+    while (first + 8 <= limit) {
+        uint64_t a;
+        uint64_t b;
+        memcpy(&a, first, sizeof(a));
+        memcpy(&b, second, sizeof(b));
+        if (a != b) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            return (size_t)(first - start) + (size_t)(bit_clz64(a ^ b) / 8);
+#else
+            return (size_t)(first - start) + (size_t)(bit_ctz64(a ^ b) / 8);
+#endif
+        }
+        first += 8;
+        second += 8;
+    }
+    while (first < limit && *first == *second) {
+        first++;
+        second++;
+    }
+    return (size_t)(first - start);
+}
+
+// Writes a length above 15 as a run of 255s and a final byte
+static inline uint8_t* lz4_write_length(uint8_t* out, size_t length) {
+    while (length >= 255) {
+        *out++ = 255;
+        length -= 255;
+    }
+    *out++ = (uint8_t)length;
+    return out;
+}
+
+// Writes one sequence, NULL when it does not fit before end
+static inline uint8_t* lz4_write_sequence(uint8_t* out, const uint8_t* end, const uint8_t* literals, size_t literalLength,
+                                          size_t offset, size_t matchLength) {
+    if ((size_t)(end - out) < 1 + literalLength / 255 + 1 + literalLength + 2 + matchLength / 255 + 1) {
+        return NULL;
+    }
+    uint8_t* token = out++;
+    *token = (uint8_t)(((literalLength < 15) ? literalLength : 15) << 4);
+    if (literalLength >= 15) {
+        out = lz4_write_length(out, literalLength - 15);
+    }
+    memcpy(out, literals, literalLength);
+    out += literalLength;
+    if (matchLength == 0) {
+        return out;         // the last sequence has no match
+    }
+    *out++ = (uint8_t)offset;
+    *out++ = (uint8_t)(offset >> 8);
+    matchLength -= LZ4_BLOCK_MIN_MATCH;
+    *token |= (uint8_t)((matchLength < 15) ? matchLength : 15);
+    if (matchLength >= 15) {
+        out = lz4_write_length(out, matchLength - 15);
+    }
+    return out;
+}
+
+// Compresses one independent block. table needs 1 << LZ4_BLOCK_HASH_LOG entries.
+// Returns the compressed size, 0 when it would not fit into capacity.
+static inline size_t lz4_compress_block(const uint8_t* source, size_t size, uint8_t* destination, size_t capacity, uint32_t* table) {
+    const uint8_t* end = destination + capacity;
+    uint8_t* out = destination;
+    size_t anchor = 0;
+
+    if (size > LZ4_BLOCK_MATCH_LIMIT) {
+        size_t matchFindLimit = size - LZ4_BLOCK_MATCH_LIMIT;
+        const uint8_t* matchLimit = source + size - LZ4_BLOCK_LAST_LITERALS;
+        size_t position = 1;
+
+        memset(table, 0, sizeof(uint32_t) << LZ4_BLOCK_HASH_LOG);
+        while (position <= matchFindLimit) {
+            // Look for a 4-byte match, stepping faster through data that does not compress
+            size_t candidate;
+            unsigned misses = 1u << LZ4_BLOCK_SKIP_TRIGGER;
+            while (true) {
+                uint32_t sequence = lz4_read32(source + position);
+                uint32_t hash = lz4_hash(sequence);
+                candidate = table[hash];
+                table[hash] = (uint32_t)position;
+                if (candidate < position && position - candidate <= LZ4_BLOCK_MAX_OFFSET && lz4_read32(source + candidate) == sequence) {
+                    break;
+                }
+                position += misses++ >> LZ4_BLOCK_SKIP_TRIGGER;
+                if (position > matchFindLimit) {
+                    break;
+                }
+            }
+            if (position > matchFindLimit) {
+                break;
+            }
+
+            // Grow the match backwards over equal literals, then forwards
+            while (position > anchor && candidate > 0 && source[position - 1] == source[candidate - 1]) {
+                position--;
+                candidate--;
+            }
+            size_t matchLength = LZ4_BLOCK_MIN_MATCH
+                + lz4_count_equal(source + position + LZ4_BLOCK_MIN_MATCH, source + candidate + LZ4_BLOCK_MIN_MATCH, matchLimit);
+
+            out = lz4_write_sequence(out, end, source + anchor, position - anchor, position - candidate, matchLength);
+            if (out == NULL) {
+                return 0;
+            }
+            position += matchLength;
+            anchor = position;
+            if (position <= matchFindLimit) {
+                table[lz4_hash(lz4_read32(source + position - 2))] = (uint32_t)(position - 2);
+            }
+        }
+    }
+
+    out = lz4_write_sequence(out, end, source + anchor, size - anchor, 0, 0);
+    return (out == NULL) ? 0 : (size_t)(out - destination);
+}
+
+// Decompresses one independent block, returns the decompressed size or -1 for corrupt input
+static inline long lz4_decompress_block(const uint8_t* source, size_t size, uint8_t* destination, size_t capacity) {
+    const uint8_t* in = source;
+    const uint8_t* inEnd = source + size;
+    uint8_t* out = destination;
+    const uint8_t* outEnd = destination + capacity;
+
+    while (in < inEnd) {
+        unsigned token = *in++;
+        size_t literalLength = token >> 4;
+        if (literalLength == 15) {
+            unsigned extra;
+            do {
+                if (in >= inEnd) {
+                    return -1;
+                }
+                extra = *in++;
+                literalLength += extra;
+            } while (extra == 255);
+        }
+        if ((size_t)(inEnd - in) < literalLength || (size_t)(outEnd - out) < literalLength) {
+            return -1;
+        }
+        memcpy(out, in, literalLength);
+        in += literalLength;
+        out += literalLength;
+        if (in == inEnd) {
+            break;          // the last sequence ends after its literals
+        }
+
+        if (inEnd - in < 2) {
+            return -1;
+        }
+        size_t offset = (size_t)in[0] | ((size_t)in[1] << 8);
+        in += 2;
+        size_t matchLength = token & 15;
+        if (matchLength == 15) {
+            unsigned extra;
+            do {
+                if (in >= inEnd) {
+                    return -1;
+                }
+                extra = *in++;
+                matchLength += extra;
+            } while (extra == 255);
+        }
+        matchLength += LZ4_BLOCK_MIN_MATCH;
+        if (offset == 0 || offset > (size_t)(out - destination) || (size_t)(outEnd - out) < matchLength) {
+            return -1;
+        }
+
+        // An offset shorter than the match repeats the bytes just written (runs), so copy forwards
+        const uint8_t* match = out - offset;
+        if (offset >= matchLength) {
+            memcpy(out, match, matchLength);
+            out += matchLength;
+        }
+        else {
+            for (size_t i = 0; i < matchLength; i++) {
+                *out++ = *match++;
+            }
+        }
+    }
+    return (long)(out - destination);
+}
+
+// ---------------------------------------------------------------------------
+// Frame format
+// ---------------------------------------------------------------------------
+
+#define LZ4_XXH32_PRIME1 2654435761u
+#define LZ4_XXH32_PRIME2 2246822519u
+#define LZ4_XXH32_PRIME3 3266489917u
+#define LZ4_XXH32_PRIME4 668265263u
+#define LZ4_XXH32_PRIME5 374761393u
+
+// Streaming xxHash32: the header checksum is the second byte of the descriptor's hash, block checksums
+// hash the stored bytes of a block and the content checksum hashes all decompressed data
+typedef struct {
+    uint32_t lanes[4];
+    uint8_t buffer[16];         // the start of a 16-byte stripe not complete yet
+    size_t buffered;
+    uint64_t total;
+    uint32_t seed;
+} lz4Xxh32;
+
+static inline void lz4_xxh32_init(lz4Xxh32* state, uint32_t seed) {
+    state->lanes[0] = seed + LZ4_XXH32_PRIME1 + LZ4_XXH32_PRIME2;
+    state->lanes[1] = seed + LZ4_XXH32_PRIME2;
+    state->lanes[2] = seed;
+    state->lanes[3] = seed - LZ4_XXH32_PRIME1;
+    state->buffered = 0;
+    state->total = 0;
+    state->seed = seed;
+}
+
+static inline void lz4_xxh32_stripe(uint32_t* lanes, const uint8_t* data) {
+    for (int i = 0; i < 4; i++) {
+        lanes[i] = bit_rotate_left32(lanes[i] + lz4_read_le32(data + 4 * i) * LZ4_XXH32_PRIME2, 13) * LZ4_XXH32_PRIME1;
+    }
+}
+
+static inline void lz4_xxh32_update(lz4Xxh32* state, const uint8_t* data, size_t size) {
+    const uint8_t* end = data + size;
+    state->total += size;
+    if (state->buffered > 0) {
+        size_t part = (size < 16 - state->buffered) ? size : 16 - state->buffered;
+        memcpy(state->buffer + state->buffered, data, part);
+        state->buffered += part;
+        data += part;
+        if (state->buffered < 16) {
+            return;
+        }
+        lz4_xxh32_stripe(state->lanes, state->buffer);
+        state->buffered = 0;
+    }
+    for (; data + 16 <= end; data += 16) {
+        lz4_xxh32_stripe(state->lanes, data);
+    }
+    memcpy(state->buffer, data, (size_t)(end - data));
+    state->buffered = (size_t)(end - data);
+}
+
+static inline uint32_t lz4_xxh32_digest(const lz4Xxh32* state) {
+    const uint32_t* lanes = state->lanes;
+    const uint8_t* data = state->buffer;
+    const uint8_t* end = data + state->buffered;
+    uint32_t hash;
+
+    if (state->total >= 16) {
+        hash = bit_rotate_left32(lanes[0], 1) + bit_rotate_left32(lanes[1], 7) + bit_rotate_left32(lanes[2], 12)
+            + bit_rotate_left32(lanes[3], 18);
+    }
+    else {
+        hash = state->seed + LZ4_XXH32_PRIME5;
+    }
+    hash += (uint32_t)state->total;
+    for (; data + 4 <= end; data += 4) {
+        hash = bit_rotate_left32(hash + lz4_read_le32(data) * LZ4_XXH32_PRIME3, 17) * LZ4_XXH32_PRIME4;
+    }
+    for (; data < end; data++) {
+        hash = bit_rotate_left32(hash + *data * LZ4_XXH32_PRIME5, 11) * LZ4_XXH32_PRIME1;
+    }
+    hash ^= hash >> 15;
+    hash *= LZ4_XXH32_PRIME2;
+    hash ^= hash >> 13;
+    hash *= LZ4_XXH32_PRIME3;
+    return hash ^ (hash >> 16);
+}
+
+static inline uint32_t lz4_xxh32(const uint8_t* data, size_t size, uint32_t seed) {
+    lz4Xxh32 state;
+    lz4_xxh32_init(&state, seed);
+    lz4_xxh32_update(&state, data, size);
+    return lz4_xxh32_digest(&state);
+}
+
+typedef struct {
+    const uint8_t* source;
+    size_t size;
+    uint8_t* compressed;
+    size_t compressedSize;      // 0 when the block is stored as it is
+    uint32_t checksum;          // xxHash32 of the bytes written for the block
+    uint32_t table[1 << LZ4_BLOCK_HASH_LOG];
+} lz4BlockJob;
+
+// Blocks of one group, compressed together while the writer fills the other group
+typedef struct {
+    uint8_t* input;             // threads blocks
+    uint8_t* compressed;        // one LZ4_BLOCK_BOUND() area per block
+    lz4BlockJob* jobs;
+    size_t count;
+    size_t started;             // jobs running on their own thread
+    bool isPending;             // compressing or compressed, not written yet
+#if defined(LZ4_HAS_THREADS)
+    pthread_t threadIds[LZ4_FRAME_MAX_THREADS];
+#endif
+} lz4BlockGroup;
+
+typedef struct {
+    FILE* output;
+    size_t threads;
+    lz4BlockGroup groups[2];
+    int filling;                // group filled by lz4_writer_write()
+    size_t used;
+    bool hasError;
+    uint64_t rawBytes;
+    uint64_t compressedBytes;
+} lz4FrameWriter;
+
+static inline void* lz4_compress_job(void* argument) {
+    lz4BlockJob* job = argument;
+    job->compressedSize = lz4_compress_block(job->source, job->size, job->compressed, job->size, job->table);
+    job->checksum = (job->compressedSize == 0) ? lz4_xxh32(job->source, job->size, 0)
+        : lz4_xxh32(job->compressed, job->compressedSize, 0);
+    return NULL;
+}
+
+static inline void lz4_writer_free(lz4FrameWriter* writer) {
+    for (int i = 0; i < 2; i++) {
+        free(writer->groups[i].input);
+        free(writer->groups[i].compressed);
+        free(writer->groups[i].jobs);
+    }
+}
+
+// Starts a frame on output, compressing up to threads blocks at a time
+static inline bool lz4_writer_open(lz4FrameWriter* writer, FILE* output, size_t threads) {
+    uint8_t header[7];
+    memset(writer, 0, sizeof(*writer));
+    writer->output = output;
+    writer->threads = (threads < 1) ? 1 : (threads > LZ4_FRAME_MAX_THREADS) ? LZ4_FRAME_MAX_THREADS : threads;
+    for (int i = 0; i < 2; i++) {
+        lz4BlockGroup* group = &writer->groups[i];
+        group->input = malloc(writer->threads * LZ4_FRAME_BLOCK_SIZE);
+        group->compressed = malloc(writer->threads * LZ4_BLOCK_BOUND(LZ4_FRAME_BLOCK_SIZE));
+        group->jobs = malloc(writer->threads * sizeof(lz4BlockJob));
+        if (group->input == NULL || group->compressed == NULL || group->jobs == NULL) {
+            lz4_writer_free(writer);
+            return false;
+        }
+    }
+
+    // Version 01, independent blocks, block checksums, no content size
+    lz4_write_le32(header, LZ4_FRAME_MAGIC);
+    header[4] = 0x70;
+    header[5] = LZ4_FRAME_BLOCK_SIZE_CODE << 4;
+    header[6] = (uint8_t)(lz4_xxh32(header + 4, 2, 0) >> 8);
+    writer->hasError = fwrite(header, 1, sizeof(header), output) != sizeof(header);
+    writer->compressedBytes = sizeof(header);
+    return true;
+}
+
+// Waits for the blocks of a group and writes them in order
+static inline void lz4_writer_finish_group(lz4FrameWriter* writer, lz4BlockGroup* group) {
+#if defined(LZ4_HAS_THREADS)
+    for (size_t i = 0; i < group->started; i++) {
+        pthread_join(group->threadIds[i], NULL);
+    }
+#endif
+    for (size_t i = group->started; i < group->count; i++) {
+        lz4_compress_job(&group->jobs[i]);
+    }
+
+    for (size_t i = 0; i < group->count; i++) {
+        const lz4BlockJob* job = &group->jobs[i];
+        bool isStored = (job->compressedSize == 0);
+        uint8_t blockHeader[4];
+        uint8_t blockChecksum[4];
+        size_t size = isStored ? job->size : job->compressedSize;
+        lz4_write_le32(blockHeader, (uint32_t)size | (isStored ? LZ4_FRAME_STORED_BLOCK : 0));
+        lz4_write_le32(blockChecksum, job->checksum);
+        if (fwrite(blockHeader, 1, 4, writer->output) != 4
+            || fwrite(isStored ? job->source : job->compressed, 1, size, writer->output) != size
+            || fwrite(blockChecksum, 1, 4, writer->output) != 4) {
+            writer->hasError = true;
+        }
+        writer->compressedBytes += 4 + size + 4;
+    }
+    group->isPending = false;
+}
+
+// Starts compressing the filled group on the worker threads, then writes the group before it
+static inline void lz4_writer_flush_blocks(lz4FrameWriter* writer) {
+    lz4BlockGroup* group = &writer->groups[writer->filling];
+    group->count = (writer->used + LZ4_FRAME_BLOCK_SIZE - 1) / LZ4_FRAME_BLOCK_SIZE;
+    group->started = 0;
+    for (size_t i = 0; i < group->count; i++) {
+        size_t start = i * LZ4_FRAME_BLOCK_SIZE;
+        group->jobs[i].source = group->input + start;
+        group->jobs[i].size = (writer->used - start < LZ4_FRAME_BLOCK_SIZE) ? writer->used - start : LZ4_FRAME_BLOCK_SIZE;
+        group->jobs[i].compressed = group->compressed + i * LZ4_BLOCK_BOUND(LZ4_FRAME_BLOCK_SIZE);
+    }
+#if defined(LZ4_HAS_THREADS)
+    for (; group->started < group->count; group->started++) {
+        if (pthread_create(&group->threadIds[group->started], NULL, lz4_compress_job, &group->jobs[group->started]) != 0) {
+            break;
+        }
+    }
+#endif
+    group->isPending = true;
+    writer->rawBytes += writer->used;
+    writer->used = 0;
+
+    writer->filling ^= 1;
+    if (writer->groups[writer->filling].isPending) {
+        lz4_writer_finish_group(writer, &writer->groups[writer->filling]);
+    }
+}
+
+static inline void lz4_writer_write(lz4FrameWriter* writer, const void* data, size_t size) {
+    const uint8_t* bytes = data;
+    size_t capacity = writer->threads * LZ4_FRAME_BLOCK_SIZE;
+    while (size > 0) {
+        size_t part = (size < capacity - writer->used) ? size : capacity - writer->used;
+        memcpy(writer->groups[writer->filling].input + writer->used, bytes, part);
+        writer->used += part;
+        bytes += part;
+        size -= part;
+        if (writer->used == capacity) {
+            lz4_writer_flush_blocks(writer);
+        }
+    }
+}
+
+// Writes the last blocks and the end mark. Returns false when anything could not be written.
+static inline bool lz4_writer_close(lz4FrameWriter* writer) {
+    static const uint8_t endMark[4] = { 0, 0, 0, 0 };
+    if (writer->used > 0) {
+        lz4_writer_flush_blocks(writer);
+    }
+    if (writer->groups[writer->filling ^ 1].isPending) {
+        lz4_writer_finish_group(writer, &writer->groups[writer->filling ^ 1]);
+    }
+    if (fwrite(endMark, 1, sizeof(endMark), writer->output) != sizeof(endMark) || fflush(writer->output) != 0) {
+        writer->hasError = true;
+    }
+    writer->compressedBytes += sizeof(endMark);
+    lz4_writer_free(writer);
+    return !writer->hasError;
+}
+
+// Reads and drops size bytes; fseek() would fail on the pipes --decompress is usually fed from
+static inline bool lz4_frame_skip(FILE* input, uint32_t size) {
+    uint8_t buffer[4096];
+    while (size > 0) {
+        size_t part = (size < sizeof(buffer)) ? size : sizeof(buffer);
+        if (fread(buffer, 1, part, input) != part) {
+            return false;
+        }
+        size -= (uint32_t)part;
+    }
+    return true;
+}
+
+// Decompresses all frames of input into output, verifying every checksum a frame declares. Returns false
+// for a damaged or unsupported stream.
+static inline bool lz4_frame_decompress(FILE* input, FILE* output) {
+    uint8_t header[20];            // magic, descriptor of up to 14 bytes, header checksum
+    uint8_t* compressed = NULL;
+    uint8_t* block = NULL;
+    size_t blockCapacity = 0;
+    bool isOk = true;
+
+    while (isOk && fread(header, 1, 4, input) == 4) {
+        uint32_t magic = lz4_read_le32(header);
+        if ((magic & 0xFFFFFFF0u) == LZ4_FRAME_SKIPPABLE_MAGIC) {
+            isOk = fread(header, 1, 4, input) == 4 && lz4_frame_skip(input, lz4_read_le32(header));
+            continue;
+        }
+        if (magic != LZ4_FRAME_MAGIC || fread(header + 4, 1, 2, input) != 2) {
+            isOk = false;
+            break;
+        }
+
+        uint8_t flags = header[4];
+        bool hasBlockChecksums = (flags & 0x10) != 0;
+        bool hasContentSize = (flags & 0x08) != 0;
+        bool hasContentChecksum = (flags & 0x04) != 0;
+        bool hasDictionary = (flags & 0x01) != 0;
+        size_t headerSize = 6 + (hasContentSize ? 8 : 0) + (hasDictionary ? 4 : 0);
+        unsigned sizeCode = (header[5] >> 4) & 7;
+        // Linked blocks would need the previous 64 KB as a dictionary
+        if ((flags >> 6) != 1 || (flags & 0x20) == 0 || sizeCode < 4
+            || fread(header + 6, 1, headerSize - 6 + 1, input) != headerSize - 6 + 1
+            || header[headerSize] != (uint8_t)(lz4_xxh32(header + 4, headerSize - 4, 0) >> 8)) {
+            isOk = false;
+            break;
+        }
+
+        size_t maxBlockSize = (size_t)1 << (8 + 2 * sizeCode);
+        if (maxBlockSize > blockCapacity) {
+            free(compressed);
+            free(block);
+            compressed = malloc(maxBlockSize);
+            block = malloc(maxBlockSize);
+            blockCapacity = maxBlockSize;
+            if (compressed == NULL || block == NULL) {
+                isOk = false;
+                break;
+            }
+        }
+
+        lz4Xxh32 content;
+        lz4_xxh32_init(&content, 0);
+        while (isOk) {
+            uint8_t sizeBytes[4];
+            if (fread(sizeBytes, 1, 4, input) != 4) {
+                isOk = false;
+                break;
+            }
+            uint32_t blockSize = lz4_read_le32(sizeBytes);
+            if (blockSize == 0) {
+                break;
+            }
+            bool isStored = (blockSize & LZ4_FRAME_STORED_BLOCK) != 0;
+            blockSize &= ~LZ4_FRAME_STORED_BLOCK;
+            if (blockSize > maxBlockSize || fread(compressed, 1, blockSize, input) != blockSize) {
+                isOk = false;
+                break;
+            }
+            // The checksum follows the block, a damaged block is never written out
+            if (hasBlockChecksums) {
+                isOk = fread(sizeBytes, 1, 4, input) == 4 && lz4_read_le32(sizeBytes) == lz4_xxh32(compressed, blockSize, 0);
+                if (!isOk) {
+                    break;
+                }
+            }
+            const uint8_t* data = compressed;
+            size_t size = blockSize;
+            if (!isStored) {
+                long decompressedSize = lz4_decompress_block(compressed, blockSize, block, maxBlockSize);
+                isOk = decompressedSize >= 0;
+                data = block;
+                size = isOk ? (size_t)decompressedSize : 0;
+            }
+            if (isOk && hasContentChecksum) {
+                lz4_xxh32_update(&content, data, size);
+            }
+            isOk = isOk && fwrite(data, 1, size, output) == size;
+        }
+        if (isOk && hasContentChecksum) {
+            isOk = fread(header, 1, 4, input) == 4 && lz4_read_le32(header) == lz4_xxh32_digest(&content);
+        }
+    }
+    free(compressed);
+    free(block);
+    return isOk && !ferror(input) && fflush(output) == 0;
+}
+
+#endif // LZ4_BLOCK_H
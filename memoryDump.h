@@ -0,0 +1,237 @@
+#ifndef MEMORY_DUMP_H
+#define MEMORY_DUMP_H
+
+// Hexdump of raw memory or firmware images in the same layout as "xxd":
+//   00000000: 2369 6e63 6c75 6465 203c 7374 6469 6f2e  #include <stdio.
+// Words at selected offsets can also be shown in binary, decimal and hexadecimal
+// below the line they belong to. The file is memory-mapped and every line is built
+// in a large output buffer. On x86 with SSSE3 the 16 bytes of a line are turned
+// into hex digits with two pshufb table lookups, other CPUs use a byte table.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "numberFormatting.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DUMP_HAS_SSSE3_PATH 1
+#endif
+
+#define DUMP_BYTES_PER_LINE 16
+#define DUMP_HEX_PER_LINE 32                    // two digits per byte
+#define DUMP_GROUP_BYTES 2                      // bytes printed together without a space
+#define DUMP_HEX_COLUMN_WIDTH 40                // 32 digits + 8 separators
+#define DUMP_OFFSET_DIGITS 8
+#define DUMP_MAX_LINE 256                       // enough for a dump line or a 64-bit word line
+#define DUMP_OUTPUT_BUFFER_SIZE (1024 * 1024)
+
+// Turns 16 bytes into 32 hex digits (byte 0 first), portable version
+static inline void dump_hex_digits_scalar(const uint8_t* bytes, char* digits) {
+    for (int i = 0; i < DUMP_BYTES_PER_LINE; i++) {
+        digits[2 * i] = hexDigits[bytes[i] >> 4];
+        digits[2 * i + 1] = hexDigits[bytes[i] & 0xF];
+    }
+}
+
+// Replaces everything outside of printable ASCII with '.', portable version
+static inline void dump_ascii_scalar(const uint8_t* bytes, size_t count, char* out) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = (bytes[i] >= 0x20 && bytes[i] < 0x7F) ? (char)bytes[i] : '.';
+    }
+}
+
+#if defined(DUMP_HAS_SSSE3_PATH)
+// SSSE3 version: pshufb uses each nibble as an index into the 16 hex characters
+__attribute__((target("ssse3")))
+static inline void dump_hex_digits_ssse3(const uint8_t* bytes, char* digits) {
+    const __m128i table = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7',
+                                        '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+    const __m128i lowNibble = _mm_set1_epi8(0x0F);
+    __m128i input = _mm_loadu_si128((const __m128i*)bytes);
+    __m128i high = _mm_shuffle_epi8(table, _mm_and_si128(_mm_srli_epi16(input, 4), lowNibble));
+    __m128i low = _mm_shuffle_epi8(table, _mm_and_si128(input, lowNibble));
+    // Interleave so every byte gives "high digit, low digit"
+    _mm_storeu_si128((__m128i*)digits, _mm_unpacklo_epi8(high, low));
+    _mm_storeu_si128((__m128i*)(digits + 16), _mm_unpackhi_epi8(high, low));
+}
+
+// SSE2 version of the printable check for a full line of 16 bytes
+static inline void dump_ascii_sse2(const uint8_t* bytes, char* out) {
+    __m128i input = _mm_loadu_si128((const __m128i*)bytes);
+    // Signed compares: bytes >= 0x80 are negative, so they fail the first test
+    __m128i printable = _mm_and_si128(_mm_cmpgt_epi8(input, _mm_set1_epi8(0x1F)),
+                                      _mm_cmplt_epi8(input, _mm_set1_epi8(0x7F)));
+    __m128i result = _mm_or_si128(_mm_and_si128(printable, input),
+                                  _mm_andnot_si128(printable, _mm_set1_epi8('.')));
+    _mm_storeu_si128((__m128i*)out, result);
+}
+#endif
+
+// Writes one dump line (up to 16 bytes) in xxd layout, returns its length
+static inline size_t dump_format_line(uint64_t offset, const uint8_t* bytes, size_t count, bool useSsse3, char* out) {
+    char digits[DUMP_HEX_PER_LINE];
+    char* position = out;
+    (void)useSsse3;
+
+    // Offset column: at least 8 hex digits like xxd
+    if (offset >> (4 * DUMP_OFFSET_DIGITS)) {
+        position += format_hex_u64(offset, position);
+    }
+    else {
+        for (int i = DUMP_OFFSET_DIGITS - 1; i >= 0; i--) {
+            *position++ = hexDigits[(offset >> (4 * i)) & 0xF];
+        }
+    }
+    *position++ = ':';
+    *position++ = ' ';
+
+    if (count == DUMP_BYTES_PER_LINE) {
+#if defined(DUMP_HAS_SSSE3_PATH)
+        if (useSsse3) {
+            dump_hex_digits_ssse3(bytes, digits);
+        }
+        else
+#endif
+        {
+            dump_hex_digits_scalar(bytes, digits);
+        }
+    }
+    else {
+        uint8_t padded[DUMP_BYTES_PER_LINE] = { 0 };
+        memcpy(padded, bytes, count);
+        dump_hex_digits_scalar(padded, digits);
+        // Missing bytes of the last line are shown as blanks
+        memset(digits + 2 * count, ' ', DUMP_HEX_PER_LINE - 2 * count);
+    }
+
+    // Groups of 2 bytes (4 digits) separated by a space
+    for (int group = 0; group < DUMP_BYTES_PER_LINE / DUMP_GROUP_BYTES; group++) {
+        memcpy(position, digits + 4 * group, 4);
+        position[4] = ' ';
+        position += 5;
+    }
+    *position++ = ' ';
+
+#if defined(DUMP_HAS_SSSE3_PATH)
+    if (count == DUMP_BYTES_PER_LINE) {
+        dump_ascii_sse2(bytes, position);
+    }
+    else
+#endif
+    {
+        dump_ascii_scalar(bytes, count, position);
+    }
+    position += count;
+    *position++ = '\n';
+    return (size_t)(position - out);
+}
+
+// Writes the little-endian word at offset in binary, decimal and hexadecimal, returns the line length
+static inline size_t dump_format_word(uint64_t offset, const uint8_t* bytes, int bits, char* out) {
+    uint64_t value = 0;
+    for (int i = bits / 8 - 1; i >= 0; i--) {
+        value = (value << 8) | bytes[i];
+    }
+
+    char* position = out;
+    memcpy(position, "  word @ 0x", 11);
+    position += 11;
+    position += format_hex_u64(offset, position);
+    memcpy(position, " = 0b", 5);
+    position += 5;
+    position += format_binary_fixed(value, bits, position);
+    memcpy(position, " = ", 3);
+    position += 3;
+    position += format_decimal_u64(value, position);
+    memcpy(position, " = 0x", 5);
+    position += 5;
+    position += format_hex_u64(value, position);
+    *position++ = '\n';
+    return (size_t)(position - out);
+}
+
+// Dumps the file to the stream. wordOffsets (sorted or not) select words of wordBits (8, 16, 32 or 64)
+// that are additionally shown in binary, decimal and hexadecimal. Returns 0 on success.
+static inline int dump_file(const char* path, FILE* stream, const uint64_t* wordOffsets, size_t wordCount, int wordBits) {
+    int file = open(path, O_RDONLY);
+    struct stat info;
+    if (file < 0 || fstat(file, &info) != 0) {
+        perror(path);
+        if (file >= 0) {
+            close(file);
+        }
+        return 1;
+    }
+
+    size_t length = (size_t)info.st_size;
+    const uint8_t* data = NULL;
+    if (length > 0) {
+        data = mmap(NULL, length, PROT_READ, MAP_PRIVATE, file, 0);
+        if (data == MAP_FAILED) {
+            perror(path);
+            close(file);
+            return 1;
+        }
+        madvise((void*)data, length, MADV_SEQUENTIAL);
+    }
+
+    char* output = malloc(DUMP_OUTPUT_BUFFER_SIZE);
+    if (output == NULL) {
+        fprintf(stderr, "Not enough memory for the dump\n");
+        if (data != NULL) {
+            munmap((void*)data, length);
+        }
+        close(file);
+        return 1;
+    }
+
+    bool useSsse3 = false;
+#if defined(DUMP_HAS_SSSE3_PATH)
+    useSsse3 = __builtin_cpu_supports("ssse3");
+#endif
+    size_t wordBytes = (size_t)wordBits / 8;
+    size_t used = 0;
+    int result = 0;
+
+    for (size_t offset = 0; offset < length; offset += DUMP_BYTES_PER_LINE) {
+        size_t count = (length - offset < DUMP_BYTES_PER_LINE) ? length - offset : DUMP_BYTES_PER_LINE;
+        used += dump_format_line(offset, data + offset, count, useSsse3, output + used);
+
+        for (size_t i = 0; i < wordCount; i++) {
+            if (wordOffsets[i] >= offset && wordOffsets[i] < offset + count &&
+                wordOffsets[i] + wordBytes <= length) {
+                used += dump_format_word(wordOffsets[i], data + wordOffsets[i], wordBits, output + used);
+            }
+        }
+
+        // Keep room for one more line and all its words before the next flush
+        if (used + DUMP_MAX_LINE * (wordCount + 1) > DUMP_OUTPUT_BUFFER_SIZE) {
+            if (fwrite(output, 1, used, stream) != used) {
+                result = 1;
+                break;
+            }
+            used = 0;
+        }
+    }
+    if (used > 0 && fwrite(output, 1, used, stream) != used) {
+        result = 1;
+    }
+
+    free(output);
+    if (data != NULL) {
+        munmap((void*)data, length);
+    }
+    close(file);
+    return result;
+}
+
+#endif // MEMORY_DUMP_H
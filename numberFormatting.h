@@ -0,0 +1,319 @@
+#ifndef NUMBER_FORMATTING_H
+#define NUMBER_FORMATTING_H
+
+// Writers turning numbers into decimal, hexadecimal or binary text without printf.
+// They write into a caller's buffer (no terminator) and return the number of characters,
+// so many values can be packed one after another into one big output buffer.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "bitToolkit.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <tmmintrin.h>
+#define FORMAT_HAS_SSSE3_PATH 1
+#endif
+
+// Longest text of a 64-bit number in every base
+#define MAX_DECIMAL_TEXT_64 20
+#define MAX_HEX_TEXT_64 16
+#define MAX_BINARY_TEXT_64 64
+
+// "00", "01", ... "99": two decimal digits per table lookup
+static const char decimalDigitPairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const char hexDigits[16] = { '0', '1', '2', '3', '4', '5', '6', '7',
+                                    '8', '9', 'a', 'b', 'c', 'd', 'e', 'f' };
+
+// Writes the value in decimal, two digits per step from the end of a temporary buffer
+static inline size_t format_decimal_u64(uint64_t value, char* out) {
+    char digits[MAX_DECIMAL_TEXT_64];
+    char* position = digits + MAX_DECIMAL_TEXT_64;
+
+    while (value >= 100) {
+        unsigned pair = (unsigned)(value % 100);
+        value /= 100;
+        position -= 2;
+        memcpy(position, &decimalDigitPairs[pair * 2], 2);
+    }
+    if (value >= 10) {
+        position -= 2;
+        memcpy(position, &decimalDigitPairs[value * 2], 2);
+    }
+    else {
+        *--position = (char)('0' + value);
+    }
+
+    size_t length = (size_t)(digits + MAX_DECIMAL_TEXT_64 - position);
+    memcpy(out, position, length);
+    return length;
+}
+
+// Writes the value in hexadecimal (lowercase, no prefix, no leading zeros)
+static inline size_t format_hex_u64(uint64_t value, char* out) {
+    // Significant bits rounded up to whole nibbles, 0 still needs one digit
+    int digits = (64 - bit_clz64(value | 1) + 3) / 4;
+    for (int i = digits - 1; i >= 0; i--) {
+        out[i] = hexDigits[value & 0xF];
+        value >>= 4;
+    }
+    return (size_t)digits;
+}
+
+// Turns the 8 bits of a byte into 8 '0'/'1' characters at once, most significant bit first
+static inline uint64_t binary_characters_of_byte(uint8_t byte) {
+    // Copy the byte into all 8 lanes and keep a different bit in each lane
+    uint64_t lanes = ((uint64_t)byte * 0x0101010101010101ULL) & 0x0102040810204080ULL;
+    // Any set bit makes the lane >= 0x80 after adding 0x7F, the top bit of each lane is the answer
+    lanes = ((lanes + 0x7F7F7F7F7F7F7F7FULL) >> 7) & 0x0101010101010101ULL;
+    lanes += 0x3030303030303030ULL;
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    lanes = bit_byte_swap64(lanes);
+#endif
+    return lanes;
+}
+
+// Writes exactly bits characters (8, 16, 32 or 64), leading zeros included, one byte per step
+static inline size_t format_binary_fixed(uint64_t value, int bits, char* out) {
+    for (int shift = bits - 8, i = 0; shift >= 0; shift -= 8, i++) {
+        uint64_t characters = binary_characters_of_byte((uint8_t)bit_field_extract64(value, (unsigned)shift, 8));
+        memcpy(out + 8 * i, &characters, sizeof(characters));
+    }
+    return (size_t)bits;
+}
+
+// "0000" ... "1111": four binary digits per table lookup
+static const char binaryNibbleText[16][4] = {
+    { '0', '0', '0', '0' }, { '0', '0', '0', '1' }, { '0', '0', '1', '0' }, { '0', '0', '1', '1' },
+    { '0', '1', '0', '0' }, { '0', '1', '0', '1' }, { '0', '1', '1', '0' }, { '0', '1', '1', '1' },
+    { '1', '0', '0', '0' }, { '1', '0', '0', '1' }, { '1', '0', '1', '0' }, { '1', '0', '1', '1' },
+    { '1', '1', '0', '0' }, { '1', '1', '0', '1' }, { '1', '1', '1', '0' }, { '1', '1', '1', '1' }
+};
+
+// Table version of format_binary_fixed(), one nibble per lookup
+static inline size_t format_binary_fixed_lut(uint64_t value, int bits, char* out) {
+    for (int shift = bits - 4, i = 0; shift >= 0; shift -= 4, i++) {
+        memcpy(out + 4 * i, binaryNibbleText[(value >> shift) & 0xF], 4);
+    }
+    return (size_t)bits;
+}
+
+#if defined(__SSE2__)
+// SSE2 version of format_binary_fixed(), 16 bits per step: every lane holds a copy of one byte
+// and tests its own bit, the compare result (0 or -1) turns '0' into '1'
+static inline size_t format_binary_fixed_sse2(uint64_t value, int bits, char* out) {
+    const __m128i bitOfLane = _mm_setr_epi8((char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+                                            (char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+    const __m128i zeroCharacters = _mm_set1_epi8('0');
+
+    if (bits == 8) {
+        uint64_t characters = binary_characters_of_byte((uint8_t)value);
+        memcpy(out, &characters, sizeof(characters));
+        return 8;
+    }
+    for (int shift = bits - 16, i = 0; shift >= 0; shift -= 16, i++) {
+        uint64_t highByte = (value >> (shift + 8)) & 0xFF;
+        uint64_t lowByte = (value >> shift) & 0xFF;
+        __m128i lanes = _mm_set_epi64x((long long)(lowByte * 0x0101010101010101ULL),
+                                       (long long)(highByte * 0x0101010101010101ULL));
+        __m128i isSet = _mm_cmpeq_epi8(_mm_and_si128(lanes, bitOfLane), bitOfLane);
+        _mm_storeu_si128((__m128i*)(out + 16 * i), _mm_sub_epi8(zeroCharacters, isSet));
+    }
+    return (size_t)bits;
+}
+#endif
+
+// Writes exactly bits / 4 hexadecimal digits (leading zeros included), one table lookup per nibble
+static inline size_t format_hex_fixed(uint64_t value, int bits, char* out) {
+    int digits = bits / 4;
+    for (int i = digits - 1; i >= 0; i--) {
+        out[i] = hexDigits[value & 0xF];
+        value >>= 4;
+    }
+    return (size_t)digits;
+}
+
+// SWAR version of format_hex_fixed(): spreads the 16 nibbles of the value into 16 bytes (two words)
+// and turns them into characters with a few additions, 'a'..'f' get an extra 'a' - '0' - 10
+static inline uint64_t hex_characters_of_word(uint32_t value) {
+    uint64_t nibbles = value;
+    nibbles = ((nibbles & 0xFFFF0000ULL) << 16) | (nibbles & 0xFFFFULL);
+    nibbles = ((nibbles << 8) | nibbles) & 0x00FF00FF00FF00FFULL;
+    nibbles = ((nibbles << 4) | nibbles) & 0x0F0F0F0F0F0F0F0FULL;
+    // Byte i now holds nibble i (lowest first); the top digit has to come first in memory
+    uint64_t isLetter = ((nibbles + 0x0606060606060606ULL) >> 4) & 0x0101010101010101ULL;
+    uint64_t characters = nibbles + 0x3030303030303030ULL + isLetter * ('a' - '0' - 10);
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    return characters;
+#else
+    return bit_byte_swap64(characters);
+#endif
+}
+
+static inline size_t format_hex_fixed_swar(uint64_t value, int bits, char* out) {
+    int digits = bits / 4;
+    if (digits < 8) {
+        // 8 and 16-bit numbers use the tail of a 32-bit conversion
+        char characters[8];
+        uint64_t word = hex_characters_of_word((uint32_t)value);
+        memcpy(characters, &word, sizeof(word));
+        memcpy(out, characters + 8 - digits, (size_t)digits);
+        return (size_t)digits;
+    }
+    for (int shift = bits - 32, i = 0; shift >= 0; shift -= 32, i++) {
+        uint64_t word = hex_characters_of_word((uint32_t)(value >> shift));
+        memcpy(out + 8 * i, &word, sizeof(word));
+    }
+    return (size_t)digits;
+}
+
+#if defined(FORMAT_HAS_SSSE3_PATH)
+// SSSE3 version of format_hex_fixed(): byte-swap so the top byte comes first,
+// then one pshufb table lookup for all high nibbles and one for all low nibbles.
+// Only call it when __builtin_cpu_supports("ssse3") is true.
+__attribute__((target("ssse3")))
+static inline size_t format_hex_fixed_ssse3(uint64_t value, int bits, char* out) {
+    const __m128i table = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7',
+                                        '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+    const __m128i lowNibble = _mm_set1_epi8(0x0F);
+    int digits = bits / 4;
+    uint64_t topByteFirst = bit_byte_swap64(value << (64 - bits));
+    __m128i bytes = _mm_loadl_epi64((const __m128i*)&topByteFirst);
+    __m128i high = _mm_shuffle_epi8(table, _mm_and_si128(_mm_srli_epi16(bytes, 4), lowNibble));
+    __m128i low = _mm_shuffle_epi8(table, _mm_and_si128(bytes, lowNibble));
+    char characters[16];
+    _mm_storeu_si128((__m128i*)characters, _mm_unpacklo_epi8(high, low));
+    memcpy(out, characters, (size_t)digits);
+    return (size_t)digits;
+}
+#endif
+
+// Binary text of a word of up to 32 bits with separators between its bit fields,
+// e.g. "0000000000001 | 0101 | 0000011 | 00011000". The layout is built once: for every output
+// character it holds the binary character it comes from, or the separator character.
+#define MAX_BINARY_FIELDS_TEXT 48
+#define BINARY_FIELDS_SEPARATOR 0xFF
+
+typedef struct {
+    int bits;
+    size_t length;
+    uint8_t source[MAX_BINARY_FIELDS_TEXT];         // index into the 32 binary characters or BINARY_FIELDS_SEPARATOR
+    char separators[MAX_BINARY_FIELDS_TEXT];        // separator characters at their positions, 0 elsewhere
+#if defined(FORMAT_HAS_SSSE3_PATH)
+    bool useSsse3;
+    uint8_t shuffleHigh[MAX_BINARY_FIELDS_TEXT];    // pshufb masks picking from the first / last 16 characters
+    uint8_t shuffleLow[MAX_BINARY_FIELDS_TEXT];
+#endif
+} binaryFieldLayout;
+
+// Prepares the layout of a bits wide word (1..32). fieldStarts are the lowest bits of the upper fields
+// in descending order, e.g. { 19, 15, 8 } splits 32 bits into 31-19 | 18-15 | 14-8 | 7-0.
+// Returns false when the text would not fit into MAX_BINARY_FIELDS_TEXT characters.
+static inline bool binary_field_layout_init(binaryFieldLayout* layout, int bits, const int* fieldStarts,
+                                            size_t fieldCount, const char* separator) {
+    size_t separatorLength = strlen(separator);
+    if (bits < 1 || bits > 32 || (size_t)bits + fieldCount * separatorLength > MAX_BINARY_FIELDS_TEXT) {
+        return false;
+    }
+    memset(layout, 0, sizeof(*layout));
+    layout->bits = bits;
+
+    size_t position = 0;
+    size_t field = 0;
+    for (int bit = bits - 1; bit >= 0; bit--) {
+        // The word is written as 32 characters, a narrower one starts 32 - bits characters in
+        layout->source[position++] = (uint8_t)(31 - bit);
+        if (field < fieldCount && bit == fieldStarts[field]) {
+            for (size_t i = 0; i < separatorLength; i++) {
+                layout->separators[position] = separator[i];
+                layout->source[position++] = BINARY_FIELDS_SEPARATOR;
+            }
+            field++;
+        }
+    }
+    layout->length = position;
+
+#if defined(FORMAT_HAS_SSSE3_PATH)
+    // Lanes with the top bit set make pshufb write 0, the separators are ORed in afterwards
+    for (size_t i = 0; i < MAX_BINARY_FIELDS_TEXT; i++) {
+        uint8_t source = (i < position) ? layout->source[i] : BINARY_FIELDS_SEPARATOR;
+        layout->shuffleHigh[i] = (source < 16) ? source : 0x80;
+        layout->shuffleLow[i] = (source >= 16 && source < 32) ? (uint8_t)(source - 16) : 0x80;
+    }
+    layout->useSsse3 = __builtin_cpu_supports("ssse3");
+#endif
+    return true;
+}
+
+// Portable version: binary characters from the table writer, then one lookup per output character
+static inline size_t format_binary_fields_portable(uint32_t value, const binaryFieldLayout* layout, char* out) {
+    char binary[32];
+    format_binary_fixed_lut(value, 32, binary);
+    for (size_t i = 0; i < layout->length; i++) {
+        uint8_t source = layout->source[i];
+        out[i] = (source == BINARY_FIELDS_SEPARATOR) ? layout->separators[i] : binary[source];
+    }
+    return layout->length;
+}
+
+#if defined(FORMAT_HAS_SSSE3_PATH)
+// SSSE3 version: the 32 characters are built in two registers like format_binary_fixed_sse2(),
+// then every 16 output characters are two pshufb (one per register) ORed with the separators.
+// Writes MAX_BINARY_FIELDS_TEXT characters, only the first layout->length of them are the text.
+__attribute__((target("ssse3")))
+static inline size_t format_binary_fields_ssse3(uint32_t value, const binaryFieldLayout* layout, char* out) {
+    const __m128i bitOfLane = _mm_setr_epi8((char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+                                            (char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+    const __m128i zeroCharacters = _mm_set1_epi8('0');
+    __m128i characters[2];
+
+    for (int half = 0; half < 2; half++) {
+        uint32_t bits16 = value >> (16 - 16 * half);
+        uint64_t highByte = (bits16 >> 8) & 0xFF;
+        uint64_t lowByte = bits16 & 0xFF;
+        __m128i lanes = _mm_set_epi64x((long long)(lowByte * 0x0101010101010101ULL),
+                                       (long long)(highByte * 0x0101010101010101ULL));
+        __m128i isSet = _mm_cmpeq_epi8(_mm_and_si128(lanes, bitOfLane), bitOfLane);
+        characters[half] = _mm_sub_epi8(zeroCharacters, isSet);
+    }
+    for (int block = 0; block < MAX_BINARY_FIELDS_TEXT / 16; block++) {
+        __m128i fromHigh = _mm_shuffle_epi8(characters[0], _mm_loadu_si128((const __m128i*)(layout->shuffleHigh + 16 * block)));
+        __m128i fromLow = _mm_shuffle_epi8(characters[1], _mm_loadu_si128((const __m128i*)(layout->shuffleLow + 16 * block)));
+        __m128i separators = _mm_loadu_si128((const __m128i*)(layout->separators + 16 * block));
+        _mm_storeu_si128((__m128i*)(out + 16 * block), _mm_or_si128(_mm_or_si128(fromHigh, fromLow), separators));
+    }
+    return layout->length;
+}
+#endif
+
+// Writes the word with its field separators, out needs MAX_BINARY_FIELDS_TEXT characters of room
+static inline size_t format_binary_fields(uint32_t value, const binaryFieldLayout* layout, char* out) {
+#if defined(FORMAT_HAS_SSSE3_PATH)
+    if (layout->useSsse3) {
+        return format_binary_fields_ssse3(value, layout, out);
+    }
+#endif
+    return format_binary_fields_portable(value, layout, out);
+}
+
+// Writes the value in binary without leading zeros
+static inline size_t format_binary_u64(uint64_t value, char* out) {
+    char digits[MAX_BINARY_TEXT_64];
+    format_binary_fixed(value, MAX_BINARY_TEXT_64, digits);
+
+    // 0 still needs one digit
+    size_t leadingZeros = (size_t)bit_clz64(value | 1);
+    memcpy(out, digits + leadingZeros, MAX_BINARY_TEXT_64 - leadingZeros);
+    return MAX_BINARY_TEXT_64 - leadingZeros;
+}
+
+#endif // NUMBER_FORMATTING_H
@@ -0,0 +1,266 @@
+#ifndef NUMBER_PARSING_H
+#define NUMBER_PARSING_H
+
+// Parsers turning text written in binary, hexadecimal or decimal back into numbers.
+// On x86 with SSE2 binary characters are checked 16 at a time, other targets
+// (e.g. microcontrollers) use the plain per-character loop.
+// Decimal digits are handled 8 at a time inside a 64-bit word on every target.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "bitToolkit.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Limits of the binary parser
+#define MAX_BINARY_DIGITS 64
+#define BINARY_CHUNK_SIZE 16
+
+// Limit of the hexadecimal parser
+#define MAX_HEX_DIGITS_64 16
+
+// Limits of the decimal parser, 20 digits cover the whole uint64_t range
+#define MAX_DECIMAL_DIGITS 20
+#define DECIMAL_CHUNK_DIGITS 8
+#define DECIMAL_PADDED_DIGITS 24
+
+// Result of parsing a number that has to fit into a given width
+typedef enum {
+    PARSE_OK,
+    PARSE_INVALID,
+    PARSE_OVERFLOW
+} numberParseStatus;
+
+// Finds the end of the line starting at text (without "\n" or "\r\n"), returns the start of the next line
+static inline const char* split_line(const char* text, const char* end, size_t* lineLength) {
+    const char* newLine = memchr(text, '\n', (size_t)(end - text));
+    const char* lineEnd = newLine ? newLine : end;
+
+    *lineLength = (size_t)(lineEnd - text);
+    if (*lineLength > 0 && text[*lineLength - 1] == '\r') {
+        (*lineLength)--;
+    }
+    return newLine ? newLine + 1 : end;
+}
+
+// Skips an optional "0b"/"0B" prefix, returns the number of skipped characters
+static inline size_t skip_binary_prefix(const char* text, size_t length) {
+    if (length >= 2 && text[0] == '0' && (text[1] == 'b' || text[1] == 'B')) {
+        return 2;
+    }
+    return 0;
+}
+
+// Parses "0b1011..." or "1011..." (1 to 64 digits, no terminator needed).
+// Returns false if the text contains anything other than 0/1 or is too long.
+static inline bool parse_binary_string(const char* text, size_t length, uint64_t* value) {
+    size_t prefix = skip_binary_prefix(text, length);
+    size_t digits = length - prefix;
+
+    if (digits == 0 || digits > MAX_BINARY_DIGITS) {
+        return false;
+    }
+    text += prefix;
+
+#if defined(__SSE2__)
+    // Right-align the digits in a block of 64 '0' characters, so leading
+    // padding does not change the value and every chunk is a full load.
+    char padded[MAX_BINARY_DIGITS];
+    memset(padded, '0', sizeof(padded));
+    memcpy(padded + MAX_BINARY_DIGITS - digits, text, digits);
+
+    const __m128i zeroChar = _mm_set1_epi8('0');
+    const __m128i oneChar = _mm_set1_epi8('1');
+    uint64_t onesMask = 0;
+    uint64_t validMask = 0;
+
+    for (int chunk = 0; chunk < MAX_BINARY_DIGITS / BINARY_CHUNK_SIZE; chunk++) {
+        __m128i characters = _mm_loadu_si128((const __m128i*)(padded + chunk * BINARY_CHUNK_SIZE));
+        __m128i isOne = _mm_cmpeq_epi8(characters, oneChar);
+        __m128i isDigit = _mm_or_si128(isOne, _mm_cmpeq_epi8(characters, zeroChar));
+        // movemask collects the top bit of every byte: bit i = character i of the chunk
+        onesMask |= (uint64_t)(uint16_t)_mm_movemask_epi8(isOne) << (chunk * BINARY_CHUNK_SIZE);
+        validMask |= (uint64_t)(uint16_t)_mm_movemask_epi8(isDigit) << (chunk * BINARY_CHUNK_SIZE);
+    }
+
+    if (validMask != UINT64_MAX) {
+        return false;
+    }
+    // The first character is the most significant bit, movemask gives it as bit 0
+    *value = bit_reverse64(onesMask);
+    return true;
+#else
+    uint64_t result = 0;
+    for (size_t i = 0; i < digits; i++) {
+        if (text[i] != '0' && text[i] != '1') {
+            return false;
+        }
+        result = (result << 1) | (uint64_t)(text[i] - '0');
+    }
+    *value = result;
+    return true;
+#endif
+}
+
+// Parses a block of newline separated binary numbers (e.g. a whole file read into memory).
+// Valid values are stored in order, lines that cannot be parsed are skipped and counted.
+// Empty lines are ignored. Returns the number of stored values.
+static inline size_t parse_binary_lines(const char* text, size_t length, uint64_t* values,
+                                        size_t maxValues, size_t* invalidLines) {
+    size_t stored = 0;
+    size_t invalid = 0;
+    const char* end = text + length;
+
+    while (text < end && stored < maxValues) {
+        size_t lineLength = 0;
+        const char* nextLine = split_line(text, end, &lineLength);
+
+        if (lineLength > 0) {
+            if (parse_binary_string(text, lineLength, &values[stored])) {
+                stored++;
+            }
+            else {
+                invalid++;
+            }
+        }
+        text = nextLine;
+    }
+
+    if (invalidLines != NULL) {
+        *invalidLines = invalid;
+    }
+    return stored;
+}
+
+// Parses "0x1F..." or "1f..." (1 to 16 digits, either case, no terminator needed)
+static inline bool parse_hex_string(const char* text, size_t length, uint64_t* value) {
+    if (length >= 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+        text += 2;
+        length -= 2;
+    }
+    if (length == 0 || length > MAX_HEX_DIGITS_64) {
+        return false;
+    }
+
+    uint64_t result = 0;
+    for (size_t i = 0; i < length; i++) {
+        uint8_t character = (uint8_t)text[i];
+        uint8_t digit = (uint8_t)(character - '0');
+        if (digit > 9) {
+            // Setting bit 5 turns 'A'..'F' into 'a'..'f'
+            digit = (uint8_t)((character | 0x20) - 'a');
+            if (digit > 5) {
+                return false;
+            }
+            digit += 10;
+        }
+        result = (result << 4) | digit;
+    }
+    *value = result;
+    return true;
+}
+
+// Loads 8 characters as a little-endian word, so the first character is the lowest byte
+static inline uint64_t load_eight_characters(const char* text) {
+    uint64_t word;
+    memcpy(&word, text, sizeof(word));
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    word = bit_byte_swap64(word);
+#endif
+    return word;
+}
+
+// Checks that all 8 bytes of the word are '0'..'9' (0x30..0x39) without looking at them one by one
+static inline bool are_eight_digits(uint64_t word) {
+    // Upper nibble must be 3 and adding 6 to the lower nibble must not carry into it
+    return (((word & 0xF0F0F0F0F0F0F0F0ULL) |
+             (((word + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) == 0x3333333333333333ULL);
+}
+
+// Converts 8 decimal characters into their value with three multiply-add steps:
+// pairs of digits, then groups of four, then the full eight digits
+static inline uint32_t eight_digits_value(uint64_t word) {
+    word = (word & 0x0F0F0F0F0F0F0F0FULL) * 2561 >> 8;                            // 10 * first + second digit
+    word = (word & 0x00FF00FF00FF00FFULL) * 6553601 >> 16;                        // 100 * first + second pair
+    return (uint32_t)((word & 0x0000FFFF0000FFFFULL) * 42949672960001ULL >> 32);  // 10000 * first + second group
+}
+
+// Parses an unsigned decimal number of 1 to 20 digits (no terminator needed).
+// maxValue is the largest value of the target type, e.g. (selectedNumberFormat)-1,
+// anything above it (or above UINT64_MAX) is reported as PARSE_OVERFLOW.
+static inline numberParseStatus parse_decimal_string(const char* text, size_t length, uint64_t maxValue, uint64_t* value) {
+    if (length == 0 || length > MAX_DECIMAL_DIGITS) {
+        return PARSE_INVALID;
+    }
+
+    // Right-align the digits in 24 '0' characters, so there are always three full chunks
+    char padded[DECIMAL_PADDED_DIGITS];
+    memset(padded, '0', sizeof(padded));
+    memcpy(padded + DECIMAL_PADDED_DIGITS - length, text, length);
+
+    uint64_t high = load_eight_characters(padded);
+    uint64_t middle = load_eight_characters(padded + DECIMAL_CHUNK_DIGITS);
+    uint64_t low = load_eight_characters(padded + 2 * DECIMAL_CHUNK_DIGITS);
+    if (!are_eight_digits(high) || !are_eight_digits(middle) || !are_eight_digits(low)) {
+        return PARSE_INVALID;
+    }
+
+    // At most 20 digits, so the high chunk holds no more than 4 significant digits
+    uint64_t highValue = eight_digits_value(high);
+    uint64_t lowPart = (uint64_t)eight_digits_value(middle) * 100000000ULL + eight_digits_value(low);
+
+    // UINT64_MAX = 1844 * 10^16 + 6744073709551615
+    if (highValue > 1844 || (highValue == 1844 && lowPart > 6744073709551615ULL)) {
+        return PARSE_OVERFLOW;
+    }
+    uint64_t result = highValue * 10000000000000000ULL + lowPart;
+    if (result > maxValue) {
+        return PARSE_OVERFLOW;
+    }
+    *value = result;
+    return PARSE_OK;
+}
+
+// Parses a block of newline separated decimal numbers, the same way as parse_binary_lines().
+// Lines that are not numbers or do not fit into maxValue are skipped and counted separately.
+static inline size_t parse_decimal_lines(const char* text, size_t length, uint64_t maxValue, uint64_t* values,
+                                         size_t maxValues, size_t* invalidLines, size_t* overflowLines) {
+    size_t stored = 0;
+    size_t invalid = 0;
+    size_t overflow = 0;
+    const char* end = text + length;
+
+    while (text < end && stored < maxValues) {
+        size_t lineLength = 0;
+        const char* nextLine = split_line(text, end, &lineLength);
+
+        if (lineLength > 0) {
+            numberParseStatus status = parse_decimal_string(text, lineLength, maxValue, &values[stored]);
+            if (status == PARSE_OK) {
+                stored++;
+            }
+            else if (status == PARSE_OVERFLOW) {
+                overflow++;
+            }
+            else {
+                invalid++;
+            }
+        }
+        text = nextLine;
+    }
+
+    if (invalidLines != NULL) {
+        *invalidLines = invalid;
+    }
+    if (overflowLines != NULL) {
+        *overflowLines = overflow;
+    }
+    return stored;
+}
+
+#endif // NUMBER_PARSING_H
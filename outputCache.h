@@ -0,0 +1,102 @@
+#ifndef OUTPUT_CACHE_H
+#define OUTPUT_CACHE_H
+
+// Direct-mapped cache of formatted output, keyed by a 32-bit value (a raw frame). Tanks send the same few frame
+// values again and again, so the text of a frame is formatted once and later copied with a single memcpy.
+// Every key has exactly one slot (Fibonacci hashing of the key); a new key overwrites whatever was there, so the
+// memory is fixed at slots * blockSize bytes and a lookup is one compare. Each block carries 8 bits of flags
+// (e.g. the alarms of the frame) for decisions that should not need the frame decoded again.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define OUTPUT_CACHE_MIN_SLOTS 16
+#define OUTPUT_CACHE_MAX_BLOCK UINT16_MAX
+
+typedef struct {
+    uint32_t key;
+    uint16_t length;        // 0 for an empty slot, formatted blocks are never empty
+    uint8_t flags;
+} outputCacheSlot;
+
+typedef struct {
+    outputCacheSlot* slots;
+    char* blocks;           // blockSize bytes per slot
+    size_t blockSize;
+    unsigned shift;         // 32 - log2(slot count)
+    uint64_t hits;
+    uint64_t misses;
+} outputCache;
+
+// At least slotCount slots (rounded up to a power of two) of blockSize bytes each
+static inline bool output_cache_init(outputCache* cache, size_t slotCount, size_t blockSize) {
+    size_t count = OUTPUT_CACHE_MIN_SLOTS;
+    unsigned bits = 4;
+    while (count < slotCount && bits < 31) {
+        count *= 2;
+        bits++;
+    }
+    memset(cache, 0, sizeof(*cache));
+    if (blockSize == 0 || blockSize > OUTPUT_CACHE_MAX_BLOCK) {
+        return false;
+    }
+    cache->slots = calloc(count, sizeof(outputCacheSlot));
+    cache->blocks = malloc(count * blockSize);
+    if (cache->slots == NULL || cache->blocks == NULL) {
+        free(cache->slots);
+        free(cache->blocks);
+        memset(cache, 0, sizeof(*cache));
+        return false;
+    }
+    cache->blockSize = blockSize;
+    cache->shift = 32 - bits;
+    return true;
+}
+
+static inline void output_cache_free(outputCache* cache) {
+    free(cache->slots);
+    free(cache->blocks);
+    memset(cache, 0, sizeof(*cache));
+}
+
+static inline size_t output_cache_slot(const outputCache* cache, uint32_t key) {
+    return (size_t)((key * 0x9E3779B1u) >> cache->shift);
+}
+
+// The cached block of key and its length and flags, NULL on a miss. Counts hits and misses.
+static inline const char* output_cache_lookup(outputCache* cache, uint32_t key, size_t* length, uint8_t* flags) {
+    size_t slot = output_cache_slot(cache, key);
+    const outputCacheSlot* entry = &cache->slots[slot];
+    if (entry->length == 0 || entry->key != key) {
+        cache->misses++;
+        return NULL;
+    }
+    cache->hits++;
+    *length = entry->length;
+    *flags = entry->flags;
+    return cache->blocks + slot * cache->blockSize;
+}
+
+// Block (blockSize bytes) to format the output of key into after a miss, then call output_cache_store()
+static inline char* output_cache_block(const outputCache* cache, uint32_t key) {
+    return cache->blocks + output_cache_slot(cache, key) * cache->blockSize;
+}
+
+// Makes the block of key valid, replacing the previous key of the slot
+static inline void output_cache_store(outputCache* cache, uint32_t key, size_t length, uint8_t flags) {
+    outputCacheSlot* entry = &cache->slots[output_cache_slot(cache, key)];
+    entry->key = key;
+    entry->length = (uint16_t)length;
+    entry->flags = flags;
+}
+
+// Share of lookups that hit, 0 before the first lookup
+static inline double output_cache_hit_rate(const outputCache* cache) {
+    uint64_t lookups = cache->hits + cache->misses;
+    return (lookups > 0) ? (double)cache->hits / (double)lookups : 0.0;
+}
+
+#endif // OUTPUT_CACHE_H
@@ -0,0 +1,312 @@
+#ifndef RAW_ARCHIVE_H
+#define RAW_ARCHIVE_H
+
+// Archiving of the raw input while it is decoded (Linux: tee/splice, other POSIX systems: read/write).
+// raw_archive_start() moves stdin to a thread and gives the decoder the read end of a pipe as its new
+// stdin. The thread duplicates every chunk of input into that pipe with tee() and then moves the same
+// bytes into the archive file with splice(); both stay in kernel pipe buffers, nothing is copied through
+// user space. Input that is not a pipe (a socket or a file) is first spliced into a staging pipe.
+// When the decoder stops reading early the rest of the input is still archived.
+// A compressed archive is an LZ4 frame (lz4Block.h); its bytes have to be read to be compressed, so with a
+// compressed archive the thread reads every chunk once and writes it both to the compressor and into the
+// decoder's pipe (read/write, no tee()).
+// The program must define _GNU_SOURCE before its first include for tee() and splice().
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "lz4Block.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#define RAW_ARCHIVE_SUPPORTED 1
+
+#if defined(__linux__) && defined(_GNU_SOURCE)
+#define RAW_ARCHIVE_ZERO_COPY 1
+#endif
+
+#define RAW_ARCHIVE_CHUNK (1u << 16)
+
+typedef struct {
+    int source;             // the original stdin
+    int archive;
+    int decoder;            // write end of the decoder's pipe, -1 once the decoder has stopped reading
+    pthread_t thread;
+    uint64_t archived;
+    uint64_t copied;        // bytes that had to go through user space
+    bool hasError;
+    bool isCompressed;
+    FILE* compressedFile;
+    lz4FrameWriter compressor;
+} rawArchive;
+
+// Writes all of data to file, false on error (EPIPE when the reader is gone)
+static inline bool raw_archive_write_all(int file, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(file, data, size);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        size -= (size_t)written;
+    }
+    return true;
+}
+
+static inline bool raw_archive_store(rawArchive* archive, const char* data, size_t size) {
+    if (archive->isCompressed) {
+        lz4_writer_write(&archive->compressor, data, size);
+        return !archive->compressor.hasError;
+    }
+    return raw_archive_write_all(archive->archive, data, size);
+}
+
+// Copies the input through user space, to the decoder too unless it has stopped
+static inline void raw_archive_copy(rawArchive* archive, int input) {
+    char buffer[RAW_ARCHIVE_CHUNK];
+    while (true) {
+        // Waiting for input is the only place raw_archive_stop() may cancel the thread
+        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+        ssize_t count = read(input, buffer, sizeof(buffer));
+        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            archive->hasError |= (count < 0);
+            return;
+        }
+        if (!raw_archive_store(archive, buffer, (size_t)count)) {
+            archive->hasError = true;
+            return;
+        }
+        archive->archived += (uint64_t)count;
+        archive->copied += (uint64_t)count;
+        if (archive->decoder >= 0 && !raw_archive_write_all(archive->decoder, buffer, (size_t)count)) {
+            close(archive->decoder);
+            archive->decoder = -1;
+        }
+    }
+}
+
+#if defined(RAW_ARCHIVE_ZERO_COPY)
+// Moves count bytes from the pipe input into the archive, through user space if splice() refuses the file
+static inline bool raw_archive_move(rawArchive* archive, int input, size_t count) {
+    while (count > 0) {
+        ssize_t moved = splice(input, NULL, archive->archive, NULL, count, SPLICE_F_MOVE);
+        if (moved < 0 && errno == EINTR) {
+            continue;
+        }
+        if (moved <= 0) {
+            char buffer[RAW_ARCHIVE_CHUNK];
+            ssize_t readCount = read(input, buffer, (count < sizeof(buffer)) ? count : sizeof(buffer));
+            if (readCount <= 0 || !raw_archive_write_all(archive->archive, buffer, (size_t)readCount)) {
+                return false;
+            }
+            archive->copied += (uint64_t)readCount;
+            moved = readCount;
+        }
+        archive->archived += (uint64_t)moved;
+        count -= (size_t)moved;
+    }
+    return true;
+}
+#endif
+
+static inline void* raw_archive_thread(void* argument) {
+    rawArchive* archive = argument;
+    int input = archive->source;
+
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+
+#if defined(RAW_ARCHIVE_ZERO_COPY)
+    struct stat status;
+    int staging[2] = { -1, -1 };
+    size_t staged = 0;
+    bool isZeroCopy = !archive->isCompressed;
+
+    // tee() only reads pipes, anything else is spliced into a staging pipe first
+    if (isZeroCopy && fstat(archive->source, &status) == 0 && !S_ISFIFO(status.st_mode)) {
+        isZeroCopy = (pipe(staging) == 0);
+        input = isZeroCopy ? staging[0] : archive->source;
+    }
+    while (isZeroCopy) {
+        if (staging[1] >= 0 && staged == 0) {
+            ssize_t count = splice(archive->source, NULL, staging[1], NULL, RAW_ARCHIVE_CHUNK, SPLICE_F_MOVE);
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count < 0 && archive->archived == 0) {
+                // The source cannot be spliced at all, copy it instead
+                isZeroCopy = false;
+                input = archive->source;
+                break;
+            }
+            if (count <= 0) {
+                archive->hasError |= (count < 0);
+                break;
+            }
+            staged = (size_t)count;
+        }
+
+        size_t chunk = (staged > 0) ? staged : RAW_ARCHIVE_CHUNK;
+        ssize_t count;
+        if (archive->decoder >= 0) {
+            count = tee(input, archive->decoder, chunk, 0);
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count < 0 && errno == EPIPE) {
+                // The decoder has stopped, only the archive is left
+                close(archive->decoder);
+                archive->decoder = -1;
+                continue;
+            }
+            if (count < 0 && archive->archived == 0 && staging[0] < 0) {
+                isZeroCopy = false;
+                break;
+            }
+        }
+        else {
+            count = splice(input, NULL, archive->archive, NULL, chunk, SPLICE_F_MOVE);
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count > 0) {
+                archive->archived += (uint64_t)count;
+                staged -= (staged > 0) ? (size_t)count : 0;
+                continue;
+            }
+        }
+        if (count <= 0) {
+            archive->hasError |= (count < 0);
+            break;
+        }
+        // The duplicated bytes are still at the head of the input, move exactly those into the archive
+        if (!raw_archive_move(archive, input, (size_t)count)) {
+            archive->hasError = true;
+            break;
+        }
+        staged -= (staged > 0) ? (size_t)count : 0;
+    }
+    if (staging[0] >= 0) {
+        close(staging[0]);
+        close(staging[1]);
+    }
+    if (!isZeroCopy) {
+        raw_archive_copy(archive, input);
+    }
+#else
+    raw_archive_copy(archive, input);
+#endif
+
+    if (archive->decoder >= 0) {
+        close(archive->decoder);
+        archive->decoder = -1;
+    }
+    return NULL;
+}
+
+// Closes the archive, after the end of its LZ4 frame when it is compressed
+static inline bool raw_archive_close_file(rawArchive* archive) {
+    if (archive->isCompressed) {
+        bool isWritten = lz4_writer_close(&archive->compressor);
+        return fclose(archive->compressedFile) == 0 && isWritten;
+    }
+    return close(archive->archive) == 0;
+}
+
+// Starts archiving stdin into path (appended to) and replaces stdin with the decoder's copy.
+// With compressionThreads > 0 the archive is compressed into an LZ4 frame on that many threads.
+static inline bool raw_archive_start(rawArchive* archive, const char* path, size_t compressionThreads) {
+    int decoderPipe[2];
+    archive->archived = 0;
+    archive->copied = 0;
+    archive->hasError = false;
+    archive->isCompressed = (compressionThreads > 0);
+    archive->compressedFile = NULL;
+
+    // splice() refuses files opened with O_APPEND, so seek to the end instead
+    archive->archive = open(path, O_WRONLY | O_CREAT, 0644);
+    if (archive->archive < 0) {
+        return false;
+    }
+    if (lseek(archive->archive, 0, SEEK_END) < 0) {
+        close(archive->archive);
+        return false;
+    }
+    if (archive->isCompressed) {
+        // A new frame after the ones already in the file, the reader decompresses them one after another
+        archive->compressedFile = fdopen(archive->archive, "wb");
+        if (archive->compressedFile == NULL) {
+            close(archive->archive);
+            return false;
+        }
+        if (!lz4_writer_open(&archive->compressor, archive->compressedFile, compressionThreads)) {
+            fclose(archive->compressedFile);
+            return false;
+        }
+    }
+    if (pipe(decoderPipe) != 0) {
+        raw_archive_close_file(archive);
+        return false;
+    }
+    archive->source = dup(STDIN_FILENO);
+    if (archive->source < 0 || dup2(decoderPipe[0], STDIN_FILENO) < 0) {
+        close(decoderPipe[0]);
+        close(decoderPipe[1]);
+        raw_archive_close_file(archive);
+        return false;
+    }
+    close(decoderPipe[0]);
+    archive->decoder = decoderPipe[1];
+
+    // A decoder that stops early closes its pipe, the thread must get EPIPE rather than a signal
+    signal(SIGPIPE, SIG_IGN);
+    if (pthread_create(&archive->thread, NULL, raw_archive_thread, archive) != 0) {
+        dup2(archive->source, STDIN_FILENO);
+        close(archive->source);
+        close(archive->decoder);
+        raw_archive_close_file(archive);
+        return false;
+    }
+    return true;
+}
+
+// Closes the decoder's copy and waits until the rest of the input is archived. False on any error.
+static inline bool raw_archive_finish(rawArchive* archive) {
+    // Nothing reads the decoder's pipe anymore, further input only goes to the archive
+    fclose(stdin);
+    pthread_join(archive->thread, NULL);
+    close(archive->source);
+    return raw_archive_close_file(archive) && !archive->hasError;
+}
+
+// Ends archiving when the program exits without raw_archive_finish() (END of the interactive mode). Input that
+// has not been read yet is left out. An uncompressed archive is complete as it is; the thread of a compressed one
+// is cancelled where it waits for input and the LZ4 frame is closed. False on any error.
+static inline bool raw_archive_stop(rawArchive* archive) {
+    if (!archive->isCompressed) {
+        return !archive->hasError;
+    }
+    // A thread blocked writing into the decoder's pipe gets EPIPE and goes back to read()
+    fclose(stdin);
+    pthread_cancel(archive->thread);
+    pthread_join(archive->thread, NULL);
+    close(archive->source);
+    return raw_archive_close_file(archive) && !archive->hasError;
+}
+
+#endif // __unix__ || __APPLE__
+
+#endif // RAW_ARCHIVE_H
@@ -0,0 +1,158 @@
+#ifndef STATE_SNAPSHOT_H
+#define STATE_SNAPSHOT_H
+
+// Checkpoints of streaming state in a memory-mapped file (POSIX only).
+// The file holds two slots; every checkpoint fills the older slot, flushes it with msync and only then
+// writes its header with the next generation number, so a crash in the middle of a checkpoint leaves
+// the previous one intact. On restart the valid slot with the highest generation is found by mapping
+// the file and checking headers and checksums, and the state is copied back without replaying any input.
+// The file is created and sized through stdio.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#define STATE_SNAPSHOT_SUPPORTED 1
+
+#define SNAPSHOT_MAGIC 0x31544E5350414E53ULL     // "SNAPSNT1"
+#define SNAPSHOT_SLOTS 2
+#define SNAPSHOT_ALIGNMENT 4096
+
+typedef struct {
+    uint64_t magic;
+    uint64_t generation;
+    uint64_t payloadSize;
+    uint64_t checksum;
+    uint8_t reserved[SNAPSHOT_ALIGNMENT - 4 * sizeof(uint64_t)];     // payload starts page aligned
+} snapshotSlotHeader;
+
+typedef struct {
+    FILE* file;
+    uint8_t* map;
+    size_t mapSize;
+    size_t slotSize;
+    size_t payloadSize;
+    uint64_t generation;        // generation of the newest valid slot, 0 when there is none
+    int newestSlot;
+} stateSnapshot;
+
+// Checksum of the payload, 64-bit words mixed in one at a time (payload sizes are multiples of 8)
+static inline uint64_t snapshot_checksum(const uint8_t* data, size_t size) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * 0x100000001B3ULL;
+        hash ^= hash >> 29;
+    }
+    return hash ^ size;
+}
+
+static inline snapshotSlotHeader* snapshot_slot_header(const stateSnapshot* snapshot, int slot) {
+    return (snapshotSlotHeader*)(snapshot->map + (size_t)slot * snapshot->slotSize);
+}
+
+static inline uint8_t* snapshot_slot_payload(const stateSnapshot* snapshot, int slot) {
+    return snapshot->map + (size_t)slot * snapshot->slotSize + sizeof(snapshotSlotHeader);
+}
+
+// Opens (or creates) a snapshot file for payloads of payloadSize bytes and finds its newest valid slot
+static inline bool snapshot_open(stateSnapshot* snapshot, const char* path, size_t payloadSize) {
+    memset(snapshot, 0, sizeof(*snapshot));
+    snapshot->newestSlot = -1;
+    snapshot->payloadSize = payloadSize;
+    snapshot->slotSize = (sizeof(snapshotSlotHeader) + payloadSize + SNAPSHOT_ALIGNMENT - 1) & ~(size_t)(SNAPSHOT_ALIGNMENT - 1);
+    snapshot->mapSize = SNAPSHOT_SLOTS * snapshot->slotSize;
+
+    snapshot->file = fopen(path, "r+b");
+    if (snapshot->file == NULL) {
+        snapshot->file = fopen(path, "w+b");
+    }
+    if (snapshot->file == NULL) {
+        return false;
+    }
+    // Grow the file to its full size, a shorter file would fault when the map is written
+    if (fseek(snapshot->file, 0, SEEK_END) != 0) {
+        fclose(snapshot->file);
+        return false;
+    }
+    long size = ftell(snapshot->file);
+    if (size < 0 || (size_t)size < snapshot->mapSize) {
+        if (fseek(snapshot->file, (long)snapshot->mapSize - 1, SEEK_SET) != 0 || fputc(0, snapshot->file) == EOF
+            || fflush(snapshot->file) != 0) {
+            fclose(snapshot->file);
+            return false;
+        }
+    }
+
+    void* map = mmap(NULL, snapshot->mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fileno(snapshot->file), 0);
+    if (map == MAP_FAILED) {
+        fclose(snapshot->file);
+        return false;
+    }
+    snapshot->map = map;
+
+    for (int slot = 0; slot < SNAPSHOT_SLOTS; slot++) {
+        const snapshotSlotHeader* header = snapshot_slot_header(snapshot, slot);
+        if (header->magic != SNAPSHOT_MAGIC || header->payloadSize != payloadSize || header->generation <= snapshot->generation) {
+            continue;
+        }
+        if (header->checksum != snapshot_checksum(snapshot_slot_payload(snapshot, slot), payloadSize)) {
+            continue;
+        }
+        snapshot->generation = header->generation;
+        snapshot->newestSlot = slot;
+    }
+    return true;
+}
+
+// Payload of the newest valid checkpoint, NULL when the file has none
+static inline const uint8_t* snapshot_latest(const stateSnapshot* snapshot) {
+    return (snapshot->newestSlot < 0) ? NULL : snapshot_slot_payload(snapshot, snapshot->newestSlot);
+}
+
+// Payload to fill for the next checkpoint (the slot that does not hold the newest one)
+static inline uint8_t* snapshot_begin(const stateSnapshot* snapshot) {
+    return snapshot_slot_payload(snapshot, (snapshot->newestSlot + 1) % SNAPSHOT_SLOTS);
+}
+
+// Makes the payload filled after snapshot_begin() the newest checkpoint
+static inline bool snapshot_commit(stateSnapshot* snapshot) {
+    int slot = (snapshot->newestSlot + 1) % SNAPSHOT_SLOTS;
+    snapshotSlotHeader* header = snapshot_slot_header(snapshot, slot);
+    uint8_t* payload = snapshot_slot_payload(snapshot, slot);
+
+    // The payload must be on disk before the header that declares it valid
+    header->magic = 0;
+    if (msync(snapshot->map + (size_t)slot * snapshot->slotSize, snapshot->slotSize, MS_SYNC) != 0) {
+        return false;
+    }
+    header->generation = snapshot->generation + 1;
+    header->payloadSize = snapshot->payloadSize;
+    header->checksum = snapshot_checksum(payload, snapshot->payloadSize);
+    header->magic = SNAPSHOT_MAGIC;
+    if (msync(header, sizeof(*header), MS_SYNC) != 0) {
+        return false;
+    }
+    snapshot->generation++;
+    snapshot->newestSlot = slot;
+    return true;
+}
+
+static inline void snapshot_close(stateSnapshot* snapshot) {
+    if (snapshot->map != NULL) {
+        munmap(snapshot->map, snapshot->mapSize);
+    }
+    if (snapshot->file != NULL) {
+        fclose(snapshot->file);
+    }
+    memset(snapshot, 0, sizeof(*snapshot));
+}
+
+#endif // __unix__ || __APPLE__
+
+#endif // STATE_SNAPSHOT_H
@@ -0,0 +1,157 @@
+/*
+ * libtankframe (tankFrame.h): decoding and alarm classification of tank frames without a process around them.
+ * basicBinOperators.c and frameDecoderModule.c classify their frames here too, with the thresholds of tankFrame.h.
+ * The batch functions run one loop per field without branches, so the compiler vectorizes them.
+ *
+ * Static:  gcc -O2 -fPIC -fvisibility=hidden -c tankFrame.c && ar rcs libtankframe.a tankFrame.o
+ * Shared:  gcc -O2 -fPIC -fvisibility=hidden -shared -Wl,-soname,libtankframe.so.1 tankFrame.c -o libtankframe.so.1
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "bitToolkit.h"
+#include "numberParsing.h"
+#include "tankFrame.h"
+
+#define TANK_FRAME_TEMPERATURE_WIDTH    8
+#define TANK_FRAME_TEMPERATURE_OFFSET   (-20)
+#define TANK_FRAME_PRESSURE_SHIFT       8
+#define TANK_FRAME_PRESSURE_WIDTH       7
+#define TANK_FRAME_PRESSURE_OFFSET      1010
+#define TANK_FRAME_HUMIDITY_SHIFT       15
+#define TANK_FRAME_HUMIDITY_WIDTH       4
+#define TANK_FRAME_FLUID_SHIFT          19
+#define TANK_FRAME_FLUID_WIDTH          13
+#define TANK_FRAME_MAX_DIGITS           8
+
+static const char* const tankFrameAlarmNames[TANK_FRAME_ALARM_TYPES] = {
+    "temp-low", "temp-high", "press-low", "press-high", "humidity", "empty", "overfill"
+};
+
+int tank_frame_api_version(void) {
+    return TANK_FRAME_API_VERSION;
+}
+
+bool tank_frame_parse(const char* text, size_t length, uint32_t* frame) {
+    uint64_t value;
+    size_t digits = length;
+    if (length >= 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+        digits -= 2;
+    }
+    if (digits > TANK_FRAME_MAX_DIGITS || !parse_hex_string(text, length, &value)) {
+        return false;
+    }
+    *frame = (uint32_t)value;
+    return true;
+}
+
+size_t tank_frame_parse_lines(const char* text, size_t length, uint32_t* frames, size_t capacity,
+                              size_t* consumed, size_t* invalidLines) {
+    const char* start = text;
+    const char* end = text + length;
+    size_t count = 0;
+    size_t invalid = 0;
+
+    while (text < end && count < capacity) {
+        size_t lineLength;
+        const char* nextLine = split_line(text, end, &lineLength);
+        if (lineLength > 0) {
+            if (tank_frame_parse(text, lineLength, &frames[count])) {
+                count++;
+            }
+            else {
+                invalid++;
+            }
+        }
+        text = nextLine;
+    }
+    *consumed = (size_t)(text - start);
+    *invalidLines = invalid;
+    return count;
+}
+
+int16_t tank_frame_temperature(uint32_t frame) {
+    return (int16_t)((int)bit_field_extract32(frame, 0, TANK_FRAME_TEMPERATURE_WIDTH) + TANK_FRAME_TEMPERATURE_OFFSET);
+}
+
+uint16_t tank_frame_pressure(uint32_t frame) {
+    return (uint16_t)(bit_field_extract32(frame, TANK_FRAME_PRESSURE_SHIFT, TANK_FRAME_PRESSURE_WIDTH) + TANK_FRAME_PRESSURE_OFFSET);
+}
+
+uint8_t tank_frame_humidity(uint32_t frame) {
+    return (uint8_t)bit_field_extract32(frame, TANK_FRAME_HUMIDITY_SHIFT, TANK_FRAME_HUMIDITY_WIDTH);
+}
+
+uint8_t tank_frame_humidity_bits(uint32_t frame) {
+    return (uint8_t)bit_popcount32(bit_field_extract32(frame, TANK_FRAME_HUMIDITY_SHIFT, TANK_FRAME_HUMIDITY_WIDTH));
+}
+
+uint16_t tank_frame_fluid_level(uint32_t frame) {
+    return (uint16_t)bit_field_extract32(frame, TANK_FRAME_FLUID_SHIFT, TANK_FRAME_FLUID_WIDTH);
+}
+
+uint8_t tank_frame_alarms(uint32_t frame) {
+    return tank_frame_classify(tank_frame_temperature(frame), tank_frame_pressure(frame), tank_frame_humidity_bits(frame),
+        tank_frame_fluid_level(frame));
+}
+
+uint8_t tank_frame_classify(int16_t temperature, uint16_t pressure, uint8_t humidityBits, uint16_t fluidLevel) {
+    // The low/high pairs cannot both be true, so no else is needed and every flag is a plain comparison
+    return (uint8_t)((temperature <= TANK_FRAME_TEMPERATURE_LOW) * TANK_FRAME_ALARM_TEMPERATURE_LOW
+        | (temperature > TANK_FRAME_TEMPERATURE_HIGH) * TANK_FRAME_ALARM_TEMPERATURE_HIGH
+        | (pressure < TANK_FRAME_PRESSURE_LOW) * TANK_FRAME_ALARM_PRESSURE_LOW
+        | (pressure > TANK_FRAME_PRESSURE_HIGH) * TANK_FRAME_ALARM_PRESSURE_HIGH
+        | (humidityBits > TANK_FRAME_HUMIDITY_BITS_HIGH) * TANK_FRAME_ALARM_HUMIDITY
+        | (fluidLevel == 0) * TANK_FRAME_ALARM_TANK_EMPTY
+        | (fluidLevel > TANK_FRAME_FLUID_LEVEL_HIGH) * TANK_FRAME_ALARM_FLUID_LEVEL_HIGH);
+}
+
+const char* tank_frame_alarm_name(int type) {
+    return (type >= 0 && type < TANK_FRAME_ALARM_TYPES) ? tankFrameAlarmNames[type] : NULL;
+}
+
+void tank_frame_decode(uint32_t frame, tankFrameValues* values) {
+    values->raw = frame;
+    values->temperature = tank_frame_temperature(frame);
+    values->pressure = tank_frame_pressure(frame);
+    values->humidity = tank_frame_humidity(frame);
+    values->humidityBits = tank_frame_humidity_bits(frame);
+    values->fluidLevel = tank_frame_fluid_level(frame);
+    values->alarms = tank_frame_classify(values->temperature, values->pressure, values->humidityBits, values->fluidLevel);
+}
+
+void tank_frame_decode_batch(const uint32_t* frames, size_t count, int16_t* temperature, uint16_t* pressure,
+                             uint8_t* humidity, uint8_t* humidityBits, uint16_t* fluidLevel, uint8_t* alarms) {
+    if (temperature != NULL) {
+        for (size_t i = 0; i < count; i++) {
+            temperature[i] = tank_frame_temperature(frames[i]);
+        }
+    }
+    if (pressure != NULL) {
+        for (size_t i = 0; i < count; i++) {
+            pressure[i] = tank_frame_pressure(frames[i]);
+        }
+    }
+    if (humidity != NULL) {
+        for (size_t i = 0; i < count; i++) {
+            humidity[i] = tank_frame_humidity(frames[i]);
+        }
+    }
+    if (humidityBits != NULL) {
+        for (size_t i = 0; i < count; i++) {
+            humidityBits[i] = tank_frame_humidity_bits(frames[i]);
+        }
+    }
+    if (fluidLevel != NULL) {
+        for (size_t i = 0; i < count; i++) {
+            fluidLevel[i] = tank_frame_fluid_level(frames[i]);
+        }
+    }
+    if (alarms != NULL) {
+        for (size_t i = 0; i < count; i++) {
+            alarms[i] = tank_frame_alarms(frames[i]);
+        }
+    }
+}
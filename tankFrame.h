@@ -0,0 +1,117 @@
+#ifndef TANK_FRAME_H
+#define TANK_FRAME_H
+
+// libtankframe: the tank frame decoder of basicBinOperators.c as a library, for services that would otherwise
+// run the program and parse its text. Parsing, field extraction, the humidity bit count and the alarm
+// classification are plain functions on caller-owned memory; nothing allocates, keeps state or prints, so every
+// function may be called from any thread.
+//
+// Frame layout (32 bits): fluid level 31-19 | humidity 18-15 | pressure 14-8 | temperature 7-0
+//
+// This header is the stable interface: functions are only added, the layout of tankFrameValues and the values of
+// the TANK_FRAME_ALARM_* flags do not change within an API version (tank_frame_api_version()).
+//
+//   uint32_t frame;
+//   tankFrameValues values;
+//   if (tank_frame_parse("0008a318", 8, &frame)) {
+//       tank_frame_decode(frame, &values);      // values.pressure == 1045, values.alarms == ...
+//   }
+//
+// Static:  gcc -O2 -fPIC -fvisibility=hidden -c tankFrame.c && ar rcs libtankframe.a tankFrame.o
+// Shared:  gcc -O2 -fPIC -fvisibility=hidden -shared -Wl,-soname,libtankframe.so.1 tankFrame.c -o libtankframe.so.1
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(_WIN32) && defined(TANK_FRAME_BUILD_DLL)
+#define TANK_FRAME_API __declspec(dllexport)
+#elif defined(__GNUC__)
+#define TANK_FRAME_API __attribute__((visibility("default")))
+#else
+#define TANK_FRAME_API
+#endif
+
+#define TANK_FRAME_API_VERSION 1
+
+// Alarm thresholds, the only place they are defined (basicBinOperators.c, the default rules of alarmRules.h and
+// frameDecoderModule.c use these)
+#define TANK_FRAME_TEMPERATURE_LOW          4           // Celsius, alarm at or below
+#define TANK_FRAME_TEMPERATURE_HIGH         100         // Celsius, alarm above
+#define TANK_FRAME_PRESSURE_LOW             1013        // hPa, alarm below
+#define TANK_FRAME_PRESSURE_HIGH            1135        // hPa, alarm above
+#define TANK_FRAME_HUMIDITY_BITS_HIGH       2           // alarm with more humidity bits set
+#define TANK_FRAME_FLUID_LEVEL_HIGH         8000        // liters, alarm above
+
+// A threshold as a string literal, for messages and rule text
+#define TANK_FRAME_TEXT(threshold)          TANK_FRAME_TEXT_VALUE(threshold)
+#define TANK_FRAME_TEXT_VALUE(threshold)    #threshold
+
+// Alarm flags, the same bits as the ALARM_* flags of basicBinOperators.c
+#define TANK_FRAME_ALARM_TEMPERATURE_LOW    0x01        // temperature <= TANK_FRAME_TEMPERATURE_LOW
+#define TANK_FRAME_ALARM_TEMPERATURE_HIGH   0x02        // temperature > TANK_FRAME_TEMPERATURE_HIGH
+#define TANK_FRAME_ALARM_PRESSURE_LOW       0x04        // pressure < TANK_FRAME_PRESSURE_LOW
+#define TANK_FRAME_ALARM_PRESSURE_HIGH      0x08        // pressure > TANK_FRAME_PRESSURE_HIGH
+#define TANK_FRAME_ALARM_HUMIDITY           0x10        // humidity bits > TANK_FRAME_HUMIDITY_BITS_HIGH
+#define TANK_FRAME_ALARM_TANK_EMPTY         0x20        // fluid level 0
+#define TANK_FRAME_ALARM_FLUID_LEVEL_HIGH   0x40        // fluid level > TANK_FRAME_FLUID_LEVEL_HIGH
+#define TANK_FRAME_ALARM_TYPES              7
+#define TANK_FRAME_ALARM_CRITICAL           (TANK_FRAME_ALARM_PRESSURE_HIGH | TANK_FRAME_ALARM_TANK_EMPTY)
+
+// All fields of one frame
+typedef struct {
+    uint32_t raw;
+    int16_t temperature;        // Celsius, -20 to 235
+    uint16_t pressure;          // hPa, 1010 to 1137
+    uint8_t humidity;           // the 4 raw humidity bits
+    uint8_t humidityBits;       // number of humidity bits set
+    uint16_t fluidLevel;        // liters, 0 to 8191
+    uint8_t alarms;             // TANK_FRAME_ALARM_* flags
+} tankFrameValues;
+
+// TANK_FRAME_API_VERSION of the library that is linked (may be newer than the header)
+TANK_FRAME_API int tank_frame_api_version(void);
+
+// Parses one frame of 1 to 8 hexadecimal digits (optional "0x"), false when the text is not a frame
+TANK_FRAME_API bool tank_frame_parse(const char* text, size_t length, uint32_t* frame);
+
+// Parses text with one frame per line ("\n" or "\r\n") into frames, at most capacity of them. Returns the number
+// of frames; *consumed is the number of bytes read (less than length when frames filled up, call again with the
+// rest) and *invalidLines counts the lines that are not frames. Empty lines are skipped.
+TANK_FRAME_API size_t tank_frame_parse_lines(const char* text, size_t length, uint32_t* frames, size_t capacity,
+                                             size_t* consumed, size_t* invalidLines);
+
+// Single fields
+TANK_FRAME_API int16_t tank_frame_temperature(uint32_t frame);
+TANK_FRAME_API uint16_t tank_frame_pressure(uint32_t frame);
+TANK_FRAME_API uint8_t tank_frame_humidity(uint32_t frame);
+TANK_FRAME_API uint8_t tank_frame_humidity_bits(uint32_t frame);
+TANK_FRAME_API uint16_t tank_frame_fluid_level(uint32_t frame);
+
+// TANK_FRAME_ALARM_* flags of all exceeded thresholds, 0 when everything is fine
+TANK_FRAME_API uint8_t tank_frame_alarms(uint32_t frame);
+
+// The same for fields that are already decoded
+TANK_FRAME_API uint8_t tank_frame_classify(int16_t temperature, uint16_t pressure, uint8_t humidityBits,
+                                           uint16_t fluidLevel);
+
+// Short name of alarm type 0 to TANK_FRAME_ALARM_TYPES - 1 ("temp-low" ... "overfill"), NULL for other types
+TANK_FRAME_API const char* tank_frame_alarm_name(int type);
+
+// All fields of one frame
+TANK_FRAME_API void tank_frame_decode(uint32_t frame, tankFrameValues* values);
+
+// All fields of count frames, one array per field (struct of arrays). Arrays that are NULL are not filled.
+TANK_FRAME_API void tank_frame_decode_batch(const uint32_t* frames, size_t count, int16_t* temperature,
+                                            uint16_t* pressure, uint8_t* humidity, uint8_t* humidityBits,
+                                            uint16_t* fluidLevel, uint8_t* alarms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TANK_FRAME_H